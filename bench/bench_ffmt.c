@@ -0,0 +1,159 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: bench/bench_ffmt.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: ffmt 与 libc snprintf 吞吐量对比
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 用法：bench_ffmt [次数]
+ * 每个说明符分别用 ffmt 与输出相同文本的 snprintf 格式化同一组伪随机数，
+ * 输出 ns/次 与 MB/s（按输出字节数计），输出一致性由 test/test_ffmt.c 检查
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "utl_ffmt.h"
+
+#define VALUES 1024
+
+static int32_t values[VALUES];
+static double doubles[VALUES];
+static uint8_t bytes[32];
+static const char *names[] = {"sensor/imu0", "nav", "gnss/rtk/base", "link"};
+
+/// @brief 一个说明符的 ffmt 与 snprintf 写法
+typedef struct
+{
+	const char *name;
+	int (*pfun_ffmt)(char *buffer, uint32_t i);
+	int (*pfun_libc)(char *buffer, uint32_t i);
+} bench_case_t;
+
+// ffmt 的返回值包含 '\0'，减 1 后与 snprintf 一样按文本长度计算吞吐量
+#define CASE(name, ffmt_call, libc_call)                                                 \
+	static int name##_ffmt(char *buffer, uint32_t i) { (void)i; return ffmt_call - 1; } \
+	static int name##_libc(char *buffer, uint32_t i) { (void)i; return libc_call; }
+
+CASE(d, ffmt(buffer, 64, false, "%d", values[i]), snprintf(buffer, 64, "%d", values[i]))
+CASE(u, ffmt(buffer, 64, false, "%u", values[i]), snprintf(buffer, 64, "%u", (uint32_t)values[i]))
+CASE(lx, ffmt(buffer, 64, false, "%lx", values[i]), snprintf(buffer, 64, "%08X", (uint32_t)values[i]))
+CASE(f, ffmt(buffer, 64, false, "%f", values[i]), snprintf(buffer, 64, "%.5f", values[i] / 4096.0))
+CASE(s, ffmt(buffer, 64, false, "%s", names[i & 3]), snprintf(buffer, 64, "%s", names[i & 3]))
+CASE(m, ffmt(buffer, 128, false, "%+m", bytes, 32u), snprintf(buffer, 128, "%02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X", bytes[0], bytes[1], bytes[2], bytes[3], bytes[4], bytes[5], bytes[6], bytes[7], bytes[8], bytes[9], bytes[10], bytes[11], bytes[12], bytes[13], bytes[14], bytes[15], bytes[16], bytes[17], bytes[18], bytes[19], bytes[20], bytes[21], bytes[22], bytes[23], bytes[24], bytes[25], bytes[26], bytes[27], bytes[28], bytes[29], bytes[30], bytes[31]))
+CASE(F, ffmt(buffer, 64, false, "%F", doubles[i]), snprintf(buffer, 64, "%.17g", doubles[i]))
+CASE(line, ffmt(buffer, 256, false, "[INFO] nav: fix=%u sats=%d lat=%f lon=%f alt=%f flags=%x", (uint32_t)i, values[i] & 15, values[i], values[(i + 1) % VALUES], values[(i + 2) % VALUES], (uint32_t)values[i]),
+	 snprintf(buffer, 256, "[INFO] nav: fix=%u sats=%d lat=%.5f lon=%.5f alt=%.5f flags=%04X", i, values[i] & 15, values[i] / 4096.0, values[(i + 1) % VALUES] / 4096.0, values[(i + 2) % VALUES] / 4096.0, (uint32_t)values[i] & 0xFFFF))
+
+// 一行 ROW 个数值，对比 ffmt_array 与逐个调用 snprintf 拼接
+#define ROW 16
+
+/// @brief 逐个 snprintf 拼接一行 fq12 数值
+static int row_libc(char *buffer, uint32_t i, char type)
+{
+	int len = 0;
+	const int32_t *row = &values[i & (VALUES - ROW)];
+
+	for (uint32_t k = 0; k < ROW; k++)
+	{
+		if (type == 'f')
+		{
+			len += snprintf(buffer + len, 1024 - len, (k + 1 < ROW) ? "%.5f," : "%.5f\n", row[k] / 4096.0);
+		}
+		else
+		{
+			len += snprintf(buffer + len, 1024 - len, (k + 1 < ROW) ? "%d," : "%d\n", row[k]);
+		}
+	}
+	return len;
+}
+
+CASE(array_d, ffmt_array(buffer, 1024, &values[i & (VALUES - ROW)], ROW, 0, 'd', ",", "\n"), row_libc(buffer, i, 'd'))
+CASE(array_f, ffmt_array(buffer, 1024, &values[i & (VALUES - ROW)], ROW, 0, 'f', ",", "\n"), row_libc(buffer, i, 'f'))
+
+static const bench_case_t cases[] = {
+	{"%d", d_ffmt, d_libc},
+	{"%u", u_ffmt, u_libc},
+	{"%lx", lx_ffmt, lx_libc},
+	{"%f", f_ffmt, f_libc},
+	{"%s", s_ffmt, s_libc},
+	{"%+m", m_ffmt, m_libc},
+	{"%F", F_ffmt, F_libc},
+	{"log line", line_ffmt, line_libc},
+	{"array %d", array_d_ffmt, array_d_libc},
+	{"array %f", array_f_ffmt, array_f_libc},
+};
+
+/// @brief 执行一种写法并返回耗时与输出字节数
+static double run(int (*pfun)(char *buffer, uint32_t i), uint32_t iterations, uint64_t *bytes_out)
+{
+	char buffer[1024];
+	uint64_t total = 0;
+	double start = bench_now();
+
+	for (uint32_t n = 0; n < iterations; n++)
+	{
+		total += (uint64_t)pfun(buffer, n & (VALUES - 1));
+		bench_consume(buffer);
+	}
+	*bytes_out = total;
+	return bench_now() - start;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t iterations = (argc > 1) ? (uint32_t)strtoul(argv[1], 0, 0) : 2000000;
+	uint32_t seed = 1;
+	uint64_t bytes_ffmt;
+	uint64_t bytes_libc;
+	double t_ffmt;
+	double t_libc;
+
+	for (uint32_t i = 0; i < VALUES; i++)
+	{
+		seed = seed * 1103515245u + 12345u;
+		values[i] = (int32_t)(seed >> (seed & 15));
+		doubles[i] = (double)values[i] / (double)((seed >> 8) | 1);
+	}
+	for (uint32_t i = 0; i < sizeof(bytes); i++)
+	{
+		bytes[i] = (uint8_t)(i * 37);
+	}
+
+	printf("%-10s %12s %12s %12s %12s %8s\n", "spec", "ffmt ns", "ffmt MB/s", "libc ns", "libc MB/s", "speedup");
+	for (uint32_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+	{
+		t_ffmt = run(cases[c].pfun_ffmt, iterations, &bytes_ffmt);
+		t_libc = run(cases[c].pfun_libc, iterations, &bytes_libc);
+		printf("%-10s %12.1f %12.1f %12.1f %12.1f %7.2fx\n", cases[c].name,
+			   t_ffmt * 1e9 / iterations, bytes_ffmt / t_ffmt / 1e6,
+			   t_libc * 1e9 / iterations, bytes_libc / t_libc / 1e6, t_libc / t_ffmt);
+	}
+	return 0;
+}
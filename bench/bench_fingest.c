@@ -0,0 +1,144 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: bench/bench_fingest.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: fingest 分块并行导入吞吐量与扩展性
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 用法：bench_fingest [MB 数 | 日志文件] [最大线程数]
+ * 参数为数字时导入内存中生成的 10 Hz 日志（fingest_buffer），否则导入指定的文件（fingest_file，
+ * 第一轮之后文件已在页缓存中）；线程数从 1 开始逐次加倍，输出 GB/s、行数与相对单线程的加速比
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bench.h"
+#include "bench_nmea.h"
+#include "utl_fingest.h"
+
+static const char *path;
+static char *data;
+static uint64_t len;
+
+/// @brief 以指定线程数导入一次
+/// @return 耗时（秒），失败时为负数
+static double run(uint32_t threads, uint64_t *rows)
+{
+	fingest_columns_t cols;
+	double start = bench_now();
+	int32_t ret;
+
+	ret = (path != 0) ? fingest_file(path, threads, &cols) : fingest_buffer(data, len, threads, &cols);
+	start = bench_now() - start;
+	if (ret != FINGEST_Error_None)
+	{
+		printf("fingest error %d\n", ret);
+		return -1;
+	}
+	*rows = cols.count;
+	bench_consume(cols.lat);
+	fingest_free(&cols);
+	return start;
+}
+
+int main(int argc, char *argv[])
+{
+	long online = sysconf(_SC_NPROCESSORS_ONLN);
+	uint32_t max_threads;
+	uint32_t epochs = 0;
+	uint64_t rows = 0;
+	double base = 0;
+	double elapsed;
+	double rate;
+	struct stat st;
+
+	online = (online > 0) ? online : 1;
+	max_threads = (argc > 2) ? (uint32_t)strtoul(argv[2], 0, 0) : (uint32_t)online;
+	if ((argc > 1) && !isdigit((unsigned char)argv[1][0]))
+	{
+		path = argv[1];
+		if (stat(path, &st) != 0)
+		{
+			perror(path);
+			return 1;
+		}
+		len = (uint64_t)st.st_size;
+	}
+	else
+	{
+		uint64_t size = ((argc > 1) ? strtoull(argv[1], 0, 0) : 256) << 20;
+
+		data = (char *)malloc((size_t)size);
+		if (data == 0)
+		{
+			return 1;
+		}
+		len = bench_nmea_fill(data, size, &epochs);
+	}
+	if ((len == 0) || (max_threads == 0))
+	{
+		printf("usage: %s [MB | file] [max threads]\n", argv[0]);
+		return 1;
+	}
+
+	// 预热一轮，之后线程数超过在线 CPU 数时按 CPU 数计算每核效率
+	if (run(1, &rows) < 0)
+	{
+		return 1;
+	}
+	printf("%8s %10s %12s %12s %10s %10s\n", "threads", "GB/s", "rows", "rows/s", "speedup", "per core");
+	for (uint32_t threads = 1;; threads *= 2)
+	{
+		threads = (threads > max_threads) ? max_threads : threads;
+		elapsed = run(threads, &rows);
+		if (elapsed < 0)
+		{
+			return 1;
+		}
+		rate = len / elapsed;
+		base = (threads == 1) ? rate : base;
+		printf("%8u %10.2f %12llu %12.0f %9.2fx %9.0f%%\n", threads, rate / 1e9, (unsigned long long)rows,
+			   rows / elapsed, rate / base, rate / base / (((long)threads < online) ? (long)threads : online) * 100);
+		if (threads == max_threads)
+		{
+			break;
+		}
+	}
+	printf("online CPUs: %ld", online);
+	if (path == 0)
+	{
+		printf(", generated epochs: %u", epochs);
+	}
+	printf("\n");
+	free(data);
+	return 0;
+}
@@ -0,0 +1,182 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: bench/bench_flogs_async.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: flogs 同步与异步输出的调用者延迟分位数
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 用法：bench_flogs_sync | bench_flogs_async | bench_flogs_async_block [每线程记录数] [线程数] [输出耗时 ns]
+ * 同一文件按同步输出、异步丢弃与异步等待三种配置编译（见 Makefile），
+ * 输出函数忙等指定时间模拟慢速串口或文件，统计调用者一侧每次 FLOGI 的耗时分位数；
+ * 异步配置由一个后台线程调用 flogs_drain
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "utl_flogs.h"
+
+#define THREADS_MAX 64
+
+#if !FLOG_ASYNC
+#define MODE "sync"
+#elif FLOG_ASYNC_OVERFLOW == FLOG_OVERFLOW_BLOCK
+#define MODE "async block"
+#else
+#define MODE "async drop"
+#endif
+
+static uint32_t records = 100000;
+static uint32_t threads = 4;
+static uint32_t sink_ns = 1000;
+static double *latency;
+static atomic_uint sunk;
+
+/// @brief 慢速输出函数
+static void sink(char *buffer, uint32_t size)
+{
+    double end = bench_now() + sink_ns * 1e-9;
+
+    (void)size;
+    bench_consume(buffer);
+    while (bench_now() < end)
+    {
+    }
+    atomic_fetch_add_explicit(&sunk, 1, memory_order_relaxed);
+}
+
+static void *writer(void *arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+    double *lat = latency + (size_t)id * records;
+    double start;
+
+    for (uint32_t i = 0; i < records; i++)
+    {
+        start = bench_now();
+        FLOGI("bench", "id=%u i=%u v=%d", id, i, (int32_t)(i * 2654435761u));
+        lat[i] = bench_now() - start;
+    }
+    return 0;
+}
+
+#if FLOG_ASYNC
+static atomic_bool done;
+
+static void *drainer(void *arg)
+{
+    (void)arg;
+    while (!atomic_load_explicit(&done, memory_order_acquire))
+    {
+        if (flogs_drain() == 0)
+        {
+            sched_yield();
+        }
+    }
+    return 0;
+}
+#endif
+
+static int compare(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/// @brief 第 p 百分位的延迟（ns）
+static double percentile(size_t total, double p)
+{
+    size_t i = (size_t)(total * p / 100.0);
+
+    return latency[(i < total) ? i : (total - 1)] * 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    pthread_t tid[THREADS_MAX];
+    size_t total;
+    double start;
+    double elapsed;
+
+    records = (argc > 1) ? (uint32_t)strtoul(argv[1], 0, 0) : records;
+    threads = (argc > 2) ? (uint32_t)strtoul(argv[2], 0, 0) : threads;
+    sink_ns = (argc > 3) ? (uint32_t)strtoul(argv[3], 0, 0) : sink_ns;
+    if ((records == 0) || (threads == 0) || (threads > THREADS_MAX))
+    {
+        printf("usage: %s [records per thread] [threads 1..%d] [sink ns]\n", argv[0], THREADS_MAX);
+        return 1;
+    }
+    total = (size_t)records * threads;
+    latency = (double *)malloc(total * sizeof(double));
+    if (latency == 0)
+    {
+        return 1;
+    }
+
+    flogs_init(sink);
+#if FLOG_ASYNC
+    pthread_t drain;
+    pthread_create(&drain, 0, drainer, 0);
+#endif
+    start = bench_now();
+    for (uint32_t i = 0; i < threads; i++)
+    {
+        pthread_create(&tid[i], 0, writer, (void *)(uintptr_t)i);
+    }
+    for (uint32_t i = 0; i < threads; i++)
+    {
+        pthread_join(tid[i], 0);
+    }
+    elapsed = bench_now() - start;
+#if FLOG_ASYNC
+    flogs_flush();
+    atomic_store_explicit(&done, true, memory_order_release);
+    pthread_join(drain, 0);
+#endif
+
+    qsort(latency, total, sizeof(double), compare);
+    printf("%-12s %8s %8s %8s %8s %10s %12s %10s %10s\n", "mode", "p50 ns", "p90 ns", "p99 ns", "p99.9 ns",
+           "max ns", "calls/s", "output", "dropped");
+    printf("%-12s %8.0f %8.0f %8.0f %8.0f %10.0f %12.0f %10u %10u\n", MODE, percentile(total, 50),
+           percentile(total, 90), percentile(total, 99), percentile(total, 99.9), latency[total - 1] * 1e9,
+           total / elapsed, atomic_load(&sunk),
+#if FLOG_ASYNC
+           flogs_dropped()
+#else
+           0u
+#endif
+    );
+    free(latency);
+    return 0;
+}
@@ -0,0 +1,122 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: bench/bench_flogs_batch.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: flogs 批量输出的系统调用次数与吞吐量
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 用法：bench_flogs_write | bench_flogs_batch [记录数] [输出文件]
+ * 同一文件按逐条输出（每条记录一次 write）与批量输出（FLOG_BATCH，每批一次 writev）编译，
+ * 输出到指定文件（默认 /dev/null），统计系统调用次数、记录吞吐量与字节吞吐量
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "bench.h"
+#include "utl_flogs.h"
+
+#if FLOG_BATCH
+#define MODE "writev"
+#else
+#define MODE "write"
+#endif
+
+static int fd;
+static uint64_t syscalls;
+static uint64_t bytes;
+
+/// @brief 每条记录一次 write
+static void sink(char *buffer, uint32_t size)
+{
+    syscalls++;
+    bytes += size;
+    if (write(fd, buffer, size) < 0)
+    {
+        perror("write");
+        exit(1);
+    }
+}
+
+#if FLOG_BATCH
+/// @brief 每批一次 writev
+static void sink_writev(const flogs_iovec_t *iov, uint32_t count)
+{
+    struct iovec vec[FLOG_BATCH_IOV];
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        vec[i].iov_base = iov[i].base;
+        vec[i].iov_len = iov[i].len;
+        bytes += iov[i].len;
+    }
+    syscalls++;
+    if (writev(fd, vec, (int)count) < 0)
+    {
+        perror("writev");
+        exit(1);
+    }
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    uint32_t records = (argc > 1) ? (uint32_t)strtoul(argv[1], 0, 0) : 2000000;
+    const char *path = (argc > 2) ? argv[2] : "/dev/null";
+    double elapsed;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        perror(path);
+        return 1;
+    }
+    flogs_init(sink);
+#if FLOG_BATCH
+    flogs_batch_init(sink_writev);
+#endif
+
+    elapsed = bench_now();
+    for (uint32_t i = 0; i < records; i++)
+    {
+        FLOGI("bench", "nav: fix=%u sats=%d lat=%f", i, (int32_t)(i % 24), (int32_t)(i * 2654435761u) >> 4);
+    }
+#if FLOG_BATCH
+    flogs_flush();
+#endif
+    elapsed = bench_now() - elapsed;
+    close(fd);
+
+    printf("%-8s %10s %12s %14s %12s %10s\n", "mode", "records", "syscalls", "records/call", "records/s", "MB/s");
+    printf("%-8s %10u %12llu %14.1f %12.0f %10.1f\n", MODE, records, (unsigned long long)syscalls,
+           (double)records / (double)syscalls, records / elapsed, bytes / elapsed / 1e6);
+    return 0;
+}
@@ -0,0 +1,166 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: bench/bench_flogs_deferred.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: flogs 延迟输出与文本输出的单次调用耗时与记录大小对比
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 用法：bench_flogs_text | bench_flogs_deferred [记录数]
+ * 同一文件按文本输出与延迟输出（FLOG_DEFERRED，主机端 FLOG_DECODER）编译，
+ * 依次调用导航、网络、错误、状态切换四种记录，输出函数只统计字节数，
+ * 输出每次调用的耗时（ns）与每条记录的字节数；
+ * 延迟输出另外取前 DECODE_RECORDS 条记录，统计 flogs_decode 还原每条记录的耗时与还原后的字节数
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "utl_flogs.h"
+
+#if FLOG_DEFERRED
+#define MODE "deferred"
+#else
+#define MODE "text"
+#endif
+
+// 还原耗时使用的记录数
+#define DECODE_RECORDS 8192
+
+static const char *states[] = {"idle", "align", "nav", "hold", "fault"};
+static const char *peers[] = {"10.0.0.1", "gateway", "192.168.100.254", "imu"};
+
+static uint64_t bytes;
+static uint64_t calls;
+#if FLOG_DEFERRED
+static uint8_t *stream;
+static uint32_t stream_len;
+static bool capture;
+#endif
+
+static void sink(char *buffer, uint32_t size)
+{
+    calls++;
+    bytes += size;
+#if FLOG_DEFERRED
+    if (capture)
+    {
+        memcpy(stream + stream_len, buffer, size);
+        stream_len += size;
+    }
+#endif
+    bench_consume(buffer);
+}
+
+/// @brief 第 i 条记录
+static void record(uint32_t i)
+{
+    uint32_t r = i * 2654435761u;
+
+    switch (i & 3)
+    {
+    case 0:
+        FLOGI("nav", "fix=%u sats=%d lat=%f lon=%f", i, (int32_t)(12 + (r >> 29)), (int32_t)(128082 + (i >> 3)), (int32_t)(497541 - (i >> 4)));
+        break;
+    case 1:
+        FLOGI("net", "rx id=%u len=%d rssi=%f peer=%s", r, (int32_t)(64 + (r >> 20) % 1400), -(int32_t)((r >> 8) % (100 << 12)), peers[(r >> 4) & 3]);
+        break;
+    case 2:
+        FLOGE("imu", "read timeout reg=%lx code=%d", r, -110);
+        break;
+    default:
+        FLOGI("ctl", "state %s -> %s after %u ms", states[(i >> 2) % 5], states[((i >> 2) + 1) % 5], (r >> 12) % 5000);
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t n = (argc > 1) ? (uint32_t)strtoul(argv[1], 0, 0) : 2000000;
+    double elapsed;
+
+    flogs_init(sink);
+    elapsed = bench_now();
+    for (uint32_t i = 0; i < n; i++)
+    {
+        record(i);
+    }
+    elapsed = bench_now() - elapsed;
+    if (calls != n)
+    {
+        printf("%llu of %u records written\n", (unsigned long long)calls, n);
+        return 1;
+    }
+
+    printf("%-10s %10s %10s %14s %12s %14s\n", "mode", "records", "ns/call", "bytes/record", "decode ns", "decoded bytes");
+    printf("%-10s %10u %10.1f %14.1f", MODE, n, elapsed * 1e9 / n, (double)bytes / n);
+#if FLOG_DEFERRED
+    {
+        extern const char __start_flogs_fmt[];
+        extern const char __stop_flogs_fmt[];
+        uint32_t strtab_len = (uint32_t)(__stop_flogs_fmt - __start_flogs_fmt);
+        uint32_t rounds = 64;
+
+        // 先取一段记录，再反复还原计时，还原结果与文本输出一样交给输出函数
+        stream = malloc((size_t)DECODE_RECORDS * LOG_BUFFER_MAX_SIZE);
+        if (stream == 0)
+        {
+            printf("\nout of memory\n");
+            return 1;
+        }
+        capture = true;
+        for (uint32_t i = 0; i < DECODE_RECORDS; i++)
+        {
+            record(i);
+        }
+        capture = false;
+        calls = 0;
+        bytes = 0;
+        elapsed = bench_now();
+        for (uint32_t r = 0; r < rounds; r++)
+        {
+            if (flogs_decode(stream, stream_len, __start_flogs_fmt, strtab_len) != stream_len)
+            {
+                printf("\nincomplete decode\n");
+                return 1;
+            }
+        }
+        elapsed = bench_now() - elapsed;
+        if (calls != (uint64_t)rounds * DECODE_RECORDS)
+        {
+            printf("\n%llu of %u records decoded\n", (unsigned long long)calls, rounds * DECODE_RECORDS);
+            return 1;
+        }
+        printf(" %12.1f %14.1f", elapsed * 1e9 / calls, (double)bytes / calls);
+        free(stream);
+    }
+#endif
+    printf("\n");
+    return 0;
+}
@@ -0,0 +1,309 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: bench/bench_flogs_kv.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: flogs 结构化日志与文本日志加解析的耗时与记录大小对比
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 用法：bench_flogs_kv_json | bench_flogs_kv_tlv [记录数]
+ * 同一组字段（id、len、rssi、peer）分别以三种方式记录并还原为数值：
+ * text + sscanf  FLOGI 输出文本，再用 sscanf 解析
+ * text + strtol  FLOGI 输出文本，再用 strstr / strtol / strtod 解析
+ * json / tlv     flogs_kv 输出 JSON（按键名查找后 strtol / strtod）或 TLV（按类型与长度遍历）
+ * 输出每条记录的编码、解析耗时（ns）与输出字节数，解析结果与原值比较，不一致时报错
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "utl_flogs.h"
+
+#if FLOG_KV == FLOG_KV_JSON
+#define MODE "json"
+#elif FLOG_KV == FLOG_KV_TLV
+#define MODE "tlv"
+#else
+#error "build with FLOG_KV=1 (JSON) or FLOG_KV=2 (TLV)"
+#endif
+
+#define RECORDS_MAX 4096
+
+/// @brief 一条记录的字段
+typedef struct
+{
+    uint32_t id;
+    int32_t len;
+    int32_t rssi; // fq12
+    char peer[16];
+} bench_fields_t;
+
+static const char *peers[] = {"10.0.0.1", "gateway", "192.168.100.254", "imu"};
+
+// 输出保存在环形记录表中，补上 '\0' 供文本解析函数使用，解析阶段逐条读取
+static char records[RECORDS_MAX][LOG_BUFFER_MAX_SIZE + 1];
+static uint32_t lengths[RECORDS_MAX];
+static uint32_t count;
+static uint64_t bytes;
+
+static void sink(char *buffer, uint32_t size)
+{
+    uint32_t slot = count++ & (RECORDS_MAX - 1);
+
+    memcpy(records[slot], buffer, size);
+    records[slot][size] = '\0';
+    lengths[slot] = size;
+    bytes += size;
+}
+
+/// @brief 第 i 条记录的字段值
+static void fields(uint32_t i, bench_fields_t *f)
+{
+    f->id = i * 2654435761u;
+    f->len = (int32_t)(i % 1500) - 20;
+    f->rssi = -(int32_t)((i * 37) % (100 << 12));
+    strcpy(f->peer, peers[i & 3]);
+}
+
+/// @brief 比较解析结果，fq12 经文本往返时保留 5 位小数，允许 1 LSB 误差
+static int same(const bench_fields_t *a, const bench_fields_t *b)
+{
+    return (a->id == b->id) && (a->len == b->len) && (abs(a->rssi - b->rssi) <= 1) && (strcmp(a->peer, b->peer) == 0);
+}
+
+/// @brief 文本记录：sscanf
+static int parse_sscanf(const char *text, uint32_t size, bench_fields_t *f)
+{
+    const char *p = strstr(text, "id=");
+    double rssi;
+
+    (void)size;
+    if ((p == 0) || (sscanf(p, "id=%u len=%d rssi=%lf peer=%15s", &f->id, &f->len, &rssi, f->peer) != 4))
+    {
+        return 0;
+    }
+    f->rssi = (int32_t)(rssi * 4096.0 + ((rssi < 0) ? -0.5 : 0.5));
+    return 1;
+}
+
+/// @brief 文本记录：strstr / strtol / strtod
+static int parse_strtol(const char *text, uint32_t size, bench_fields_t *f)
+{
+    const char *p = strstr(text, "id=");
+    char *end;
+    size_t n;
+
+    (void)size;
+    if (p == 0)
+    {
+        return 0;
+    }
+    f->id = (uint32_t)strtoul(p + 3, &end, 10);
+    f->len = (int32_t)strtol(end + 5, &end, 10);
+    f->rssi = (int32_t)(strtod(end + 6, &end) * 4096.0 - 0.5);
+    n = strcspn(end + 6, " \r\n\033");
+    memcpy(f->peer, end + 6, n);
+    f->peer[n] = '\0';
+    return 1;
+}
+
+#if FLOG_KV == FLOG_KV_JSON
+/// @brief JSON 行：按键名查找
+static int parse_kv(const char *text, uint32_t size, bench_fields_t *f)
+{
+    const char *p;
+    const char *q;
+
+    (void)size;
+    if ((p = strstr(text, "\"id\":")) == 0)
+    {
+        return 0;
+    }
+    f->id = (uint32_t)strtoul(p + 5, 0, 10);
+    p = strstr(p, "\"len\":");
+    f->len = (int32_t)strtol(p + 6, 0, 10);
+    p = strstr(p, "\"rssi\":");
+    f->rssi = (int32_t)(strtod(p + 7, 0) * 4096.0 - 0.5);
+    p = strstr(p, "\"peer\":\"") + 8;
+    q = strchr(p, '"');
+    memcpy(f->peer, p, (size_t)(q - p));
+    f->peer[q - p] = '\0';
+    return 1;
+}
+#else
+/// @brief 读取变长整数
+static uint32_t varint(const uint8_t *p, uint32_t length)
+{
+    uint32_t num = 0;
+
+    for (uint32_t i = 0; i < length; i++)
+    {
+        num |= (uint32_t)(p[i] & 0x7F) << (7 * i);
+    }
+    return num;
+}
+
+/// @brief TLV 记录：按类型与长度遍历，键名决定字段
+static int parse_kv(const char *text, uint32_t size, bench_fields_t *f)
+{
+    const uint8_t *p = (const uint8_t *)text + 4;
+    const uint8_t *end = (const uint8_t *)text + size - 1;
+    const uint8_t *key = 0;
+    uint32_t num;
+
+    while (p + 2 <= end)
+    {
+        switch (p[0])
+        {
+        case 0x10:
+            key = p;
+            break;
+        case 0x11:
+        case 0x13:
+            num = varint(p + 2, p[1]);
+            num = (num >> 1) ^ (0u - (num & 1));
+            if (key[2] == 'l')
+            {
+                f->len = (int32_t)num;
+            }
+            else
+            {
+                f->rssi = (int32_t)num;
+            }
+            break;
+        case 0x12:
+            f->id = varint(p + 2, p[1]);
+            break;
+        case 0x14:
+            memcpy(f->peer, p + 2, p[1]);
+            f->peer[p[1]] = '\0';
+            break;
+        default:
+            break;
+        }
+        p += 2 + p[1];
+    }
+    return 1;
+}
+#endif
+
+/// @brief 编码 n 条文本记录
+static double encode_text(uint32_t n)
+{
+    bench_fields_t f;
+    double start = bench_now();
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        fields(i, &f);
+        FLOGI("net", "rx id=%u len=%d rssi=%f peer=%s", f.id, f.len, f.rssi, f.peer);
+    }
+    return bench_now() - start;
+}
+
+/// @brief 编码 n 条结构化记录
+static double encode_kv(uint32_t n)
+{
+    bench_fields_t f;
+    double start = bench_now();
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        fields(i, &f);
+        flogs_kv_t kv[] = {FLOGS_KV_UINT("id", f.id), FLOGS_KV_INT("len", f.len), FLOGS_KV_FQ12("rssi", f.rssi),
+                           FLOGS_KV_STR("peer", f.peer)};
+        flogs_kv(LEVEL_INFO, "net", "rx", kv, 4);
+    }
+    return bench_now() - start;
+}
+
+/// @brief 解析最后 RECORDS_MAX 条记录若干轮，返回每条记录的耗时
+static double parse(int (*pfun)(const char *text, uint32_t size, bench_fields_t *f), uint32_t n, uint32_t *errors)
+{
+    uint32_t first = n - RECORDS_MAX;
+    uint32_t rounds = (n / RECORDS_MAX < 64) ? n / RECORDS_MAX : 64;
+    bench_fields_t got;
+    bench_fields_t want;
+    double start;
+
+    // 先检查一轮解析结果，计时的各轮不做比较
+    *errors = 0;
+    for (uint32_t i = first; i < n; i++)
+    {
+        memset(&got, 0, sizeof(got));
+        fields(i, &want);
+        *errors += !pfun(records[i & (RECORDS_MAX - 1)], lengths[i & (RECORDS_MAX - 1)], &got) || !same(&got, &want);
+    }
+    start = bench_now();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        for (uint32_t i = 0; i < RECORDS_MAX; i++)
+        {
+            pfun(records[i], lengths[i], &got);
+            bench_consume(&got);
+        }
+    }
+    return (bench_now() - start) / ((double)rounds * RECORDS_MAX);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t n = (argc > 1) ? (uint32_t)strtoul(argv[1], 0, 0) : 1000000;
+    double t_text;
+    double t_kv;
+    double p_sscanf;
+    double p_strtol;
+    double p_kv;
+    uint64_t b_text;
+    uint64_t b_kv;
+    uint32_t e_sscanf;
+    uint32_t e_strtol;
+    uint32_t e_kv;
+
+    n = (n < RECORDS_MAX) ? RECORDS_MAX : n & ~(uint32_t)(RECORDS_MAX - 1);
+    flogs_init(sink);
+
+    count = 0;
+    bytes = 0;
+    t_text = encode_text(n) * 1e9 / n;
+    b_text = bytes;
+    p_sscanf = parse(parse_sscanf, n, &e_sscanf) * 1e9;
+    p_strtol = parse(parse_strtol, n, &e_strtol) * 1e9;
+
+    count = 0;
+    bytes = 0;
+    t_kv = encode_kv(n) * 1e9 / n;
+    b_kv = bytes;
+    p_kv = parse(parse_kv, n, &e_kv) * 1e9;
+
+    printf("%-14s %12s %12s %12s %12s %8s\n", "path", "encode ns", "parse ns", "total ns", "bytes/rec", "errors");
+    printf("%-14s %12.1f %12.1f %12.1f %12.1f %8u\n", "text + sscanf", t_text, p_sscanf, t_text + p_sscanf, (double)b_text / n, e_sscanf);
+    printf("%-14s %12.1f %12.1f %12.1f %12.1f %8u\n", "text + strtol", t_text, p_strtol, t_text + p_strtol, (double)b_text / n, e_strtol);
+    printf("%-14s %12.1f %12.1f %12.1f %12.1f %8u\n", MODE, t_kv, p_kv, t_kv + p_kv, (double)b_kv / n, e_kv);
+    return (e_sscanf | e_strtol | e_kv) ? 1 : 0;
+}
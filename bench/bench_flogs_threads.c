@@ -0,0 +1,137 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: bench/bench_flogs_threads.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: 同步 flogs 多线程扩展性
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 用法：bench_flogs_threads | bench_flogs_locked [每线程记录数] [最大线程数]
+ * 线程数从 1 开始逐次加倍，每个线程在同步模式下输出指定条数的记录，输出函数只累计字节数；
+ * bench_flogs_threads 定义 FFMT_THREAD_SAFE，每个线程使用独立的格式化缓冲区，
+ * bench_flogs_locked 使用全局缓冲区，按之前的用法以全局锁保护每次调用
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "bench.h"
+#include "utl_flogs.h"
+
+#define THREADS_MAX 64
+
+#ifdef FFMT_THREAD_SAFE
+#define MODE "per-thread"
+#else
+#define MODE "locked"
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static uint32_t records = 200000;
+
+/// @brief 输出函数，在调用者线程中只累计字节数
+static void sink(char *buffer, uint32_t size)
+{
+    static __thread uint64_t bytes;
+
+    bench_consume(buffer);
+    bytes += size;
+    bench_consume(&bytes);
+}
+
+static void *writer(void *arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+
+    for (uint32_t i = 0; i < records; i++)
+    {
+#ifndef FFMT_THREAD_SAFE
+        pthread_mutex_lock(&log_lock);
+#endif
+        FLOGI("bench", "id=%u i=%u v=%d lat=%f", id, i, (int32_t)(i * 2654435761u), (int32_t)i << 4);
+#ifndef FFMT_THREAD_SAFE
+        pthread_mutex_unlock(&log_lock);
+#endif
+    }
+    return 0;
+}
+
+/// @brief 以指定线程数运行一轮
+/// @return 耗时（秒）
+static double run(uint32_t threads)
+{
+    pthread_t tid[THREADS_MAX];
+    double start = bench_now();
+
+    for (uint32_t i = 0; i < threads; i++)
+    {
+        pthread_create(&tid[i], 0, writer, (void *)(uintptr_t)i);
+    }
+    for (uint32_t i = 0; i < threads; i++)
+    {
+        pthread_join(tid[i], 0);
+    }
+    return bench_now() - start;
+}
+
+int main(int argc, char *argv[])
+{
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t max_threads;
+    double base = 0;
+    double rate;
+
+    online = (online > 0) ? online : 1;
+    max_threads = (uint32_t)online;
+    records = (argc > 1) ? (uint32_t)strtoul(argv[1], 0, 0) : records;
+    max_threads = (argc > 2) ? (uint32_t)strtoul(argv[2], 0, 0) : max_threads;
+    if ((records == 0) || (max_threads == 0) || (max_threads > THREADS_MAX))
+    {
+        printf("usage: %s [records per thread] [max threads 1..%d]\n", argv[0], THREADS_MAX);
+        return 1;
+    }
+
+    flogs_init(sink);
+    // 线程数超过在线 CPU 数时按 CPU 数计算每核效率
+    printf("%-12s %8s %14s %10s %10s\n", "mode", "threads", "records/s", "speedup", "per core");
+    for (uint32_t threads = 1;; threads *= 2)
+    {
+        threads = (threads > max_threads) ? max_threads : threads;
+        rate = (double)records * threads / run(threads);
+        base = (threads == 1) ? rate : base;
+        printf("%-12s %8u %14.0f %9.2fx %9.0f%%\n", MODE, threads, rate, rate / base,
+               rate / base / (((long)threads < online) ? (long)threads : online) * 100);
+        if (threads == max_threads)
+        {
+            break;
+        }
+    }
+    printf("online CPUs: %ld\n", online);
+    return 0;
+}
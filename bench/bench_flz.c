@@ -0,0 +1,234 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: bench/bench_flz.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: flz 压缩 flogs 文本日志的吞吐量与压缩率
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 用法：bench_flz [记录数]
+ * 先通过 flogs 生成文本日志（导航、网络、电源、错误、状态切换等记录混合），再与 FLOG_COMPRESS
+ * 相同地把整条记录装入块（记录不跨块），分别以 FLOG_COMPRESS_BLOCK 与 FLZ_BLOCK_MAX_SIZE（64 KiB
+ * 块长度字段的上限）为块长度成帧（flz_frame）并解帧（flz_unframe），解帧结果与原文比较
+ * 输出每种块长度的帧数、压缩率（原文 / 帧总长，含帧头与帧尾）与压缩、解压的 MB/s（按原文字节计）
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "utl_flogs.h"
+#include "utl_flz.h"
+
+#define ROUNDS 5
+
+static const char *states[] = {"idle", "align", "nav", "hold", "fault"};
+static const char *peers[] = {"10.0.0.1", "gateway", "192.168.100.254", "imu"};
+
+static uint8_t *corpus;
+static uint32_t corpus_len;
+static uint16_t *lengths;
+static uint32_t records;
+
+static uint8_t *frames;
+static uint8_t *unpacked;
+
+/// @brief 按记录保存到语料中
+static void sink(char *buffer, uint32_t size)
+{
+	memcpy(corpus + corpus_len, buffer, size);
+	corpus_len += size;
+	lengths[records++] = (uint16_t)size;
+}
+
+/// @brief 生成第 i 条记录，字段随时间缓慢变化，与实际设备日志相近
+static void generate(uint32_t i)
+{
+	uint32_t r = i * 2654435761u;
+
+	switch (r >> 28)
+	{
+	case 0:
+	case 1:
+	case 2:
+	case 3:
+	case 4:
+	case 5:
+	case 6:
+		FLOGI("nav", "fix=%u sats=%d lat=%f lon=%f alt=%f", i / 10, (int32_t)(12 + (i >> 9) % 8), (int32_t)(128082 + (i >> 3)), (int32_t)(497541 - (i >> 4)), (int32_t)(180000 + (r & 0xFFF)));
+		break;
+	case 7:
+	case 8:
+	case 9:
+	case 10:
+		FLOGI("net", "rx id=%u len=%d rssi=%f peer=%s", i, (int32_t)(64 + (r >> 20) % 1400), -(int32_t)((r >> 8) % (100 << 12)), peers[(r >> 4) & 3]);
+		break;
+	case 11:
+	case 12:
+		FLOGW("pwr", "bat=%f temp=%d load=%u%%", (int32_t)((12 << 12) - (i >> 6)), (int32_t)(35 + (r >> 26)), (r >> 8) % 100);
+		break;
+	case 13:
+		FLOGE("imu", "read timeout addr=0x%x code=%d retry=%u", 0x68u + ((r >> 12) & 1), -110, (r >> 16) & 3);
+		break;
+	default:
+		FLOGI("ctl", "state %s -> %s after %u ms", states[(i >> 7) % 5], states[((i >> 7) + 1) % 5], (r >> 12) % 5000);
+		break;
+	}
+}
+
+/// @brief 按块长度装入整条记录后成帧，与 flogs_sink 的分块规则相同
+/// @return 帧总长
+static uint32_t compress(uint32_t block, uint32_t *count)
+{
+	static flz_state_t state;
+	uint32_t start = 0;
+	uint32_t size = 0;
+	uint32_t out = 0;
+	int32_t ret;
+
+	*count = 0;
+	for (uint32_t i = 0; i <= records; i++)
+	{
+		if ((i < records) && (size + lengths[i] <= block))
+		{
+			size += lengths[i];
+			continue;
+		}
+		ret = flz_frame(&state, corpus + start, size, frames + out, FLZ_FRAME_BOUND(size));
+		if (ret < 0)
+		{
+			printf("flz_frame error %d\n", ret);
+			exit(1);
+		}
+		out += (uint32_t)ret;
+		(*count)++;
+		start += size;
+		size = (i < records) ? lengths[i] : 0;
+	}
+	return out;
+}
+
+/// @brief 依次解出全部帧
+/// @return 解出的原文长度
+static uint32_t decompress(uint32_t len)
+{
+	uint32_t pos = 0;
+	uint32_t out = 0;
+	uint32_t used;
+	int32_t ret;
+
+	while (pos < len)
+	{
+		ret = flz_unframe(frames + pos, len - pos, unpacked + out, FLZ_BLOCK_MAX_SIZE, &used);
+		if (ret < 0)
+		{
+			printf("flz_unframe error %d at %u\n", ret, pos);
+			exit(1);
+		}
+		out += (uint32_t)ret;
+		pos += used;
+	}
+	return out;
+}
+
+static void run(uint32_t block)
+{
+	double best_c = 1e30;
+	double best_d = 1e30;
+	double elapsed;
+	uint32_t framed = 0;
+	uint32_t count = 0;
+
+	for (uint32_t round = 0; round < ROUNDS; round++)
+	{
+		elapsed = bench_now();
+		framed = compress(block, &count);
+		elapsed = bench_now() - elapsed;
+		best_c = (elapsed < best_c) ? elapsed : best_c;
+
+		memset(unpacked, 0, corpus_len);
+		elapsed = bench_now();
+		if (decompress(framed) != corpus_len)
+		{
+			printf("block %u: length mismatch\n", block);
+			exit(1);
+		}
+		elapsed = bench_now() - elapsed;
+		best_d = (elapsed < best_d) ? elapsed : best_d;
+		if (memcmp(unpacked, corpus, corpus_len) != 0)
+		{
+			printf("block %u: data mismatch\n", block);
+			exit(1);
+		}
+		bench_consume(unpacked);
+	}
+	printf("%-8u %10u %8.2f %14.1f %16.1f\n", block, count, (double)corpus_len / framed,
+		   corpus_len / best_c / 1e6, corpus_len / best_d / 1e6);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t count = (argc > 1) ? (uint32_t)strtoul(argv[1], 0, 0) : 200000;
+
+	if ((count == 0) || (count > 8000000))
+	{
+		printf("usage: bench_flz [1..8000000 records]\n");
+		return 1;
+	}
+	corpus = malloc((size_t)count * LOG_BUFFER_MAX_SIZE);
+	lengths = malloc((size_t)count * sizeof(lengths[0]));
+	if ((corpus == 0) || (lengths == 0))
+	{
+		printf("out of memory\n");
+		return 1;
+	}
+	flogs_init(sink);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		generate(i);
+	}
+	// 每块最多增加帧头与帧尾
+	frames = malloc((size_t)corpus_len + (size_t)records * (FLZ_FRAME_HEAD + FLZ_FRAME_TAIL) + FLZ_FRAME_HEAD + FLZ_FRAME_TAIL);
+	unpacked = malloc((size_t)corpus_len + FLZ_BLOCK_MAX_SIZE);
+	if ((frames == 0) || (unpacked == 0))
+	{
+		printf("out of memory\n");
+		return 1;
+	}
+
+	printf("corpus: %u records, %u bytes, %.1f bytes/record\n", records, corpus_len, (double)corpus_len / records);
+	printf("block        frames    ratio  compress MB/s  decompress MB/s\n");
+	run(FLOG_COMPRESS_BLOCK);
+	run(FLZ_BLOCK_MAX_SIZE);
+
+	free(unpacked);
+	free(frames);
+	free(lengths);
+	free(corpus);
+	return 0;
+}
@@ -0,0 +1,179 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: bench/bench_fnmea_frame.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: fnmea_frame 批量定位与校验吞吐量
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 用法：bench_fnmea_frame [MB 数] [轮数]
+ * 对同一份生成的日志分别用 fnmea_frame（SSE2 / SWAR）与逐字节查找分隔符并累计异或的标量实现
+ * 定位并校验全部语句，输出 GB/s 与语句数（两者应相同）
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "bench_nmea.h"
+#include "utl_fnmea.h"
+
+#define SPANS 1024
+
+static fnmea_span_t spans[SPANS];
+
+/// @brief 十六进制字符转数值，非十六进制字符时为 -1
+static int hex(char c)
+{
+	if ((c >= '0') && (c <= '9'))
+	{
+		return c - '0';
+	}
+	if ((c >= 'A') && (c <= 'F'))
+	{
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+/// @brief 标量实现：逐字节查找 '$'、'*' 与换行，逐字节累计异或
+static uint32_t scalar_frame(const char *buf, uint32_t len, fnmea_span_t *out, uint32_t max_spans, uint32_t *used)
+{
+	uint32_t count = 0;
+	uint32_t pos = 0;
+	uint32_t start;
+	uint8_t sum;
+	int high;
+	int low;
+
+	while (count < max_spans)
+	{
+		while ((pos < len) && (buf[pos] != '$'))
+		{
+			pos++;
+		}
+		if (pos == len)
+		{
+			break;
+		}
+		start = pos++;
+		sum = 0;
+		while ((pos < len) && (pos - start < FNMEA_BUFFER_MAX_SIZE) && (buf[pos] != '*') && (buf[pos] != '$') &&
+			   (buf[pos] != '\n'))
+		{
+			sum ^= (uint8_t)buf[pos++];
+		}
+		if ((pos == len) || ((buf[pos] == '*') && (pos + 3 > len)))
+		{
+			pos = start;
+			break;
+		}
+		if (buf[pos] != '*')
+		{
+			continue;
+		}
+		high = hex(buf[pos + 1]);
+		low = hex(buf[pos + 2]);
+		pos += 3;
+		if ((high < 0) || (low < 0) || (sum != (uint8_t)((high << 4) | low)))
+		{
+			continue;
+		}
+		out[count].offset = start;
+		out[count].length = pos - start;
+		count++;
+	}
+	*used = pos;
+	return count;
+}
+
+/// @brief 定位整个数据中的语句
+/// @return 通过校验的语句数
+static uint64_t frame_all(uint32_t (*pfun)(const char *, uint32_t, fnmea_span_t *, uint32_t, uint32_t *),
+						  const char *buf, uint64_t len)
+{
+	uint64_t total = 0;
+	uint64_t pos = 0;
+	uint32_t count;
+	uint32_t used;
+
+	while (pos < len)
+	{
+		count = pfun(buf + pos, (uint32_t)(((len - pos) > (1u << 30)) ? (1u << 30) : (len - pos)), spans, SPANS, &used);
+		bench_consume(spans);
+		total += count;
+		if ((count < SPANS) || (used == 0))
+		{
+			break;
+		}
+		pos += used;
+	}
+	return total;
+}
+
+int main(int argc, char *argv[])
+{
+	uint64_t size = ((argc > 1) ? strtoull(argv[1], 0, 0) : 64) << 20;
+	uint32_t rounds = (argc > 2) ? (uint32_t)strtoul(argv[2], 0, 0) : 5;
+	uint64_t len;
+	uint64_t n_frame = 0;
+	uint64_t n_scalar = 0;
+	double t_frame = 0;
+	double t_scalar = 0;
+	double start;
+	char *buf;
+
+	buf = (char *)malloc((size_t)size);
+	if ((buf == 0) || (rounds == 0))
+	{
+		return 1;
+	}
+	len = bench_nmea_fill(buf, size, 0);
+
+	for (uint32_t r = 0; r < rounds; r++)
+	{
+		start = bench_now();
+		n_frame = frame_all(fnmea_frame, buf, len);
+		t_frame += bench_now() - start;
+		start = bench_now();
+		n_scalar = frame_all(scalar_frame, buf, len);
+		t_scalar += bench_now() - start;
+	}
+
+	printf("%-12s %12s %10s %14s\n", "scan", "sentences", "GB/s", "sentences/s");
+#ifdef __SSE2__
+	printf("%-12s", "fnmea sse2");
+#else
+	printf("%-12s", "fnmea swar");
+#endif
+	printf(" %12llu %10.2f %14.0f\n", (unsigned long long)n_frame, len * rounds / t_frame / 1e9, n_frame * rounds / t_frame);
+	printf("%-12s %12llu %10.2f %14.0f\n", "scalar", (unsigned long long)n_scalar, len * rounds / t_scalar / 1e9,
+		   n_scalar * rounds / t_scalar);
+	printf("speedup: %.2fx\n", t_scalar / t_frame);
+	free(buf);
+	return (n_frame == n_scalar) ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: bench/bench_fnmea_streams.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: fnmea 多数据流并行解析扩展性
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 用法：bench_fnmea_streams [每个数据流的 MB 数] [最大线程数]
+ * 每个线程模拟一个接收机：使用独立的解析上下文与独立的数据副本，以 fnmea_feed_n 流式解析，
+ * 线程数从 1 开始逐次加倍，输出总吞吐量、语句数与相对单线程的加速比
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "bench_nmea.h"
+#include "utl_fnmea.h"
+
+#define THREADS_MAX 64
+// 每次输入的字节数，模拟串口接收缓冲区
+#define FEED_SIZE 4096
+
+/// @brief 一个接收机
+typedef struct
+{
+	pthread_t tid;
+	char *data;
+	uint64_t len;
+	uint32_t sentences;
+	uint32_t errors;
+} stream_t;
+
+static stream_t streams[THREADS_MAX];
+
+static void *receiver(void *arg)
+{
+	stream_t *s = (stream_t *)arg;
+	fnmea_ctx_t ctx;
+	uint64_t pos;
+	uint64_t n;
+
+	fnmea_init(&ctx, 0, 0);
+	for (pos = 0; pos < s->len; pos += n)
+	{
+		n = ((s->len - pos) > FEED_SIZE) ? FEED_SIZE : (s->len - pos);
+		fnmea_feed_n(&ctx, (const uint8_t *)s->data + pos, (uint32_t)n);
+	}
+	bench_consume(&ctx.nmea);
+	s->sentences = ctx.sentences;
+	s->errors = ctx.errors;
+	return 0;
+}
+
+/// @brief 以指定线程数运行一轮
+/// @return 耗时（秒）
+static double run(uint32_t threads)
+{
+	double start = bench_now();
+
+	for (uint32_t i = 0; i < threads; i++)
+	{
+		pthread_create(&streams[i].tid, 0, receiver, &streams[i]);
+	}
+	for (uint32_t i = 0; i < threads; i++)
+	{
+		pthread_join(streams[i].tid, 0);
+	}
+	return bench_now() - start;
+}
+
+int main(int argc, char *argv[])
+{
+	long online = sysconf(_SC_NPROCESSORS_ONLN);
+	uint64_t size = ((argc > 1) ? strtoull(argv[1], 0, 0) : 32) << 20;
+	uint32_t max_threads;
+	uint32_t sentences;
+	double base = 0;
+	double elapsed;
+	double rate;
+
+	online = (online > 0) ? online : 1;
+	max_threads = (argc > 2) ? (uint32_t)strtoul(argv[2], 0, 0) : (uint32_t)online;
+	if ((size == 0) || (max_threads == 0) || (max_threads > THREADS_MAX))
+	{
+		printf("usage: %s [MB per stream] [max threads 1..%d]\n", argv[0], THREADS_MAX);
+		return 1;
+	}
+	for (uint32_t i = 0; i < max_threads; i++)
+	{
+		streams[i].data = (char *)malloc((size_t)size);
+		if (streams[i].data == 0)
+		{
+			return 1;
+		}
+		streams[i].len = bench_nmea_fill(streams[i].data, size, 0);
+	}
+
+	// 预热一轮，之后线程数超过在线 CPU 数时按 CPU 数计算每核效率
+	run(1);
+	printf("%8s %10s %14s %10s %10s %8s\n", "threads", "MB/s", "sentences/s", "speedup", "per core", "errors");
+	for (uint32_t threads = 1;; threads *= 2)
+	{
+		threads = (threads > max_threads) ? max_threads : threads;
+		elapsed = run(threads);
+		sentences = 0;
+		for (uint32_t i = 0; i < threads; i++)
+		{
+			sentences += streams[i].sentences;
+		}
+		rate = (double)streams[0].len * threads / elapsed;
+		base = (threads == 1) ? rate : base;
+		printf("%8u %10.1f %14.0f %9.2fx %9.0f%% %8u\n", threads, rate / 1e6, sentences / elapsed, rate / base,
+			   rate / base / (((long)threads < online) ? (long)threads : online) * 100, streams[0].errors);
+		if (threads == max_threads)
+		{
+			break;
+		}
+	}
+	printf("online CPUs: %ld\n", online);
+	for (uint32_t i = 0; i < max_threads; i++)
+	{
+		free(streams[i].data);
+	}
+	return 0;
+}
@@ -0,0 +1,123 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: bench/bench_fnmea_tokens.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: fnmea 整条语句解析（一次扫描字段）与逐字节流式解析对比
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 用法：bench_fnmea_tokens [次数]
+ * 每种语句分别用 fnmea_parse（一次扫描记录全部字段位置，只解码用到的字段）、
+ * fnmea_parse_span（同上，不重复校验）与 fnmea_feed_n（逐字节状态机）解析，输出 ns/条；
+ * 自定义语句只读取最后一个字段，体现按位置随机访问字段的开销
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "bench_nmea.h"
+#include "utl_fnmea.h"
+
+static const char *const bodies[] = {
+	"$GPGGA,123519.00,4807.03812,N,01131.00045,E,1,08,0.9,545.4,M,46.9,M,,",
+	"$GPRMC,123519.00,A,4807.03812,N,01131.00045,E,022.4,084.4,230394,003.1,W",
+	"$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1",
+	"$GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00",
+	"$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K",
+	"$PBNCH,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22",
+};
+
+static uint32_t field_sum;
+
+/// @brief 只读取最后一个字段
+static FNMEA_Error_Type last_field(fnmea_ctx_t *ctx, const char *sentence, const fnmea_tokens_t *tokens)
+{
+	fnmea_field_t field;
+
+	(void)ctx;
+	fnmea_token_field(sentence, tokens, (uint8_t)(tokens->count - 1), &field);
+	field_sum += field.integer;
+	return FNMEA_Error_None;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t iterations = (argc > 1) ? (uint32_t)strtoul(argv[1], 0, 0) : 2000000;
+	fnmea_registry_t registry;
+	fnmea_ctx_t ctx;
+	fnmea_span_t span;
+	char text[160];
+	uint32_t len;
+	double t_parse;
+	double t_span;
+	double t_feed;
+	double start;
+
+	fnmea_registry_init(&registry);
+	fnmea_register(&registry, "PBNCH", last_field);
+	printf("%-8s %6s %12s %12s %12s %8s\n", "sentence", "bytes", "parse ns", "span ns", "feed ns", "speedup");
+	for (uint32_t s = 0; s < sizeof(bodies) / sizeof(bodies[0]); s++)
+	{
+		len = (uint32_t)bench_nmea_append(text, 0, sizeof(text), bodies[s]);
+		span.offset = 0;
+		span.length = len - 2;
+		fnmea_init(&ctx, 0, 0);
+		fnmea_set_registry(&ctx, &registry);
+
+		start = bench_now();
+		for (uint32_t i = 0; i < iterations; i++)
+		{
+			fnmea_parse(&ctx, text, len);
+			bench_consume(&ctx.nmea);
+		}
+		t_parse = bench_now() - start;
+
+		start = bench_now();
+		for (uint32_t i = 0; i < iterations; i++)
+		{
+			fnmea_parse_span(&ctx, text, &span);
+			bench_consume(&ctx.nmea);
+		}
+		t_span = bench_now() - start;
+
+		// 流式解析不处理自定义语句
+		start = bench_now();
+		for (uint32_t i = 0; i < iterations; i++)
+		{
+			fnmea_feed_n(&ctx, (const uint8_t *)text, len);
+			bench_consume(&ctx.nmea);
+		}
+		t_feed = bench_now() - start;
+
+		printf("%-8.5s %6u %12.1f %12.1f %12.1f %7.2fx\n", bodies[s] + 1, len, t_parse * 1e9 / iterations,
+			   t_span * 1e9 / iterations, t_feed * 1e9 / iterations, t_feed / t_parse);
+	}
+	printf("custom field sum: %u\n", field_sum);
+	return 0;
+}
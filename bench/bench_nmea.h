@@ -0,0 +1,112 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: bench/bench_nmea.h
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: 性能测试用 NMEA 日志生成
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef __BENCH_NMEA_H__
+#define __BENCH_NMEA_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+/// @brief 追加一条语句，补上校验和与 "\r\n"
+/// @param buf 缓冲区
+/// @param pos 写入位置
+/// @param size 缓冲区大小
+/// @param body 语句（从 '$' 开始，不含 '*'）
+/// @return 写入后的位置，空间不足时不写入
+static inline uint64_t bench_nmea_append(char *buf, uint64_t pos, uint64_t size, const char *body)
+{
+	char line[128];
+	uint8_t sum = 0;
+	int len;
+
+	for (const char *c = body + 1; *c != '\0'; c++)
+	{
+		sum ^= (uint8_t)*c;
+	}
+	len = snprintf(line, sizeof(line), "%s*%02X\r\n", body, sum);
+	if ((len <= 0) || (pos + (uint64_t)len > size))
+	{
+		return pos;
+	}
+	for (int i = 0; i < len; i++)
+	{
+		buf[pos + (uint64_t)i] = line[i];
+	}
+	return pos + (uint64_t)len;
+}
+
+/// @brief 生成 10 Hz 接收机日志：每个历元 GGA、GSA、3 条 GSV、RMC、VTG
+/// @param buf 缓冲区
+/// @param size 缓冲区大小
+/// @param epochs 输出的历元数，可为 NULL
+/// @return 数据长度（只包含完整的历元）
+static inline uint64_t bench_nmea_fill(char *buf, uint64_t size, uint32_t *epochs)
+{
+	char body[128];
+	char time[16];
+	uint64_t pos = 0;
+	uint64_t next;
+	uint32_t e;
+
+	for (e = 0;; e++)
+	{
+		uint32_t cs = (4500000 + e * 10) % 8640000;
+
+		next = pos;
+		snprintf(time, sizeof(time), "%02u%02u%02u.%02u", cs / 360000, cs / 6000 % 60, cs / 100 % 60, cs % 100);
+		snprintf(body, sizeof(body), "$GPGGA,%s,48%02u.%05u,N,011%02u.%05u,E,1,%02u,0.9,%u.%u,M,46.9,M,,", time,
+				 e % 60, (e * 37) % 100000, (e / 7) % 60, (e * 91) % 100000, 6 + e % 12, 500 + e % 97, e % 10);
+		next = bench_nmea_append(buf, next, size, body);
+		next = bench_nmea_append(buf, next, size, "$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1");
+		next = bench_nmea_append(buf, next, size, "$GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00");
+		next = bench_nmea_append(buf, next, size, "$GPGSV,3,2,11,14,25,170,00,16,57,208,39,18,67,296,40,19,40,246,00");
+		next = bench_nmea_append(buf, next, size, "$GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00,,,,");
+		snprintf(body, sizeof(body), "$GPRMC,%s,A,48%02u.%05u,N,011%02u.%05u,E,%03u.%u,%03u.%u,230394,003.1,W", time,
+				 e % 60, (e * 37) % 100000, (e / 7) % 60, (e * 91) % 100000, e % 200, e % 10, e % 360, e % 10);
+		next = bench_nmea_append(buf, next, size, body);
+		snprintf(body, sizeof(body), "$GPVTG,%03u.%u,T,034.4,M,005.5,N,010.2,K", e % 360, e % 10);
+		next = bench_nmea_append(buf, next, size, body);
+		// 空间不足以容纳完整的历元时结束
+		if (next + 128 > size)
+		{
+			break;
+		}
+		pos = next;
+	}
+	if (epochs != 0)
+	{
+		*epochs = e;
+	}
+	return pos;
+}
+
+#endif
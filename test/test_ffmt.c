@@ -0,0 +1,337 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: test/test_ffmt.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: ffmt 与 libc snprintf 差分测试
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 每个说明符的期望输出由 snprintf 按 utl_ffmt.h 中列出的差异换算得到：
+ * [d] [u] -> %d %u，[x] -> %02X / %04X / %08X，[f] -> %.12f 截断到 5 位小数
+ * （fq12 的值 n / 4096 可用 double 精确表示，%.12f 的输出是精确值）
+ * [F] -> 检查能否往返，且有效数字不多于最短的 %.*g
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "utl_ffmt.h"
+
+static int failures;
+static int cases;
+
+#define CHECK(expr)                                                         \
+	do                                                                      \
+	{                                                                       \
+		if (!(expr))                                                        \
+		{                                                                   \
+			printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+			failures++;                                                     \
+		}                                                                   \
+	} while (0)
+
+/// @brief 边界值，其余测试值由伪随机数补充
+static const int32_t edge[] = {
+	0, 1, -1, 9, 10, -10, 99, 100, 127, 128, 255, 256, 999, 1000, 4095, 4096, 4097,
+	9999, 10000, 32767, 32768, 65535, 65536, 99999, 100000, 999999, 1000000,
+	9999999, 10000000, 99999999, 100000000, 999999999, 1000000000,
+	-4095, -4096, -4097, -32768, -65536, -1000000000,
+	INT32_MAX, INT32_MAX - 1, INT32_MIN, INT32_MIN + 1,
+};
+
+#define RANDOM_COUNT 20000
+
+/// @brief 测试值：边界值之后接伪随机数（固定种子，结果可复现）
+static int32_t value(uint32_t i)
+{
+	static uint32_t seed = 12345;
+
+	if (i < sizeof(edge) / sizeof(edge[0]))
+	{
+		return edge[i];
+	}
+	seed = seed * 1103515245u + 12345u;
+	// 交替使用完整 32 位与较短的数值，覆盖不同位数
+	return (int32_t)((i & 1) ? seed : (seed >> (seed & 31)));
+}
+
+/// @brief 比较一条输出，失败时打印格式化字符串与两侧结果
+static void compare(const char *fmt, const char *got, int32_t ret, const char *want)
+{
+	cases++;
+	if ((strcmp(got, want) != 0) || (ret != (int32_t)strlen(want) + 1))
+	{
+		if (failures < 20)
+		{
+			printf("\"%s\": ffmt \"%s\" (%d), expected \"%s\"\n", fmt, got, ret, want);
+		}
+		failures++;
+	}
+}
+
+/// @brief fq12 的期望输出：%.12f 精确值截断到 5 位小数
+static void fq12_expect(char *want, size_t size, int32_t num, bool plus)
+{
+	char *dot;
+
+	snprintf(want, size, plus ? "%+.12f" : "%.12f", (double)num / 4096.0);
+	dot = strchr(want, '.');
+	dot[6] = '\0';
+}
+
+/// @brief 数值说明符
+static void test_numbers(void)
+{
+	char got[64];
+	char want[64];
+	int32_t ret;
+	int32_t v;
+
+	for (uint32_t i = 0; i < sizeof(edge) / sizeof(edge[0]) + RANDOM_COUNT; i++)
+	{
+		v = value(i);
+
+		ret = ffmt(got, sizeof(got), false, "%d", v);
+		snprintf(want, sizeof(want), "%d", v);
+		compare("%d", got, ret, want);
+		ret = ffmt(got, sizeof(got), false, "%+d", v);
+		snprintf(want, sizeof(want), "%+d", v);
+		compare("%+d", got, ret, want);
+		ret = ffmt(got, sizeof(got), false, "%ld", v);
+		snprintf(want, sizeof(want), "%d", v);
+		compare("%ld", got, ret, want);
+
+		ret = ffmt(got, sizeof(got), false, "%u", (uint32_t)v);
+		snprintf(want, sizeof(want), "%u", (uint32_t)v);
+		compare("%u", got, ret, want);
+		ret = ffmt(got, sizeof(got), false, "%lu", (uint32_t)v);
+		compare("%lu", got, ret, want);
+
+		ret = ffmt(got, sizeof(got), false, "%hx", (uint32_t)v);
+		snprintf(want, sizeof(want), "%02X", (uint32_t)v & 0xFF);
+		compare("%hx", got, ret, want);
+		ret = ffmt(got, sizeof(got), false, "%x", (uint32_t)v);
+		snprintf(want, sizeof(want), "%04X", (uint32_t)v & 0xFFFF);
+		compare("%x", got, ret, want);
+		ret = ffmt(got, sizeof(got), false, "%lx", (uint32_t)v);
+		snprintf(want, sizeof(want), "%08X", (uint32_t)v);
+		compare("%lx", got, ret, want);
+
+		ret = ffmt(got, sizeof(got), false, "%f", v);
+		fq12_expect(want, sizeof(want), v, false);
+		compare("%f", got, ret, want);
+		ret = ffmt(got, sizeof(got), false, "%+f", v);
+		fq12_expect(want, sizeof(want), v, true);
+		compare("%+f", got, ret, want);
+
+		// 转换函数不追加 '\0'，输出与对应说明符相同
+		got[ffmt_itoa(got, v)] = '\0';
+		snprintf(want, sizeof(want), "%d", v);
+		compare("ffmt_itoa", got, (int32_t)strlen(got) + 1, want);
+		got[ffmt_utoa(got, (uint32_t)v)] = '\0';
+		snprintf(want, sizeof(want), "%u", (uint32_t)v);
+		compare("ffmt_utoa", got, (int32_t)strlen(got) + 1, want);
+		got[ffmt_fq12toa(got, v)] = '\0';
+		fq12_expect(want, sizeof(want), v, false);
+		compare("ffmt_fq12toa", got, (int32_t)strlen(got) + 1, want);
+	}
+}
+
+/// @brief 字符串、字节数组与混合格式
+static void test_strings(void)
+{
+	static const char *strs[] = {"", "a", "hello world", "100%", "tab\tnew\nline"};
+	static const uint8_t bytes[] = {0x00, 0x0A, 0x1B, 0xFF, 0x80, 0x7F};
+	char got[256];
+	char want[256];
+	int32_t ret;
+	uint32_t n;
+
+	for (uint32_t i = 0; i < sizeof(strs) / sizeof(strs[0]); i++)
+	{
+		ret = ffmt(got, sizeof(got), false, "<%s>", strs[i]);
+		snprintf(want, sizeof(want), "<%s>", strs[i]);
+		compare("<%s>", got, ret, want);
+	}
+
+	for (uint32_t len = 0; len <= sizeof(bytes); len++)
+	{
+		ret = ffmt(got, sizeof(got), false, "%m", bytes, len);
+		for (n = 0, want[0] = '\0'; n < len; n++)
+		{
+			snprintf(want + strlen(want), sizeof(want) - strlen(want), "%02X", bytes[n]);
+		}
+		compare("%m", got, ret, want);
+		ret = ffmt(got, sizeof(got), false, "%+m", bytes, len);
+		for (n = 0, want[0] = '\0'; n < len; n++)
+		{
+			snprintf(want + strlen(want), sizeof(want) - strlen(want), n ? " %02X" : "%02X", bytes[n]);
+		}
+		compare("%+m", got, ret, want);
+	}
+
+	ret = ffmt(got, sizeof(got), false, "%s: i=%d u=%u x=%lx f=%f 100%%", "main", -5, 4000000000u, 0xDEADBEEFu, 3 * 4096 + 2048);
+	snprintf(want, sizeof(want), "%s: i=%d u=%u x=%08X f=%s 100%%", "main", -5, 4000000000u, 0xDEADBEEFu, "3.50000");
+	compare("mixed", got, ret, want);
+}
+
+/// @brief 缓存长度边界：恰好容纳时成功，少 1 字节时返回 -1
+static void test_overflow(void)
+{
+	char got[32];
+	int32_t need;
+
+	need = ffmt_measure(false, "%s=%d", "key", -12345);
+	CHECK(need == (int32_t)sizeof("key=-12345"));
+	CHECK(ffmt(got, (uint32_t)need, false, "%s=%d", "key", -12345) == need);
+	CHECK(strcmp(got, "key=-12345") == 0);
+	CHECK(ffmt(got, (uint32_t)need - 1, false, "%s=%d", "key", -12345) == -1);
+}
+
+/// @brief 数组批量格式化与逐个 ffmt 拼接的结果相同
+static void test_array(void)
+{
+	static const char types[] = {'d', 'u', 'f'};
+	static char got[16384];
+	static char want[16384];
+	int32_t array[256];
+	char item[32];
+	char spec[3] = {'%', 0, 0};
+	uint32_t count = sizeof(array) / sizeof(array[0]);
+	int32_t ret;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		array[i] = value(i);
+	}
+	for (uint32_t t = 0; t < sizeof(types); t++)
+	{
+		spec[1] = types[t];
+		for (uint32_t cols = 0; cols <= 7; cols += 7)
+		{
+			want[0] = '\0';
+			for (uint32_t i = 0; i < count; i++)
+			{
+				ffmt(item, sizeof(item), false, spec, array[i]);
+				strcat(want, item);
+				strcat(want, (((cols != 0) && ((i + 1) % cols == 0)) || (i + 1 == count)) ? "\n" : ", ");
+			}
+			ret = ffmt_array(got, sizeof(got), array, count, cols, types[t], ", ", "\n");
+			compare(spec, got, ret, want);
+		}
+	}
+}
+
+#ifdef FFMT_DOUBLE
+/// @brief 统计有效数字位数（忽略符号、前导 0、小数点与指数）
+static uint32_t digits(const char *s)
+{
+	uint32_t n = 0;
+	uint32_t zeros = 0;
+	bool lead = true;
+
+	for (; (*s != '\0') && (*s != 'e'); s++)
+	{
+		if ((*s < '0') || (*s > '9'))
+		{
+			continue;
+		}
+		if (lead && (*s == '0'))
+		{
+			continue;
+		}
+		lead = false;
+		zeros = (*s == '0') ? zeros + 1 : 0;
+		n++;
+	}
+	return n - zeros;
+}
+
+/// @brief double 最短往返输出
+static void test_double(void)
+{
+	static const double values[] = {0.0, 1.0, -1.0, 0.1, 0.0001, 1e-5, 100.0, 1e16, 1.5e-5,
+									123456.789, 5e-324, 1.7976931348623157e308, 2.2250738585072014e-308};
+	char got[64];
+	char want[64];
+	uint64_t bits;
+	double v;
+	uint32_t p;
+
+	ffmt(got, sizeof(got), false, "%F %F %F %F %F", 0.0001, 100.0, 1e16, 1.5e-5, -0.0);
+	compare("%F", got, (int32_t)strlen(got) + 1, "0.0001 100.0 1e+16 1.5e-05 -0.0");
+
+	for (uint32_t i = 0; i < sizeof(values) / sizeof(values[0]) + RANDOM_COUNT; i++)
+	{
+		if (i < sizeof(values) / sizeof(values[0]))
+		{
+			v = values[i];
+		}
+		else
+		{
+			bits = ((uint64_t)(uint32_t)value(i) << 32) | (uint32_t)value(i);
+			memcpy(&v, &bits, sizeof(v));
+			if (v != v || v - v != 0)
+			{
+				continue;
+			}
+		}
+		ffmt(got, sizeof(got), false, "%F", v);
+		for (p = 1; p < 17; p++)
+		{
+			snprintf(want, sizeof(want), "%.*g", (int)p, v);
+			if (strtod(want, 0) == v)
+			{
+				break;
+			}
+		}
+		cases++;
+		if ((strtod(got, 0) != v) || (digits(got) > p))
+		{
+			if (failures < 20)
+			{
+				printf("\"%%F\": ffmt \"%s\", shortest \"%s\"\n", got, want);
+			}
+			failures++;
+		}
+	}
+}
+#endif
+
+int main(void)
+{
+	test_numbers();
+	test_strings();
+	test_overflow();
+	test_array();
+#ifdef FFMT_DOUBLE
+	test_double();
+#endif
+	printf("test_ffmt: %d cases, %s\n", cases, failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
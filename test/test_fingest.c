@@ -0,0 +1,208 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: test/test_fingest.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: fingest 分块并行导入测试
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ * 
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 使用小数据块（见 Makefile 中的 FINGEST_CHUNK_SIZE）编译，使大量历元跨越切分点，
+ * 导入结果与单个上下文顺序解析整个数据的历元逐行比较
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "utl_fingest.h"
+
+static int failures;
+
+#define CHECK(expr)                                                         \
+	do                                                                      \
+	{                                                                       \
+		if (!(expr))                                                        \
+		{                                                                   \
+			printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+			failures++;                                                     \
+		}                                                                   \
+	} while (0)
+
+#define EPOCHS 3000
+
+static char data[EPOCHS * 512];
+static uint32_t data_len;
+
+/// @brief 追加一条语句，补上校验和与 "\r\n"
+static void append(const char *body)
+{
+	uint8_t sum = 0;
+
+	for (const char *c = body + 1; *c != '\0'; c++)
+	{
+		sum ^= (uint8_t)*c;
+	}
+	data_len += (uint32_t)snprintf(data + data_len, sizeof(data) - data_len, "%s*%02X\r\n", body, sum);
+}
+
+/// @brief 生成 10 Hz 日志：每个历元 GGA、GSA、GSV、RMC、GLL，部分历元缺少 RMC，开头有不完整的语句
+static void generate(void)
+{
+	char body[FNMEA_BUFFER_MAX_SIZE];
+	char time[16];
+
+	data_len = (uint32_t)snprintf(data, sizeof(data), "1,A,4807.038,N*00\r\n");
+	for (uint32_t e = 0; e < EPOCHS; e++)
+	{
+		uint32_t cs = 4500000 + e * 10;
+
+		snprintf(time, sizeof(time), "%02u%02u%02u.%02u", cs / 360000, cs / 6000 % 60, cs / 100 % 60, cs % 100);
+		snprintf(body, sizeof(body), "$GPGGA,%s,48%02u.%03u,N,011%02u.%03u,E,1,08,0.9,%u.%u,M,46.9,M,,", time,
+				 e % 60, e % 1000, (e / 7) % 60, (e * 3) % 1000, 500 + e % 97, e % 10);
+		append(body);
+		append("$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1");
+		append("$GPGSV,2,1,08,01,40,083,46,02,17,308,41,12,07,344,39,14,22,228,45");
+		if (e % 5 != 3)
+		{
+			snprintf(body, sizeof(body), "$GPRMC,%s,A,48%02u.%03u,N,011%02u.%03u,E,%03u.%u,%03u.%u,230394,003.1,W", time,
+					 e % 60, e % 1000, (e / 7) % 60, (e * 3) % 1000, e % 200, e % 10, e % 360, e % 10);
+			append(body);
+		}
+		snprintf(body, sizeof(body), "$GPGLL,48%02u.%03u,N,011%02u.%03u,E,%s,A,A", e % 60, e % 1000, (e / 7) % 60,
+				 (e * 3) % 1000, time);
+		append(body);
+	}
+}
+
+static fingest_columns_t expect;
+
+/// @brief 顺序解析的历元回调，与 fingest 的列换算一致
+static void expect_row(fnmea_ctx_t *ctx, const fnmea_t *fix, uint32_t seen)
+{
+	uint64_t i = expect.count++;
+
+	(void)ctx;
+	(void)seen;
+	if (i < EPOCHS)
+	{
+		expect.time[i] = (((uint32_t)fix->utc_time.hour * 60 + fix->utc_time.min) * 60 + fix->utc_time.sec) * 1000 +
+						 fix->utc_time.msec;
+		expect.alt[i] = fix->locate.alti;
+		expect.speed[i] = fix->speed.speed_kph;
+		expect.course[i] = fix->angle.true_north;
+		expect.status[i] = (uint8_t)fix->staus;
+	}
+}
+
+/// @brief 单个上下文顺序解析整个数据
+static void sequential(void)
+{
+	fnmea_ctx_t ctx;
+
+	expect.time = calloc(EPOCHS, sizeof(*expect.time));
+	expect.alt = calloc(EPOCHS, sizeof(*expect.alt));
+	expect.speed = calloc(EPOCHS, sizeof(*expect.speed));
+	expect.course = calloc(EPOCHS, sizeof(*expect.course));
+	expect.status = calloc(EPOCHS, sizeof(*expect.status));
+	fnmea_init(&ctx, 0, 0);
+	fnmea_epoch_init(&ctx, expect_row, 0, 0);
+	fnmea_feed_n(&ctx, (const uint8_t *)data, data_len);
+	fnmea_epoch_flush(&ctx);
+}
+
+/// @brief 导入结果与顺序解析逐行相同，每个历元一行
+static void compare(const fingest_columns_t *cols)
+{
+	CHECK(cols->count == EPOCHS);
+	if (cols->count != EPOCHS)
+	{
+		return;
+	}
+	CHECK(memcmp(cols->time, expect.time, EPOCHS * sizeof(*cols->time)) == 0);
+	CHECK(memcmp(cols->alt, expect.alt, EPOCHS * sizeof(*cols->alt)) == 0);
+	CHECK(memcmp(cols->speed, expect.speed, EPOCHS * sizeof(*cols->speed)) == 0);
+	CHECK(memcmp(cols->course, expect.course, EPOCHS * sizeof(*cols->course)) == 0);
+	CHECK(memcmp(cols->status, expect.status, EPOCHS * sizeof(*cols->status)) == 0);
+	for (uint32_t i = 1; i < EPOCHS; i++)
+	{
+		if (cols->time[i] != cols->time[i - 1] + 100)
+		{
+			CHECK(cols->time[i] == cols->time[i - 1] + 100);
+			break;
+		}
+	}
+}
+
+static void test_buffer(void)
+{
+	static const uint32_t threads[] = {1, 2, 4, 0};
+	fingest_columns_t cols;
+
+	CHECK(data_len > 16 * FINGEST_CHUNK_SIZE);
+	CHECK(expect.count == EPOCHS);
+	for (uint32_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++)
+	{
+		CHECK(fingest_buffer(data, data_len, threads[i], &cols) == FINGEST_Error_None);
+		compare(&cols);
+		fingest_free(&cols);
+	}
+
+	CHECK(fingest_buffer(data, 0, 4, &cols) == FINGEST_Error_None);
+	CHECK(cols.count == 0);
+	CHECK(fingest_buffer(0, 0, 4, &cols) == FINGEST_Error_ArgsErr);
+}
+
+static void test_file(void)
+{
+	char path[] = "/tmp/test_fingest_XXXXXX";
+	fingest_columns_t cols;
+	int fd = mkstemp(path);
+
+	CHECK(fd >= 0);
+	if (fd < 0)
+	{
+		return;
+	}
+	CHECK(write(fd, data, data_len) == (ssize_t)data_len);
+	close(fd);
+	CHECK(fingest_file(path, 3, &cols) == FINGEST_Error_None);
+	compare(&cols);
+	fingest_free(&cols);
+	unlink(path);
+
+	CHECK(fingest_file(path, 3, &cols) == FINGEST_Error_Open);
+}
+
+int main(void)
+{
+	generate();
+	sequential();
+	test_buffer();
+	test_file();
+	printf("test_fingest: %s\n", failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
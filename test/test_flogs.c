@@ -0,0 +1,1018 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: test/test_flogs.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: flogs 各编译配置的行为测试
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 同一文件按不同的 FLOG_* 宏编译为多个测试程序（见 Makefile），
+ * 每个测试只在对应的功能开启时编译
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <string.h>
+#if FLOG_ASYNC || defined(FFMT_THREAD_SAFE)
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+#include "utl_flogs.h"
+#if FLOG_COMPRESS
+#include "utl_flz.h"
+#endif
+
+static int failures;
+
+#define CHECK(expr)                                                         \
+    do                                                                      \
+    {                                                                       \
+        if (!(expr))                                                        \
+        {                                                                   \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+#define RECORDS 64
+
+/// @brief 输出函数收到的内容
+static char output[1 << 16];
+static uint32_t output_len;
+
+static void sink(char *buffer, uint32_t size)
+{
+    if (output_len + size <= sizeof(output))
+    {
+        memcpy(output + output_len, buffer, size);
+        output_len += size;
+    }
+}
+
+static inline void reset(void)
+{
+    output_len = 0;
+}
+
+/// @brief 输出内容中是否含有指定文本（记录之间可能有 '\0'）
+static inline bool output_has(const char *text)
+{
+    uint32_t len = (uint32_t)strlen(text);
+
+    for (uint32_t i = 0; i + len <= output_len; i++)
+    {
+        if (memcmp(output + i, text, len) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+#if FLOG_RECORDER && !FLOG_RATE_LIMIT && !FLOG_COMPRESS
+/// @brief 记录中含有换行时，回绕后的导出仍从完整记录开始，且与直接输出的记录逐字节相同
+static void test_recorder_dump(void)
+{
+    static char records[RECORDS * 4][LOG_BUFFER_MAX_SIZE];
+    static uint32_t lengths[RECORDS * 4];
+    static char expect[1 << 16];
+    uint32_t count = RECORDS * 4;
+    uint32_t expect_len;
+    uint32_t i;
+    bool found = false;
+
+    // 全部记录都直接输出，用于得到每条记录的文本
+    flogs_set_live_level(LEVEL_SUCCESS);
+    for (i = 0; i < count; i++)
+    {
+        reset();
+        FLOGI("rec", "line %d\nsecond line\n\rthird %d", (int32_t)i, (int32_t)(i * 7));
+        CHECK(output_len > 0 && output_len <= LOG_BUFFER_MAX_SIZE);
+        // 输出长度不含结尾的 '\0'，与飞行记录仪中保存的内容相同
+        CHECK(output[output_len - 1] != '\0');
+        memcpy(records[i], output, output_len);
+        lengths[i] = output_len;
+    }
+    flogs_set_live_level(LEVEL_NONE);
+
+    reset();
+    flogs_dump();
+    CHECK(output_len > FLOG_RECORDER_SIZE / 2);
+    CHECK(output_len <= FLOG_RECORDER_SIZE);
+
+    // 导出内容应当恰好是最后若干条记录
+    for (i = count; i-- > 0 && !found;)
+    {
+        expect_len = 0;
+        for (uint32_t j = i; j < count; j++)
+        {
+            memcpy(expect + expect_len, records[j], lengths[j]);
+            expect_len += lengths[j];
+        }
+        found = (expect_len == output_len) && (memcmp(expect, output, output_len) == 0);
+    }
+    CHECK(found);
+    flogs_set_live_level(FLOG_RECORDER_LIVE);
+}
+#endif
+
+/// @brief 测试时钟（毫秒）
+static uint32_t clock_ms;
+
+static inline uint32_t clock_now(void)
+{
+    return clock_ms;
+}
+
+#if FLOG_RATE_LIMIT
+/// @brief 同一个限速调用点
+static void limited(uint32_t value)
+{
+    FLOGI("lim", "v=%u", value);
+}
+
+/// @brief 哈希相同但内容不同的记录不折叠；空闲后的计数提示不受直接输出等级过滤
+static void test_rate_limit(void)
+{
+    flogs_timestamp_init(clock_now, 1000);
+#if FLOG_RECORDER
+    flogs_set_live_level(LEVEL_SUCCESS);
+#endif
+
+    // "v=562388" 与 "v=779593" 的 FNV-1a 哈希相同
+    reset();
+    limited(562388);
+    limited(779593);
+    CHECK(output_has("v=562388"));
+    CHECK(output_has("v=779593"));
+
+    reset();
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        limited(779593);
+    }
+    CHECK(output_len == 0);
+
+#if FLOG_RECORDER
+    // 调用点等级低于直接输出等级，提示仍然输出
+    flogs_set_live_level(LEVEL_WARN);
+#endif
+    clock_ms += 2000;
+    CHECK(flogs_limit_poll() == 1);
+    CHECK(output_has("repeated 3 times"));
+#if FLOG_RECORDER
+    flogs_set_live_level(FLOG_RECORDER_LIVE);
+#endif
+}
+#endif
+
+#if FLOG_STATS
+/// @brief 测试计数器：每次读取加 1，输出函数额外增加 sink_cycles；输出字节数按颜色区分等级累计
+static uint32_t cycles;
+static uint32_t sink_cycles;
+static uint32_t sink_bytes[LEVEL_NONE];
+
+static uint32_t cycles_now(void)
+{
+    return ++cycles;
+}
+
+static void stats_sink(char *buffer, uint32_t size)
+{
+    cycles += sink_cycles;
+    sink_bytes[(buffer[5] == '7') ? LEVEL_INFO : (buffer[5] == '3') ? LEVEL_WARN : LEVEL_ERROR] += size;
+    sink(buffer, size);
+}
+
+/// @brief 同一标签在各统计项中的计数之和（相同的字面量不保证地址相同）
+static flogs_counter_t stats_tag(const flogs_stats_t *stats, const char *tag)
+{
+    flogs_counter_t sum = {0, 0, 0, 0};
+
+    for (uint32_t i = 0; i < FLOG_STATS_TAGS; i++)
+    {
+        if ((stats->tag[i] != 0) && (strcmp(stats->tag[i], tag) == 0))
+        {
+            sum.records += stats->tag_count[i].records;
+            sum.bytes += stats->tag_count[i].bytes;
+            sum.truncations += stats->tag_count[i].truncations;
+            sum.drops += stats->tag_count[i].drops;
+        }
+    }
+    return sum;
+}
+
+/// @brief 已知调用序列的记录数、字节数、截断数与耗时分布，flogs_stats_reset 后从 0 开始
+static void test_stats(void)
+{
+    char text[LOG_BUFFER_MAX_SIZE + 64];
+    flogs_stats_t stats;
+    flogs_counter_t sa;
+    flogs_counter_t sb;
+    uint32_t total = 0;
+
+    memset(text, 'y', sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
+    flogs_init(stats_sink);
+    flogs_stats_init(cycles_now);
+    flogs_stats_reset();
+    reset();
+
+    // 格式化耗时 1 个计数（第 1 桶），输出耗时 1 + 100 个计数（第 7 桶 [64, 128)）
+    sink_cycles = 100;
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        FLOGI("sa", "n=%u", i);
+    }
+    FLOGW("sb", "w");
+    FLOGW("sb", "ww");
+    // 输出耗时 1 + 5000 个计数（第 13 桶 [4096, 8192)），记录被截断
+    sink_cycles = 5000;
+    FLOGE("sa", "%s", text);
+
+    flogs_stats_snapshot(&stats);
+    CHECK(stats.level[LEVEL_INFO].records == 3);
+    CHECK(stats.level[LEVEL_INFO].bytes == sink_bytes[LEVEL_INFO]);
+    CHECK(stats.level[LEVEL_INFO].bytes == 3 * strlen("\n\r\033[37m[INFO] sa: n=0"));
+    CHECK(stats.level[LEVEL_WARN].records == 2);
+    CHECK(stats.level[LEVEL_WARN].bytes == sink_bytes[LEVEL_WARN]);
+    CHECK(stats.level[LEVEL_WARN].bytes == 2 * strlen("\n\r\033[33m[WARN] sb: w") + 1);
+    CHECK((stats.level[LEVEL_ERROR].records == 1) && (stats.level[LEVEL_ERROR].truncations == 1));
+    CHECK(stats.level[LEVEL_ERROR].bytes == sink_bytes[LEVEL_ERROR]);
+    CHECK(stats.level[LEVEL_ERROR].bytes == LOG_BUFFER_MAX_SIZE - 1);
+    CHECK((stats.level[LEVEL_INFO].truncations == 0) && (stats.level[LEVEL_WARN].truncations == 0));
+    for (uint32_t i = 0; i < LEVEL_NONE; i++)
+    {
+        total += stats.level[i].records;
+        CHECK(stats.level[i].drops == 0);
+    }
+    CHECK(total == 6);
+    CHECK(stats.level[LEVEL_INFO].bytes + stats.level[LEVEL_WARN].bytes + stats.level[LEVEL_ERROR].bytes == output_len);
+
+    sa = stats_tag(&stats, "sa");
+    sb = stats_tag(&stats, "sb");
+    CHECK((sa.records == 4) && (sa.truncations == 1) && (sa.bytes == stats.level[LEVEL_INFO].bytes + stats.level[LEVEL_ERROR].bytes));
+    CHECK((sb.records == 2) && (sb.truncations == 0) && (sb.bytes == stats.level[LEVEL_WARN].bytes));
+
+    CHECK(stats.sink_calls == 6);
+    CHECK(stats.sink_time == 5 * 101 + 5001);
+    for (uint32_t i = 0; i < FLOG_STATS_BUCKETS; i++)
+    {
+        CHECK(stats.format_hist[i] == ((i == 1) ? 6u : 0u));
+        CHECK(stats.sink_hist[i] == ((i == 7) ? 5u : (i == 13) ? 1u : 0u));
+    }
+
+    // 清零计数，保留已登记的标签
+    flogs_stats_reset();
+    flogs_stats_snapshot(&stats);
+    sa = stats_tag(&stats, "sa");
+    CHECK((sa.records == 0) && (sa.bytes == 0) && (sa.truncations == 0));
+    CHECK((stats.level[LEVEL_INFO].records == 0) && (stats.level[LEVEL_ERROR].truncations == 0));
+    CHECK((stats.sink_calls == 0) && (stats.sink_time == 0));
+    for (uint32_t i = 0; i < FLOG_STATS_BUCKETS; i++)
+    {
+        CHECK((stats.format_hist[i] == 0) && (stats.sink_hist[i] == 0));
+    }
+
+    sink_cycles = 0;
+    memset(sink_bytes, 0, sizeof(sink_bytes));
+    FLOGI("sa", "n=%u", 7);
+    flogs_stats_snapshot(&stats);
+    sa = stats_tag(&stats, "sa");
+    CHECK((sa.records == 1) && (sa.bytes == sink_bytes[LEVEL_INFO]));
+    CHECK((stats.level[LEVEL_INFO].records == 1) && (stats.level[LEVEL_WARN].records == 0));
+    CHECK((stats.sink_calls == 1) && (stats.sink_time == 1) && (stats.format_hist[1] == 1) && (stats.sink_hist[1] == 1));
+
+    flogs_init(sink);
+}
+#endif
+
+#if FLOG_TIMESTAMP
+/// @brief 输出一条记录，检查其时间戳
+static void stamped(const char *stamp)
+{
+    char expect[64];
+
+    snprintf(expect, sizeof(expect), "\n\r\033[37m[INFO] %sts: x", stamp);
+    reset();
+    FLOGI("ts", "x");
+    CHECK((output_len == strlen(expect)) && (memcmp(output, expect, output_len) == 0));
+}
+
+/// @brief 缓存的秒部分跨秒更新，时钟计数回绕后时间继续递增，非 1000 Hz 时钟按比例换算毫秒
+static void test_timestamp(void)
+{
+    // 未指定时钟源时不输出时间戳
+    stamped("");
+
+    // 启动后 1.5 秒计数回绕
+    clock_ms = UINT32_MAX - 1499;
+    flogs_timestamp_init(clock_now, 1000);
+    stamped("[0.000] ");
+    clock_ms += 999;
+    stamped("[0.999] ");
+    clock_ms += 1;
+    stamped("[1.000] ");
+    clock_ms += 499;
+    stamped("[1.499] ");
+    clock_ms += 1;
+    CHECK(clock_ms == 0);
+    stamped("[1.500] ");
+    clock_ms += 501;
+    stamped("[2.001] ");
+    stamped("[2.001] ");
+    // 一次跨过多秒
+    clock_ms += 58999;
+    stamped("[61.000] ");
+    clock_ms += 62456;
+    stamped("[123.456] ");
+    clock_ms += 9876543;
+    stamped("[9999.999] ");
+    clock_ms += 1;
+    stamped("[10000.000] ");
+
+    // 32768 Hz：毫秒向下取整，重新调用 flogs_timestamp_init 从 0 开始计时
+    clock_ms = UINT32_MAX - 32767;
+    flogs_timestamp_init(clock_now, 32768);
+    stamped("[0.000] ");
+    clock_ms += 32767;
+    stamped("[0.999] ");
+    clock_ms += 1;
+    stamped("[1.000] ");
+    clock_ms += 2 * 32768 + 16384;
+    stamped("[3.500] ");
+    clock_ms += 33;
+    stamped("[3.501] ");
+}
+#endif
+
+#if FLOG_RUNTIME_FILTER
+/// @brief 被计算的参数个数
+static uint32_t evaluated;
+
+static uint32_t arg(uint32_t value)
+{
+    evaluated++;
+    return value;
+}
+
+/// @brief 两个标签的三个调用点
+static void filtered(void)
+{
+    FLOGI("fa", "info %u", arg(1));
+    FLOGW("fa", "warn %u", arg(2));
+    FLOGI("fb", "info %u", arg(3));
+}
+
+/// @brief flogs_set_level 只修改标签匹配的调用点，关闭的调用点不计算参数
+static void test_runtime_filter(void)
+{
+    char name[] = "fa";
+
+    reset();
+    evaluated = 0;
+    filtered();
+    CHECK(output_has("fa: info 1") && output_has("fa: warn 2") && output_has("fb: info 3") && (evaluated == 3));
+
+    // 按内容匹配标签，与指针无关
+    CHECK(flogs_set_level(name, LEVEL_WARN) == 2);
+    reset();
+    evaluated = 0;
+    filtered();
+    CHECK(!output_has("fa: info 1") && output_has("fa: warn 2") && output_has("fb: info 3") && (evaluated == 2));
+
+    CHECK(flogs_set_level("fa", LEVEL_NONE) == 2);
+    CHECK(flogs_set_level("fb", LEVEL_ERROR) == 1);
+    reset();
+    evaluated = 0;
+    filtered();
+    CHECK((output_len == 0) && (evaluated == 0));
+
+    CHECK(flogs_set_level("none", LEVEL_SUCCESS) == 0);
+    CHECK(flogs_set_level("fb", LEVEL_INFO) == 1);
+    reset();
+    evaluated = 0;
+    filtered();
+    CHECK(!output_has("fa: ") && output_has("fb: info 3") && (evaluated == 1));
+
+    // NULL 修改全部调用点
+    CHECK(flogs_set_level(0, LEVEL_SUCCESS) >= 3);
+    reset();
+    evaluated = 0;
+    filtered();
+    CHECK(output_has("fa: info 1") && output_has("fa: warn 2") && output_has("fb: info 3") && (evaluated == 3));
+}
+#endif
+
+#if FLOG_BATCH
+static uint32_t writev_calls;
+
+static void sink_writev(const flogs_iovec_t *iov, uint32_t count)
+{
+    writev_calls++;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        sink(iov[i].base, (uint32_t)iov[i].len);
+    }
+}
+#endif
+
+#if FLOG_BATCH && !FLOG_KV && !FLOG_ASYNC
+/// @brief 同步批量输出：累计字节数达到阈值、最早的记录等待超时或 flogs_flush 时一次输出，不含记录末尾的 '\0'
+static void test_batch(void)
+{
+    char text[32];
+    uint32_t size;
+    uint32_t n;
+
+    flogs_timestamp_init(clock_now, 1000);
+
+    reset();
+    writev_calls = 0;
+    FLOGI("bat", "record %u", 1000u);
+    CHECK((writev_calls == 0) && (output_len == 0));
+    flogs_flush();
+    CHECK(writev_calls == 1);
+    size = output_len;
+    CHECK((size > 0) && (output[size - 1] != '\0'));
+
+    // 第 n 条记录使累计字节数达到阈值
+    reset();
+    writev_calls = 0;
+    n = (FLOG_BATCH_BYTES + size - 1) / size;
+    for (uint32_t i = 1; i < n; i++)
+    {
+        FLOGI("bat", "record %u", 1000 + i);
+    }
+    CHECK(writev_calls == 0);
+    FLOGI("bat", "record %u", 1000 + n);
+    CHECK((writev_calls == 1) && (output_len == n * size));
+    for (uint32_t i = 1; i <= n; i++)
+    {
+        snprintf(text, sizeof(text), "record %u", 1000 + i);
+        CHECK(output_has(text));
+    }
+
+    // 最早的记录等待 FLOG_BATCH_LATENCY 毫秒后随下一条记录输出
+    reset();
+    writev_calls = 0;
+    FLOGI("bat", "record %u", 1001u);
+    clock_ms += FLOG_BATCH_LATENCY - 1;
+    FLOGI("bat", "record %u", 1002u);
+    CHECK(writev_calls == 0);
+    clock_ms += 1;
+    FLOGI("bat", "record %u", 1003u);
+    CHECK((writev_calls == 1) && (output_len == 3 * size));
+
+    flogs_flush();
+    CHECK(writev_calls == 1);
+}
+#endif
+
+#if (FLOG_KV == FLOG_KV_TLV) && FLOG_BATCH
+/// @brief 批量输出的二进制键值记录首尾相接，校验和为 0 的记录也保留完整长度
+static void test_kv_tlv_batch(void)
+{
+    uint32_t count = 1000;
+    uint32_t records = 0;
+    uint32_t pos = 0;
+    uint32_t size;
+
+    char tag[300];
+
+    reset();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        flogs_kv_t kv[] = {FLOGS_KV_INT("i", i), FLOGS_KV_STR("s", "x")};
+        flogs_kv(LEVEL_INFO, "kv", "m", kv, 2);
+    }
+    // 标签长到填满记录时被截断，消息 TLV 仍有空间
+    memset(tag, 't', sizeof(tag) - 1);
+    tag[sizeof(tag) - 1] = '\0';
+    for (uint32_t len = 240; len < sizeof(tag); len += 3)
+    {
+        flogs_kv_t kv[] = {FLOGS_KV_INT("i", len)};
+        flogs_kv(LEVEL_INFO, tag + sizeof(tag) - 1 - len, tag, kv, 1);
+        count++;
+    }
+    flogs_flush();
+
+    // 记录格式：[0] 0xF6 [1] 等级 [2..3] TLV 长度 [4..] TLV [末尾] 校验和
+    while (pos + 4 <= output_len && (uint8_t)output[pos] == 0xF6)
+    {
+        size = 4 + ((uint8_t)output[pos + 2] | ((uint32_t)(uint8_t)output[pos + 3] << 8)) + 1;
+        pos += size;
+        records++;
+    }
+    CHECK(pos == output_len);
+    CHECK(records == count);
+}
+#endif
+
+#if FLOG_COMPRESS
+#define FRAMES_MAX 256
+
+static char unpacked[1 << 16];
+static uint32_t frame_raw[FRAMES_MAX];
+
+/// @brief 依次解码输出中的全部帧，记录每帧的原始长度
+/// @return 解码后的总长度，frames 为帧数
+static uint32_t unframe_all(uint32_t *frames)
+{
+    uint32_t pos = 0;
+    uint32_t len = 0;
+    uint32_t used;
+    int32_t ret;
+
+    *frames = 0;
+    while (pos < output_len)
+    {
+        ret = flz_unframe((const uint8_t *)output + pos, output_len - pos, (uint8_t *)unpacked + len, sizeof(unpacked) - len, &used);
+        pos += used;
+        if (ret < 0)
+        {
+            break;
+        }
+        if (*frames < FRAMES_MAX)
+        {
+            frame_raw[*frames] = (uint32_t)ret;
+        }
+        (*frames)++;
+        len += (uint32_t)ret;
+    }
+    CHECK(pos == output_len);
+    return len;
+}
+
+/// @brief 压缩输出：块写满时成帧，单条记录不跨帧，flogs_flush 输出未写满的块，损坏的帧被跳过
+static void test_compress(void)
+{
+    static char expect[1 << 16];
+    char pad[64];
+    uint32_t expect_len = 0;
+    uint32_t frames;
+    uint32_t len;
+    uint32_t offset;
+    uint32_t pos;
+    uint32_t buffered;
+    uint32_t skipped;
+
+    reset();
+    memset(pad, 'p', sizeof(pad));
+    for (uint32_t i = 0; i < 300; i++)
+    {
+        pad[i % 50] = '\0';
+        FLOGW("cmp", "rec %u %s", i, pad);
+        expect_len += (uint32_t)snprintf(expect + expect_len, sizeof(expect) - expect_len, "\n\r\033[33m[WARN] cmp: rec %u %s", i, pad);
+        pad[i % 50] = 'p';
+    }
+    // 最后一个块未写满，flogs_flush 之前不输出
+    buffered = output_len;
+    len = unframe_all(&frames);
+    CHECK((frames > 1) && (len < expect_len) && (memcmp(unpacked, expect, len) == 0));
+    flogs_flush();
+    CHECK(output_len > buffered);
+    flogs_flush();
+
+    len = unframe_all(&frames);
+    CHECK((len == expect_len) && (memcmp(unpacked, expect, len) == 0));
+    CHECK(output_len < expect_len);
+    // 每帧不超过块大小，且从一条完整记录开始
+    offset = 0;
+    for (uint32_t i = 0; (i < frames) && (i < FRAMES_MAX); i++)
+    {
+        CHECK((frame_raw[i] > 0) && (frame_raw[i] <= FLOG_COMPRESS_BLOCK));
+        CHECK(memcmp(expect + offset, "\n\r", 2) == 0);
+        offset += frame_raw[i];
+    }
+
+    // 损坏第二帧的数据区（第二帧从第一帧的帧头 + 数据长度 + 帧尾之后开始），解码跳过该帧，其余记录不受影响
+    pos = FLZ_FRAME_HEAD + ((uint8_t)output[5] | ((uint32_t)(uint8_t)output[6] << 8)) + FLZ_FRAME_TAIL;
+    output[pos + FLZ_FRAME_HEAD + 2] ^= 0x20;
+    offset = frame_raw[0];
+    skipped = frame_raw[1];
+    len = unframe_all(&frames);
+    CHECK(len == expect_len - skipped);
+    CHECK(memcmp(unpacked, expect, offset) == 0);
+    CHECK(memcmp(unpacked + offset, expect + offset + skipped, len - offset) == 0);
+
+#if FLOG_RECORDER
+    // 导出飞行记录仪时直接成帧输出，不需要 flogs_flush，导出内容以最后写入的记录结尾
+    reset();
+    expect_len = 0;
+    for (uint32_t i = 0; i < 40; i++)
+    {
+        FLOGI("cmp", "dump %u", i);
+        expect_len += (uint32_t)snprintf(expect + expect_len, sizeof(expect) - expect_len, "\n\r\033[37m[INFO] cmp: dump %u", i);
+    }
+    CHECK(output_len == 0);
+    flogs_dump();
+    len = unframe_all(&frames);
+    CHECK((len >= expect_len) && (memcmp(unpacked + len - expect_len, expect, expect_len) == 0));
+    for (uint32_t i = 0; (i < frames) && (i < FRAMES_MAX); i++)
+    {
+        CHECK(frame_raw[i] <= FLOG_COMPRESS_BLOCK);
+    }
+    buffered = output_len;
+    flogs_flush();
+    CHECK(output_len == buffered);
+#endif
+}
+#endif
+
+#if FLOG_DEFERRED && defined(FLOG_DECODER)
+extern const char __start_flogs_fmt[];
+extern const char __stop_flogs_fmt[];
+
+#define DEFER_RECORDS 6
+
+/// @brief 各条延迟记录还原后的文本
+static const char *defer_text[DEFER_RECORDS] = {
+    "\n\r\033[37m[INFO] dfr: d=-2147483648 u=4294967295 x=BEEF lx=FFFFFFFF hx=5A s=abc f=-1.50000",
+    "\n\r\033[33m[WARN] dfr: max d=2147483647 f=-524288.00000 u=0",
+    "\n\r\033[31m[ERRO] net: empty s=[] 100% done",
+    "\n\r\033[37m[INFO] dfr: no args",
+    "\n\r\033[37m[INFO] dfr: varint 127 128 16383 16384 2097151 2097152",
+    "\n\r\033[37m[INFO] dfr: s=0123456789abcdefghijklmnopqrstuvwxyz.",
+};
+
+/// @brief 拼接指定记录的文本，mask 第 i 位为 1 时跳过第 i 条
+static uint32_t defer_expect(char *expect, uint32_t mask)
+{
+    uint32_t len = 0;
+
+    for (uint32_t i = 0; i < DEFER_RECORDS; i++)
+    {
+        if ((mask & (1u << i)) == 0)
+        {
+            len += (uint32_t)sprintf(expect + len, "%s", defer_text[i]);
+        }
+    }
+    return len;
+}
+
+/// @brief 复制一条记录，从 at 开始按小端写入 bytes 字节的 value 后重新计算校验和
+static uint32_t defer_forge(uint8_t *dst, const uint8_t *record, uint32_t at, uint32_t value, uint32_t bytes)
+{
+    uint32_t size = 7 + record[6];
+    uint8_t sum = 0;
+
+    memcpy(dst, record, size);
+    for (uint32_t i = 0; i < bytes; i++)
+    {
+        dst[at + i] = (uint8_t)(value >> (i * 8));
+    }
+    for (uint32_t i = 0; i < size; i++)
+    {
+        sum += dst[i];
+    }
+    dst[size] = sum;
+    return size + 1;
+}
+
+/// @brief 延迟输出：记录经 flogs_decode 还原为与文本模式相同的内容，
+///        支持分段输入，跳过损坏字节、校验错误与偏移越界的记录后重新同步
+static void test_deferred(void)
+{
+    static uint8_t stream[1 << 12];
+    static uint8_t mangled[1 << 12];
+    static char expect[1 << 12];
+    uint32_t strtab_len = (uint32_t)(__stop_flogs_fmt - __start_flogs_fmt);
+    uint32_t at[DEFER_RECORDS + 1];
+    uint32_t stream_len;
+    uint32_t expect_len;
+    uint32_t len;
+    uint32_t pos;
+    bool split_ok = true;
+
+    reset();
+    at[0] = 0;
+    FLOGI("dfr", "d=%d u=%u x=%x lx=%lx hx=%hx s=%s f=%f", INT32_MIN, UINT32_MAX, 0xBEEFu, UINT32_MAX, 0x5Au, "abc", (int32_t)-6144);
+    at[1] = output_len;
+    FLOGW("dfr", "max d=%d f=%f u=%u", INT32_MAX, INT32_MIN, 0u);
+    at[2] = output_len;
+    FLOGE("net", "empty s=[%s] 100%% done", "");
+    at[3] = output_len;
+    FLOGI("dfr", "no args");
+    at[4] = output_len;
+    FLOGI("dfr", "varint %u %u %u %u %u %u", 127u, 128u, 16383u, 16384u, 2097151u, 2097152u);
+    at[5] = output_len;
+    FLOGI("dfr", "s=%s.", "0123456789abcdefghijklmnopqrstuvwxyz");
+    at[6] = output_len;
+
+    // 每条记录单独输出，以同步字节开头，参数按变长编码，远小于文本
+    stream_len = output_len;
+    memcpy(stream, output, stream_len);
+    expect_len = defer_expect(expect, 0);
+    for (uint32_t i = 0; i < DEFER_RECORDS; i++)
+    {
+        CHECK((at[i + 1] > at[i]) && (stream[at[i]] == 0xF5) && (at[i + 1] - at[i] == 8u + stream[at[i] + 6]));
+    }
+    CHECK(stream_len < expect_len / 2);
+
+    reset();
+    CHECK(flogs_decode(stream, stream_len, __start_flogs_fmt, strtab_len) == stream_len);
+    CHECK((output_len == expect_len) && (memcmp(output, expect, expect_len) == 0));
+
+    // 在任意位置分成两段传入，末尾不完整的记录留待下次
+    for (uint32_t cut = 0; cut <= stream_len; cut++)
+    {
+        reset();
+        pos = flogs_decode(stream, cut, __start_flogs_fmt, strtab_len);
+        split_ok = split_ok && (pos <= cut);
+        pos += flogs_decode(stream + pos, stream_len - pos, __start_flogs_fmt, strtab_len);
+        split_ok = split_ok && (pos == stream_len) && (output_len == expect_len) && (memcmp(output, expect, expect_len) == 0);
+    }
+    CHECK(split_ok);
+
+    // 记录之间插入噪声与伪同步字节，第二条记录的参数损坏，其余记录照常还原
+    len = 0;
+    memcpy(mangled + len, "\x00\x13\xF5\x01\x00\x00\x00\x02\x00", 9);
+    len += 9;
+    memcpy(mangled + len, stream + at[0], at[1] - at[0]);
+    len += at[1] - at[0];
+    memcpy(mangled + len, "\x00\xF5\xFF\x33", 4);
+    len += 4;
+    memcpy(mangled + len, stream + at[1], at[2] - at[1]);
+    mangled[len + 8] ^= 0x04;
+    len += at[2] - at[1];
+    // 偏移或等级越界但校验和正确的记录：标签偏移、格式化字符串偏移不小于段长度，等级为 LEVEL_NONE
+    len += defer_forge(mangled + len, stream + at[3], 2, strtab_len, 2);
+    len += defer_forge(mangled + len, stream + at[3], 4, strtab_len, 2);
+    len += defer_forge(mangled + len, stream + at[3], 4, 0xFFFF, 2);
+    len += defer_forge(mangled + len, stream + at[3], 1, LEVEL_NONE, 1);
+    memcpy(mangled + len, stream + at[2], stream_len - at[2]);
+    len += stream_len - at[2];
+
+    reset();
+    expect_len = defer_expect(expect, 1u << 1);
+    CHECK(flogs_decode(mangled, len, __start_flogs_fmt, strtab_len) == len);
+    CHECK((output_len == expect_len) && (memcmp(output, expect, expect_len) == 0));
+}
+#endif
+
+#if FLOG_KV == FLOG_KV_JSON
+/// @brief JSON 行：字符串转义，放不下的键值对整对丢弃并以 "trunc" 结尾
+static void test_kv_json(void)
+{
+    static const char expect[] = "{\"lvl\":\"WARN\",\"tag\":\"ta\\\"g\",\"msg\":\"a\\nb\\\"c\\\\d\\te\\u0001\\u001f\","
+                                 "\"k\\\\\":\"v\\r\",\"i\":-5,\"u\":4294967295,\"f\":-1.50000,\"min\":-2147483648}\n";
+    char text[LOG_BUFFER_MAX_SIZE + 1];
+    const char *p;
+    uint32_t pairs;
+    unsigned int index;
+    int value;
+    int used;
+
+    {
+        flogs_kv_t kv[] = {FLOGS_KV_STR("k\\", "v\r"), FLOGS_KV_INT("i", -5), FLOGS_KV_UINT("u", UINT32_MAX),
+                           FLOGS_KV_FQ12("f", -6144), FLOGS_KV_INT("min", INT32_MIN)};
+        reset();
+        flogs_kv(LEVEL_WARN, "ta\"g", "a\nb\"c\\d\te\x01\x1f", kv, 5);
+        CHECK((output_len == sizeof(expect) - 1) && (memcmp(output, expect, sizeof(expect) - 1) == 0));
+    }
+
+    // 键值对放不下时整对丢弃，记录仍以完整的 JSON 结尾
+    for (uint32_t width = 0; width < 40; width++)
+    {
+        flogs_kv_t kv[40];
+        char value_text[40][48];
+
+        // 偶数为数值 "n"，奇数为 width 个需要转义的引号组成的字符串 "s"
+        for (uint32_t i = 0; i < 40; i++)
+        {
+            memset(value_text[i], '"', width);
+            value_text[i][width] = '\0';
+            kv[i] = (i & 1) ? (flogs_kv_t)FLOGS_KV_STR("s", value_text[i]) : (flogs_kv_t)FLOGS_KV_INT("n", i * 1000);
+        }
+        reset();
+        flogs_kv(LEVEL_INFO, "tag", "msg", kv, 40);
+        CHECK((output_len > 0) && (output_len < LOG_BUFFER_MAX_SIZE));
+        memcpy(text, output, output_len);
+        text[output_len] = '\0';
+        CHECK(strcmp(text + output_len - 15, ",\"trunc\":true}\n") == 0);
+
+        // 截断标记之前是完整的键值对
+        p = strstr(text, "\"msg\":\"msg\"") + 11;
+        pairs = 0;
+        for (;;)
+        {
+            if ((sscanf(p, ",\"n\":%d%n", &value, &used) == 1) && (value == (int)(pairs * 1000)))
+            {
+                p += used;
+            }
+            else if (strncmp(p, ",\"s\":\"", 6) == 0)
+            {
+                p += 6;
+                for (index = 0; index < width && p[0] == '\\' && p[1] == '"'; index++)
+                {
+                    p += 2;
+                }
+                CHECK((index == width) && (*p == '"'));
+                p++;
+            }
+            else
+            {
+                break;
+            }
+            pairs++;
+        }
+        CHECK((pairs > 0) && (pairs < 40));
+        CHECK(p == text + output_len - 15);
+    }
+}
+#endif
+
+#if FLOG_ASYNC && (FLOG_ASYNC_OVERFLOW == FLOG_OVERFLOW_BLOCK)
+#define WRITERS 4
+#define WRITES 20000
+
+static atomic_uint async_records;
+static atomic_bool async_done;
+
+/// @brief 只统计记录数，输出函数由持有输出权的线程串行调用
+static void sink_count(char *buffer, uint32_t size)
+{
+    (void)buffer;
+    (void)size;
+    atomic_fetch_add_explicit(&async_records, 1, memory_order_relaxed);
+}
+
+static void *writer(void *arg)
+{
+    for (uint32_t i = 0; i < WRITES; i++)
+    {
+        FLOGI("mt", "w%u n=%u", (uint32_t)(uintptr_t)arg, i);
+    }
+    return 0;
+}
+
+static void *drainer(void *arg)
+{
+    (void)arg;
+    while (!atomic_load_explicit(&async_done, memory_order_acquire))
+    {
+        flogs_drain();
+    }
+    return 0;
+}
+
+/// @brief 多个写入线程与后台输出线程争用，缓冲区满时等待而不丢弃，全部记录都被输出
+static void test_async_block(void)
+{
+    pthread_t writers[WRITERS];
+    pthread_t drain;
+
+    flogs_init(sink_count);
+    pthread_create(&drain, 0, drainer, 0);
+    for (uintptr_t i = 0; i < WRITERS; i++)
+    {
+        pthread_create(&writers[i], 0, writer, (void *)i);
+    }
+    for (uint32_t i = 0; i < WRITERS; i++)
+    {
+        pthread_join(writers[i], 0);
+    }
+    flogs_flush();
+    atomic_store_explicit(&async_done, true, memory_order_release);
+    pthread_join(drain, 0);
+
+    CHECK(atomic_load(&async_records) == WRITERS * WRITES);
+    CHECK(flogs_dropped() == 0);
+
+    // 没有后台线程时由 flogs_flush 输出
+    flogs_init(sink);
+    reset();
+    FLOGI("mt", "w%u n=%u", 9u, 1u);
+    flogs_flush();
+    CHECK(output_has("w9 n=1"));
+}
+#endif
+
+#if !FLOG_ASYNC && defined(FFMT_THREAD_SAFE)
+#define SYNC_WRITERS 4
+#define SYNC_WRITES 20000
+
+static atomic_uint sync_good;
+static atomic_uint sync_bad;
+
+/// @brief 同步模式下由各写入线程并发调用，检查记录没有被其他线程改写
+static void sink_check(char *buffer, uint32_t size)
+{
+    char text[LOG_BUFFER_MAX_SIZE + 1];
+    const char *p;
+    unsigned int id;
+    unsigned int n;
+    unsigned int sum;
+
+    memcpy(text, buffer, size);
+    text[size] = '\0';
+    p = strstr(text, "id=");
+    if ((p != 0) && (sscanf(p, "id=%u n=%u sum=%u", &id, &n, &sum) == 3) && (sum == id * 1000003u + n))
+    {
+        atomic_fetch_add_explicit(&sync_good, 1, memory_order_relaxed);
+    }
+    else
+    {
+        atomic_fetch_add_explicit(&sync_bad, 1, memory_order_relaxed);
+    }
+}
+
+static void *sync_writer(void *arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+
+    for (uint32_t i = 0; i < SYNC_WRITES; i++)
+    {
+        FLOGI("mt", "id=%u n=%u sum=%u", id, i, id * 1000003u + i);
+    }
+    return 0;
+}
+
+/// @brief 多个线程不加锁同时同步输出，每条记录完整且只输出一次
+static void test_sync_threads(void)
+{
+    pthread_t writers[SYNC_WRITERS];
+
+    flogs_init(sink_check);
+    for (uintptr_t i = 0; i < SYNC_WRITERS; i++)
+    {
+        pthread_create(&writers[i], 0, sync_writer, (void *)i);
+    }
+    for (uint32_t i = 0; i < SYNC_WRITERS; i++)
+    {
+        pthread_join(writers[i], 0);
+    }
+    CHECK(atomic_load(&sync_good) == SYNC_WRITERS * SYNC_WRITES);
+    CHECK(atomic_load(&sync_bad) == 0);
+}
+#endif
+
+int main(void)
+{
+    flogs_init(sink);
+#if FLOG_BATCH
+    flogs_batch_init(sink_writev);
+#endif
+#if FLOG_RECORDER && !FLOG_RATE_LIMIT && !FLOG_COMPRESS
+    test_recorder_dump();
+#endif
+#if FLOG_BATCH && !FLOG_KV && !FLOG_ASYNC
+    test_batch();
+#endif
+#if (FLOG_KV == FLOG_KV_TLV) && FLOG_BATCH
+    test_kv_tlv_batch();
+#endif
+#if FLOG_COMPRESS
+    test_compress();
+#endif
+#if FLOG_DEFERRED && defined(FLOG_DECODER)
+    test_deferred();
+#endif
+#if FLOG_KV == FLOG_KV_JSON
+    test_kv_json();
+#endif
+#if FLOG_RATE_LIMIT
+    test_rate_limit();
+#endif
+#if FLOG_RUNTIME_FILTER
+    test_runtime_filter();
+#endif
+#if FLOG_TIMESTAMP
+    test_timestamp();
+#endif
+#if FLOG_STATS
+    test_stats();
+#endif
+#if FLOG_ASYNC && (FLOG_ASYNC_OVERFLOW == FLOG_OVERFLOW_BLOCK)
+    test_async_block();
+#endif
+#if !FLOG_ASYNC && defined(FFMT_THREAD_SAFE)
+    test_sync_threads();
+#endif
+    printf("test_flogs: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,204 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: test/test_flz.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: flz 块压缩与成帧测试
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <string.h>
+#include "utl_flz.h"
+
+static int failures;
+
+#define CHECK(expr)                                                         \
+	do                                                                      \
+	{                                                                       \
+		if (!(expr))                                                        \
+		{                                                                   \
+			printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+			failures++;                                                     \
+		}                                                                   \
+	} while (0)
+
+static uint8_t src[FLZ_BLOCK_MAX_SIZE];
+static uint8_t packed[FLZ_FRAME_BOUND(FLZ_BLOCK_MAX_SIZE) * 2];
+static uint8_t unpacked[FLZ_BLOCK_MAX_SIZE];
+
+/// @brief 读取扩展长度
+static uint32_t length(const uint8_t **p, uint32_t length)
+{
+	uint8_t byte;
+
+	if (length == 15)
+	{
+		do
+		{
+			byte = *(*p)++;
+			length += byte;
+		} while (byte == 255);
+	}
+	return length;
+}
+
+/// @brief 按 LZ4 块结尾规则检查压缩数据：最后 5 字节为字面量，最后一个匹配在结尾 12 字节之前开始
+/// @return 是否符合
+static int lz4_end_rules(const uint8_t *block, uint32_t size, uint32_t raw)
+{
+	const uint8_t *p = block;
+	const uint8_t *end = block + size;
+	uint32_t pos = 0;
+	uint32_t lit;
+	uint32_t match;
+	uint8_t token;
+
+	while (p < end)
+	{
+		token = *p++;
+		lit = length(&p, token >> 4);
+		p += lit;
+		pos += lit;
+		if (p == end)
+		{
+			return (raw < 13) || (lit >= 5);
+		}
+		p += 2;
+		match = length(&p, token & 0x0F) + 4;
+		if ((pos + 12 > raw) || (pos + match + 5 > raw))
+		{
+			return 0;
+		}
+		pos += match;
+	}
+	return 0;
+}
+
+/// @brief 生成测试数据：0 全部相同，1 重复短语，2 伪随机，3 混合
+static void fill(uint8_t *buf, uint32_t len, uint32_t kind, uint32_t seed)
+{
+	static const char phrase[] = "[INFO] nav: fix=3 sats=12 ";
+
+	for (uint32_t i = 0; i < len; i++)
+	{
+		seed = seed * 1103515245u + 12345u;
+		switch (kind)
+		{
+		case 0:
+			buf[i] = 'a';
+			break;
+		case 1:
+			buf[i] = (uint8_t)phrase[i % (sizeof(phrase) - 1)];
+			break;
+		case 2:
+			buf[i] = (uint8_t)(seed >> 24);
+			break;
+		default:
+			buf[i] = ((seed >> 28) < 3) ? (uint8_t)(seed >> 16) : (uint8_t)phrase[i % (sizeof(phrase) - 1)];
+			break;
+		}
+	}
+}
+
+/// @brief 块压缩往返，并检查块结尾规则
+static void test_block(void)
+{
+	static const uint32_t sizes[] = {0, 1, 4, 5, 11, 12, 13, 16, 17, 64, 255, 256, 4096, FLZ_BLOCK_MAX_SIZE};
+	flz_state_t state;
+	int32_t size;
+
+	for (uint32_t kind = 0; kind < 4; kind++)
+	{
+		for (uint32_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+		{
+			fill(src, sizes[i], kind, i);
+			size = flz_compress(&state, src, sizes[i], packed, sizeof(packed));
+			CHECK(size > 0);
+			CHECK(lz4_end_rules(packed, (uint32_t)size, sizes[i]));
+			CHECK(flz_decompress(packed, (uint32_t)size, unpacked, sizeof(unpacked)) == (int32_t)sizes[i]);
+			CHECK(memcmp(src, unpacked, sizes[i]) == 0);
+		}
+	}
+
+	CHECK(flz_compress(&state, src, FLZ_BLOCK_MAX_SIZE + 1, packed, sizeof(packed)) == FLZ_Error_ArgsErr);
+	fill(src, 4096, 2, 1);
+	CHECK(flz_compress(&state, src, 4096, packed, 100) == FLZ_Error_Overflow);
+}
+
+/// @brief 哈希表的初始内容不影响输出
+static void test_state(void)
+{
+	flz_state_t clean;
+	flz_state_t dirty;
+	static uint8_t other[4096];
+	int32_t a;
+	int32_t b;
+
+	fill(src, 4096, 3, 7);
+	memset(&clean, 0, sizeof(clean));
+	memset(&dirty, 0x5A, sizeof(dirty));
+	a = flz_compress(&clean, src, 4096, packed, sizeof(packed));
+	b = flz_compress(&dirty, src, 4096, other, sizeof(other));
+	CHECK((a == b) && (memcmp(packed, other, (size_t)a) == 0));
+}
+
+/// @brief 成帧后插入噪声与损坏帧，解码端重新同步
+static void test_frame(void)
+{
+	flz_state_t state;
+	uint32_t pos = 0;
+	uint32_t used;
+	int32_t size;
+	int32_t ret;
+
+	fill(src, 1000, 1, 0);
+	memcpy(packed, "\xF7\x5A noise", 8);
+	pos = 8;
+	size = flz_frame(&state, src, 1000, packed + pos, sizeof(packed) - pos);
+	CHECK(size > 0);
+	// 第一帧数据区损坏，校验不通过
+	packed[pos + FLZ_FRAME_HEAD + 3] ^= 0x40;
+	pos += (uint32_t)size;
+	fill(src, 500, 2, 3);
+	size = flz_frame(&state, src, 500, packed + pos, sizeof(packed) - pos);
+	CHECK(size == (int32_t)FLZ_FRAME_BOUND(500));
+	pos += (uint32_t)size;
+
+	ret = flz_unframe(packed, pos - 1, unpacked, sizeof(unpacked), &used);
+	CHECK(ret == FLZ_Error_Incomplete);
+	ret = flz_unframe(packed + used, pos - used, unpacked, sizeof(unpacked), &used);
+	CHECK(ret == 500);
+	CHECK(memcmp(src, unpacked, 500) == 0);
+}
+
+int main(void)
+{
+	test_block();
+	test_state();
+	test_frame();
+	printf("test_flz: %s\n", failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
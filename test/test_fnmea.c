@@ -0,0 +1,756 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: test/test_fnmea.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: fnmea 解析行为测试
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ * 
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include "utl_fnmea.h"
+
+static int failures;
+
+#define CHECK(expr)                                                         \
+	do                                                                      \
+	{                                                                       \
+		if (!(expr))                                                        \
+		{                                                                   \
+			printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+			failures++;                                                     \
+		}                                                                   \
+	} while (0)
+
+/// @brief 为语句补上校验和与 "\r\n"
+/// @param body 语句（从 '$' 开始，不含 '*'）
+/// @return 完整语句（静态缓冲区）
+static const char *sentence(const char *body)
+{
+	// 多留出 "*XX\r\n" 的位置
+	static char out[4][FNMEA_BUFFER_MAX_SIZE + 8];
+	static int next;
+	char *p = out[next++ & 3];
+	uint8_t sum = 0;
+
+	for (const char *c = body + 1; *c != '\0'; c++)
+	{
+		sum ^= (uint8_t)*c;
+	}
+	snprintf(p, sizeof(out[0]), "%s*%02X\r\n", body, sum);
+	return p;
+}
+
+/// @brief 整条语句解析
+static FNMEA_Error_Type parse(fnmea_ctx_t *ctx, const char *body)
+{
+	const char *s = sentence(body);
+	return fnmea_parse(ctx, s, (uint32_t)strlen(s));
+}
+
+/// @brief 流式解析，返回本次提交的语句数
+static uint32_t feed(fnmea_ctx_t *ctx, const char *body)
+{
+	const char *s = sentence(body);
+	return fnmea_feed_n(ctx, (const uint8_t *)s, (uint32_t)strlen(s));
+}
+
+/// @brief 按指定方式输入一条语句
+/// @param stream 为 true 时流式解析，否则整条语句解析
+/// @return 是否提交了记录
+static bool input(fnmea_ctx_t *ctx, bool stream, const char *body)
+{
+	return stream ? (feed(ctx, body) == 1) : (parse(ctx, body) == FNMEA_Error_None);
+}
+
+/// @brief 流式解析与整条语句解析得到相同的记录
+static void test_feed_parse(void)
+{
+	static const char *const bodies[] = {
+		"$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,",
+		"$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1",
+		"$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W",
+		"$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K",
+		"$GPGLL,4916.45,N,12311.12,W,225444,A,",
+		"$GNGGA,001043.00,4404.14036,N,12118.85961,W,1,12,0.98,1113.0,M,-21.3,M,,",
+		"$GPGSV,2,1,08,01,40,083,46,02,17,308,41,12,07,344,39,14,22,228,45",
+		"$GPGGA,,,,,,0,00,99.99,,,,,,",
+		"$GPXXX,1",
+	};
+	fnmea_ctx_t a;
+	fnmea_ctx_t b;
+
+	fnmea_init(&a, 0, 0);
+	fnmea_init(&b, 0, 0);
+	for (size_t i = 0; i < sizeof(bodies) / sizeof(bodies[0]); i++)
+	{
+		FNMEA_Error_Type ret = parse(&a, bodies[i]);
+		uint32_t n = feed(&b, bodies[i]);
+
+		CHECK((ret == FNMEA_Error_None) == (n == 1));
+		CHECK(memcmp(&a.nmea, &b.nmea, sizeof(a.nmea)) == 0);
+	}
+	CHECK((a.sentences == 8) && (b.sentences == 8));
+
+	// 第一条语句的解码结果
+	fnmea_init(&a, 0, 0);
+	CHECK(parse(&a, bodies[0]) == FNMEA_Error_None);
+	CHECK((a.nmea.utc_time.hour == 12) && (a.nmea.utc_time.min == 35) && (a.nmea.utc_time.sec == 19));
+	CHECK((a.nmea.locate.lati.deg == 48) && (a.nmea.locate.lati.min == 7) && (a.nmea.locate.lati.min_dec == 380));
+	CHECK((a.nmea.locate.longi.deg == 11) && (a.nmea.locate.longi.min == 31) && (a.nmea.locate.longi.sign == 0));
+	CHECK((a.nmea.precision.satellite_num == 8) && (a.nmea.precision.hdop == 9));
+	CHECK(a.nmea.locate.alti == (int32_t)(545.4 * 4096));
+	CHECK(a.nmea.staus == FNMEA_STAT_Autonomous);
+
+	// 校验和错误与字节损坏
+	const char *bad = "$GPGGA,123519,4807.038,N*00\r\n";
+	const char *broken = "$GPGGA,1\x01,2*00\r\n";
+	CHECK(fnmea_parse(&a, bad, (uint32_t)strlen(bad)) == FNMEA_Error_Checksum);
+	fnmea_init(&b, 0, 0);
+	CHECK(fnmea_feed_n(&b, (const uint8_t *)broken, (uint32_t)strlen(broken)) == 0);
+	CHECK(b.errors == 1);
+}
+
+/// @brief 失去定位后的空字段清除语句自身负责的记录字段，其他语句负责的字段保留
+static void test_empty_fields(void)
+{
+	fnmea_ctx_t ctx[2];
+
+	for (int mode = 0; mode < 2; mode++)
+	{
+		fnmea_ctx_t *c = &ctx[mode];
+		fnmea_init(c, 0, 0);
+		CHECK(input(c, mode, "$GPRMC,123520,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W,A"));
+		CHECK(input(c, mode, "$GPGGA,123520,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,"));
+		CHECK(input(c, mode, "$GPGGA,,,,,,0,00,99.99,,,,,,"));
+		CHECK(c->nmea.staus == FNMEA_STAT_Invalid);
+		CHECK((c->nmea.utc_time.hour == 0) && (c->nmea.utc_time.min == 0) && (c->nmea.utc_time.sec == 0));
+		CHECK((c->nmea.locate.lati.deg == 0) && (c->nmea.locate.lati.min == 0) && (c->nmea.locate.lati.sign == 0));
+		CHECK((c->nmea.locate.longi.deg == 0) && (c->nmea.locate.longi.min_dec == 0));
+		CHECK((c->nmea.locate.alti == 0) && (c->nmea.precision.satellite_num == 0));
+		CHECK(c->nmea.precision.hdop == 255);
+		// RMC 负责的日期与速度保留
+		CHECK((c->nmea.utc_date.year == 1994) && (c->nmea.utc_date.day == 23));
+		CHECK(c->nmea.speed.speed_sog == (int32_t)(22.4 * 4096));
+
+		CHECK(input(c, mode, "$GPRMC,,V,,,,,,,,,,N"));
+		CHECK(c->nmea.staus == FNMEA_STAT_Invalid);
+		CHECK((c->nmea.utc_date.year == 0) && (c->nmea.speed.speed_sog == 0) && (c->nmea.speed.speed_kph == 0));
+		CHECK(c->nmea.angle.true_north == 0);
+	}
+	CHECK(memcmp(&ctx[0].nmea, &ctx[1].nmea, sizeof(ctx[0].nmea)) == 0);
+
+	// 没有模式字段时以状态字段为准
+	fnmea_init(&ctx[0], 0, 0);
+	CHECK(parse(&ctx[0], "$GPRMC,123520,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W,") == FNMEA_Error_None);
+	CHECK(ctx[0].nmea.staus == FNMEA_STAT_Autonomous);
+}
+
+#define EPOCH_MAX 8
+
+static uint32_t epoch_count;
+static uint32_t epoch_time[EPOCH_MAX];
+static uint32_t epoch_seen[EPOCH_MAX];
+static int32_t epoch_alti[EPOCH_MAX];
+
+static void epoch_callback(fnmea_ctx_t *ctx, const fnmea_t *fix, uint32_t seen)
+{
+	(void)ctx;
+	if (epoch_count < EPOCH_MAX)
+	{
+		epoch_time[epoch_count] = fix->utc_time.hour * 10000U + fix->utc_time.min * 100U + fix->utc_time.sec;
+		epoch_seen[epoch_count] = seen;
+		epoch_alti[epoch_count] = fix->locate.alti;
+	}
+	epoch_count++;
+}
+
+/// @brief 按历元输出一次合并后的记录
+static void test_epoch(void)
+{
+	const uint32_t expect = FNMEA_EPOCH(FNMEA_CMD_GGA) | FNMEA_EPOCH(FNMEA_CMD_RMC) | FNMEA_EPOCH(FNMEA_CMD_GSA);
+	fnmea_ctx_t ctx;
+	char body[FNMEA_BUFFER_MAX_SIZE];
+
+	for (int mode = 0; mode < 2; mode++)
+	{
+		fnmea_init(&ctx, 0, 0);
+		fnmea_epoch_init(&ctx, epoch_callback, expect, 100);
+		epoch_count = 0;
+		for (int e = 19; e < 23; e++)
+		{
+			snprintf(body, sizeof(body), "$GPRMC,1235%02d,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W", e);
+			CHECK(input(&ctx, mode, body));
+			snprintf(body, sizeof(body), "$GPGGA,1235%02d,4807.038,N,01131.000,E,1,08,0.9,%d.0,M,46.9,M,,", e, 500 + e);
+			CHECK(input(&ctx, mode, body));
+			// 12:35:21 缺少 GSA
+			if (e != 21)
+			{
+				CHECK(input(&ctx, mode, "$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1"));
+			}
+			// 凑齐后才到的同一时间的 GLL 不再单独输出
+			snprintf(body, sizeof(body), "$GPGLL,4807.038,N,01131.000,E,1235%02d,A,A", e);
+			CHECK(input(&ctx, mode, body));
+			fnmea_epoch_poll(&ctx, (uint32_t)e * 10);
+		}
+		// 12:35:21 在 12:35:22 的 RMC 到达时输出，GLL 计入其中
+		CHECK(epoch_count == 4);
+		CHECK((epoch_time[0] == 123519) && (epoch_time[1] == 123520) && (epoch_time[2] == 123521) && (epoch_time[3] == 123522));
+		CHECK(epoch_seen[0] == expect);
+		CHECK(epoch_seen[2] == (FNMEA_EPOCH(FNMEA_CMD_GGA) | FNMEA_EPOCH(FNMEA_CMD_RMC) | FNMEA_EPOCH(FNMEA_CMD_GLL)));
+		CHECK(epoch_alti[2] == 521 * 4096);
+		CHECK(!fnmea_epoch_flush(&ctx));
+
+		// 数据中断时由超时输出
+		CHECK(input(&ctx, mode, "$GPRMC,123523,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W"));
+		CHECK(!fnmea_epoch_poll(&ctx, 300));
+		CHECK(fnmea_epoch_poll(&ctx, 400));
+		CHECK((epoch_count == 5) && (epoch_seen[4] == FNMEA_EPOCH(FNMEA_CMD_RMC)));
+		CHECK(!fnmea_epoch_poll(&ctx, 1000));
+
+		// 失去定位后不再以旧时间输出
+		CHECK(input(&ctx, mode, "$GPRMC,,V,,,,,,,,,,N"));
+		CHECK(input(&ctx, mode, "$GPGGA,,,,,,0,00,99.99,,,,,,"));
+		CHECK(input(&ctx, mode, "$GPGSA,A,1,,,,,,,,,,,,,99.99,99.99,99.99"));
+		CHECK((epoch_count == 6) && (epoch_time[5] == 0));
+	}
+}
+
+static int handler_calls;
+static fnmea_type_e handler_type;
+static uint32_t handler_value;
+
+static FNMEA_Error_Type heading_handler(fnmea_ctx_t *ctx, const char *s, const fnmea_tokens_t *tokens)
+{
+	fnmea_field_t field;
+
+	handler_calls++;
+	handler_type = ctx->work.type;
+	if (!fnmea_token_field(s, tokens, 1, &field))
+	{
+		return FNMEA_Error_Format;
+	}
+	handler_value = field.integer;
+	return FNMEA_Error_None;
+}
+
+static void test_registry(void)
+{
+	fnmea_registry_t registry;
+	fnmea_ctx_t ctx;
+
+	fnmea_registry_init(&registry);
+	CHECK(fnmea_register(&registry, "HDT", heading_handler) == FNMEA_Error_None);
+	CHECK(fnmea_register(&registry, "PUBX", heading_handler) == FNMEA_Error_None);
+	CHECK(fnmea_register(&registry, "GGA", heading_handler) == FNMEA_Error_Parse_CMD_type);
+	CHECK(fnmea_register(&registry, "HD", heading_handler) == FNMEA_Error_Format);
+	CHECK(fnmea_register(&registry, "Hdt", heading_handler) == FNMEA_Error_Format);
+	CHECK(fnmea_register(&registry, "XUBX", heading_handler) == FNMEA_Error_Format);
+	CHECK(fnmea_register(&registry, "PUBX0000", heading_handler) == FNMEA_Error_None);
+	CHECK(fnmea_register(&registry, "PUBX00000", heading_handler) == FNMEA_Error_Format);
+	CHECK(registry.count == 3);
+
+	fnmea_init(&ctx, 0, 0);
+	fnmea_set_registry(&ctx, &registry);
+
+	// 卫星导航讲话者
+	handler_calls = 0;
+	CHECK(parse(&ctx, "$GPHDT,274.07,T") == FNMEA_Error_None);
+	CHECK((handler_calls == 1) && (handler_value == 274) && (handler_type == FNMEA_TYPE_GP));
+
+	// 非卫星导航讲话者：电罗经、综合仪表
+	CHECK(parse(&ctx, "$HEHDT,275.10,T") == FNMEA_Error_None);
+	CHECK((handler_calls == 2) && (handler_value == 275) && (handler_type == FNMEA_TYPE_Unknown));
+	CHECK(parse(&ctx, "$IIHDT,276.00,T") == FNMEA_Error_None);
+	CHECK((handler_calls == 3) && (handler_value == 276));
+	CHECK(ctx.nmea.type == FNMEA_TYPE_Unknown);
+
+	// 未注册的语句：讲话者未知时报告讲话者错误
+	CHECK(parse(&ctx, "$HEROT,1.0,A") == FNMEA_Error_Parse_type);
+	CHECK(parse(&ctx, "$GPROT,1.0,A") == FNMEA_Error_Parse_CMD_type);
+	CHECK(handler_calls == 3);
+
+	// 内置语句只接受卫星导航讲话者
+	CHECK(parse(&ctx, "$IIGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,") == FNMEA_Error_Parse_type);
+	CHECK(parse(&ctx, "$GAGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,") == FNMEA_Error_None);
+	CHECK(ctx.nmea.type == FNMEA_TYPE_GA);
+	CHECK(parse(&ctx, "$GBGSA,A,3,,,,,,,,,,,,,2.5,1.3,2.1") == FNMEA_Error_None);
+	CHECK(ctx.nmea.type == FNMEA_TYPE_BD);
+
+	// 专有语句按完整地址字段查找
+	CHECK(parse(&ctx, "$PUBX,00,081350.00") == FNMEA_Error_None);
+	CHECK((handler_calls == 4) && (handler_type == FNMEA_TYPE_Proprietary));
+	CHECK(parse(&ctx, "$PGRMZ,246,f,3") == FNMEA_Error_Parse_CMD_type);
+
+	// 流式解析不处理自定义语句
+	CHECK(feed(&ctx, "$HEHDT,275.10,T") == 0);
+	CHECK(feed(&ctx, "$PUBX,00,081350.00") == 0);
+	CHECK(handler_calls == 4);
+}
+
+static fnmea_tokens_t token_got;
+
+static FNMEA_Error_Type token_handler(fnmea_ctx_t *ctx, const char *s, const fnmea_tokens_t *tokens)
+{
+	(void)ctx;
+	(void)s;
+	token_got = *tokens;
+	return FNMEA_Error_None;
+}
+
+/// @brief 逐字节记录字段位置，作为参考结果
+static void token_reference(const char *s, fnmea_tokens_t *tokens)
+{
+	uint32_t start = 1;
+
+	tokens->count = 0;
+	for (uint32_t pos = 1; s[pos] != '\0'; pos++)
+	{
+		if ((s[pos] == ',') || (s[pos] == '*'))
+		{
+			if (tokens->count < FNMEA_FIELDS_MAX)
+			{
+				tokens->start[tokens->count] = (uint16_t)start;
+				tokens->length[tokens->count] = (uint16_t)(pos - start);
+				tokens->count++;
+			}
+			start = pos + 1;
+			if (s[pos] == '*')
+			{
+				tokens->star = (uint16_t)pos;
+				break;
+			}
+		}
+	}
+}
+
+/// @brief 一次扫描得到的字段位置与逐字节扫描相同：空字段、字段跨越 8 / 16 字节边界、超过 FNMEA_FIELDS_MAX 的字段
+static void test_tokens(void)
+{
+	static const char chars[] = "0123456789ABCDEF.-";
+	fnmea_registry_t registry;
+	fnmea_tokens_t expect;
+	fnmea_field_t field;
+	fnmea_ctx_t ctx;
+	char body[200];
+	const char *s;
+	uint32_t seed = 7;
+	uint32_t len;
+	uint32_t fields;
+	uint32_t width;
+	uint32_t capped = 0;
+
+	fnmea_registry_init(&registry);
+	CHECK(fnmea_register(&registry, "PTOK", token_handler) == FNMEA_Error_None);
+	fnmea_init(&ctx, 0, 0);
+	fnmea_set_registry(&ctx, &registry);
+
+	for (uint32_t n = 0; n < 5000; n++)
+	{
+		seed = seed * 1103515245u + 12345u;
+		fields = (seed >> 16) % 32;
+		len = (uint32_t)snprintf(body, sizeof(body), "$PTOK");
+		for (uint32_t f = 0; f < fields; f++)
+		{
+			if (len + 16 >= sizeof(body))
+			{
+				fields = f;
+				break;
+			}
+			seed = seed * 1103515245u + 12345u;
+			width = (seed >> 16) % 9;
+			body[len++] = ',';
+			for (uint32_t c = 0; c < width; c++)
+			{
+				body[len++] = chars[(seed >> (c * 3)) % (sizeof(chars) - 1)];
+			}
+		}
+		body[len] = '\0';
+		s = sentence(body);
+		memset(&token_got, 0xAA, sizeof(token_got));
+		CHECK(parse(&ctx, body) == FNMEA_Error_None);
+		token_reference(s, &expect);
+		CHECK((token_got.count == expect.count) && (token_got.star == expect.star));
+		CHECK(memcmp(token_got.start, expect.start, expect.count * sizeof(expect.start[0])) == 0);
+		CHECK(memcmp(token_got.length, expect.length, expect.count * sizeof(expect.length[0])) == 0);
+		capped += (fields + 1 > FNMEA_FIELDS_MAX);
+	}
+	CHECK(capped != 0);
+
+	// 随机访问字段，空字段与超出范围的序号返回 false
+	s = sentence("$PTOK,12,,345,6");
+	CHECK(parse(&ctx, "$PTOK,12,,345,6") == FNMEA_Error_None);
+	CHECK((token_got.count == 5) && (token_got.star == 15));
+	CHECK(fnmea_token_field(s, &token_got, 3, &field) && (field.integer == 345));
+	CHECK(fnmea_token_field(s, &token_got, 4, &field) && (field.integer == 6));
+	CHECK(!fnmea_token_field(s, &token_got, 2, &field));
+	CHECK(!fnmea_token_field(s, &token_got, 5, &field));
+}
+
+/// @brief 逐字节累加字段，作为字段数值的参考结果
+static void field_reference(const char *str, uint32_t len, fnmea_field_t *field)
+{
+	uint64_t integer = 0;
+
+	*field = (fnmea_field_t){0};
+	for (uint32_t i = 0; i < len; i++)
+	{
+		if (i == 0)
+		{
+			field->head = str[0];
+		}
+		field->length++;
+		if ((str[i] >= '0') && (str[i] <= '9'))
+		{
+			if ((field->flags & FNMEA_FIELD_DOT) == 0)
+			{
+				integer = integer * 10 + (uint64_t)(str[i] - '0');
+				field->flags |= (integer > UINT32_MAX) ? FNMEA_FIELD_INVALID : 0;
+				integer = (integer > UINT32_MAX) ? UINT32_MAX : integer;
+			}
+			else if (field->frac_digits < 9)
+			{
+				field->frac = field->frac * 10 + (uint32_t)(str[i] - '0');
+				field->frac_digits++;
+			}
+		}
+		else if ((str[i] == '.') && ((field->flags & FNMEA_FIELD_DOT) == 0))
+		{
+			field->flags |= FNMEA_FIELD_DOT;
+		}
+		else if ((str[i] == '-') && (i == 0))
+		{
+			field->flags |= FNMEA_FIELD_NEGATIVE;
+		}
+		else
+		{
+			field->flags |= FNMEA_FIELD_INVALID;
+		}
+	}
+	field->integer = (uint32_t)integer;
+}
+
+/// @brief 整条语句解析的字段（fscan 转换）与逐字节累加相同，无效字段同样标记为无效：溢出边界、超过 9 位的小数、符号与非法字符
+static void test_fields(void)
+{
+	static const char *edge[] = {"4294967295", "4294967296", "04294967295", "99999999999", "12.3456789012",
+								 "-1.5", "1-2", "1.2.3", ".", "-", "-.5", "5.", "00000000012345678.9", "N"};
+	static const char chars[] = "0123456789000.-A";
+	fnmea_registry_t registry;
+	fnmea_field_t field;
+	fnmea_field_t expect;
+	fnmea_ctx_t ctx;
+	char body[64];
+	char str[24];
+	const char *s;
+	uint32_t seed = 11;
+	uint32_t len;
+
+	fnmea_registry_init(&registry);
+	CHECK(fnmea_register(&registry, "PTOK", token_handler) == FNMEA_Error_None);
+	fnmea_init(&ctx, 0, 0);
+	fnmea_set_registry(&ctx, &registry);
+
+	for (uint32_t n = 0; n < 20000; n++)
+	{
+		if (n < sizeof(edge) / sizeof(edge[0]))
+		{
+			len = (uint32_t)snprintf(str, sizeof(str), "%s", edge[n]);
+		}
+		else
+		{
+			seed = seed * 1103515245u + 12345u;
+			len = 1 + (seed >> 16) % 20;
+			for (uint32_t c = 0; c < len; c++)
+			{
+				seed = seed * 1103515245u + 12345u;
+				// 大部分为数字，少量小数点、负号与字母
+				str[c] = ((seed >> 24) < 200) ? (char)('0' + (seed >> 8) % 10) : chars[(seed >> 8) % (sizeof(chars) - 1)];
+			}
+			str[len] = '\0';
+		}
+		snprintf(body, sizeof(body), "$PTOK,%s", str);
+		s = sentence(body);
+		CHECK(parse(&ctx, body) == FNMEA_Error_None);
+		CHECK(fnmea_token_field(s, &token_got, 1, &field));
+		field_reference(str, len, &expect);
+		CHECK((field.head == expect.head) && (field.length == expect.length));
+		if ((expect.flags & FNMEA_FIELD_INVALID) == 0)
+		{
+			CHECK(field.flags == expect.flags);
+			CHECK((field.integer == expect.integer) && (field.frac == expect.frac) && (field.frac_digits == expect.frac_digits));
+		}
+		else
+		{
+			CHECK((field.flags & FNMEA_FIELD_INVALID) != 0);
+		}
+	}
+}
+
+#define FRAME_SENTENCES 2000
+
+/// @brief 批量定位的数据与应当通过校验的语句
+static char frame_data[FRAME_SENTENCES * 320];
+static uint32_t frame_len;
+static fnmea_span_t frame_expect[FRAME_SENTENCES];
+static uint32_t frame_expect_count;
+static fnmea_span_t frame_found[FRAME_SENTENCES];
+static uint32_t frame_found_count;
+
+static void frame_append(const char *text, bool valid)
+{
+	uint32_t len = (uint32_t)strlen(text);
+
+	if (valid)
+	{
+		frame_expect[frame_expect_count].offset = frame_len;
+		frame_expect[frame_expect_count].length = len - 2;
+		frame_expect_count++;
+	}
+	memcpy(frame_data + frame_len, text, len);
+	frame_len += len;
+}
+
+/// @brief 生成混有噪声、校验错误、缺少校验和、过长与中途断开的语句的数据，噪声长度使语句落在各种对齐位置
+static void frame_fill(void)
+{
+	char body[128];
+	char text[320];
+	const char *s;
+
+	for (uint32_t i = 0; i < FRAME_SENTENCES; i++)
+	{
+		snprintf(body, sizeof(body), "$GPGGA,12%04u,4807.%03u,N,01131.000,E,1,08,0.9,%u.4,M,46.9,M,,", i, i % 1000, i);
+		s = sentence(body);
+		switch (i % 7)
+		{
+		case 1:
+			memset(text, 'x', i % 37);
+			snprintf(text + i % 37, sizeof(text) - i % 37, " noise %u\r\n", i);
+			frame_append(text, false);
+			break;
+		case 2:
+			snprintf(text, sizeof(text), "%s", s);
+			text[10] = (char)(text[10] ^ 0x01);
+			frame_append(text, false);
+			break;
+		case 3:
+			snprintf(text, sizeof(text), "%s\r\n", body);
+			frame_append(text, false);
+			break;
+		case 4:
+			text[0] = '$';
+			memset(text + 1, 'A', 300);
+			snprintf(text + 301, sizeof(text) - 301, "\r\n");
+			frame_append(text, false);
+			break;
+		case 5:
+			frame_append("$GPRMC,12", false);
+			frame_append(s, true);
+			break;
+		default:
+			frame_append(s, true);
+			break;
+		}
+	}
+}
+
+/// @brief 对一块数据反复调用 fnmea_frame，记录语句的绝对位置
+/// @return 已处理的字节数
+static uint32_t frame_block(const char *buf, uint32_t len, uint32_t base)
+{
+	fnmea_span_t spans[16];
+	uint32_t pos = 0;
+	uint32_t count;
+	uint32_t used;
+
+	do
+	{
+		count = fnmea_frame(buf + pos, len - pos, spans, 16, &used);
+		for (uint32_t i = 0; (i < count) && (frame_found_count < FRAME_SENTENCES); i++)
+		{
+			frame_found[frame_found_count].offset = base + pos + spans[i].offset;
+			frame_found[frame_found_count].length = spans[i].length;
+			frame_found_count++;
+		}
+		pos += used;
+	} while (count == 16);
+	return pos;
+}
+
+static bool frame_match(void)
+{
+	return (frame_found_count == frame_expect_count) &&
+		   (memcmp(frame_found, frame_expect, frame_expect_count * sizeof(fnmea_span_t)) == 0);
+}
+
+/// @brief 批量定位只输出通过校验的语句；按任意大小分块输入并拼接未处理部分，结果不变
+static void test_frame(void)
+{
+	static char window[1024 + FNMEA_BUFFER_MAX_SIZE];
+	uint32_t seed = 1;
+	uint32_t base = 0;
+	uint32_t fill = 0;
+	uint32_t pos = 0;
+	uint32_t step;
+	uint32_t used;
+
+	frame_fill();
+	frame_found_count = 0;
+	CHECK(frame_block(frame_data, frame_len, 0) <= frame_len);
+	CHECK(frame_match());
+
+	// 每次追加 1..1024 字节，未处理的部分移到窗口开头
+	frame_found_count = 0;
+	while (pos < frame_len)
+	{
+		seed = seed * 1103515245u + 12345u;
+		step = 1 + (seed >> 16) % 1024;
+		step = (step > frame_len - pos) ? (frame_len - pos) : step;
+		step = (step > sizeof(window) - fill) ? (uint32_t)(sizeof(window) - fill) : step;
+		memcpy(window + fill, frame_data + pos, step);
+		fill += step;
+		pos += step;
+		used = frame_block(window, fill, base);
+		memmove(window, window + used, fill - used);
+		fill -= used;
+		base += used;
+	}
+	CHECK(fill < FNMEA_BUFFER_MAX_SIZE);
+	CHECK(frame_match());
+}
+
+#define STREAMS 4
+#define STREAM_EPOCHS 2000
+
+/// @brief 一个接收机的数据流与解析结果
+typedef struct
+{
+	char data[STREAM_EPOCHS * 160];
+	uint32_t len;
+	fnmea_ctx_t ctx;
+	uint32_t epochs;
+} stream_t;
+
+static stream_t streams[STREAMS];
+static stream_t reference[STREAMS];
+
+static void stream_epoch(fnmea_ctx_t *ctx, const fnmea_t *fix, uint32_t seen)
+{
+	(void)fix;
+	(void)seen;
+	((stream_t *)ctx->user)->epochs++;
+}
+
+/// @brief 生成第 id 个接收机的数据流，各数据流的讲话者、位置与海拔不同
+static void stream_fill(stream_t *s, uint32_t id)
+{
+	static const char *const talkers[STREAMS] = {"GP", "GN", "BD", "GA"};
+	char body[128];
+	const char *line;
+
+	s->len = 0;
+	for (uint32_t e = 0; e < STREAM_EPOCHS; e++)
+	{
+		snprintf(body, sizeof(body), "$%sGGA,%02u%02u%02u,48%02u.%03u,N,011%02u.%03u,E,1,08,0.9,%u.%u,M,46.9,M,,",
+				 talkers[id], 10 + id, e / 60 % 60, e % 60, (e + id) % 60, e % 1000, id * 7, (e * 3) % 1000,
+				 100 * id + e % 97, e % 10);
+		line = sentence(body);
+		memcpy(s->data + s->len, line, strlen(line));
+		s->len += (uint32_t)strlen(line);
+		snprintf(body, sizeof(body), "$%sRMC,%02u%02u%02u,A,48%02u.%03u,N,011%02u.%03u,E,%03u.%u,084.4,230394,003.1,W",
+				 talkers[id], 10 + id, e / 60 % 60, e % 60, (e + id) % 60, e % 1000, id * 7, (e * 3) % 1000, e % 200,
+				 id);
+		line = sentence(body);
+		memcpy(s->data + s->len, line, strlen(line));
+		s->len += (uint32_t)strlen(line);
+	}
+}
+
+/// @brief 流式解析整个数据流，按不同的块大小输入
+static void *stream_parse(void *arg)
+{
+	stream_t *s = (stream_t *)arg;
+	uint32_t step = 1 + (uint32_t)(s - streams) * 17;
+
+	fnmea_init(&s->ctx, 0, s);
+	fnmea_epoch_init(&s->ctx, stream_epoch, FNMEA_EPOCH(FNMEA_CMD_GGA) | FNMEA_EPOCH(FNMEA_CMD_RMC), 0);
+	for (uint32_t pos = 0; pos < s->len; pos += step)
+	{
+		fnmea_feed_n(&s->ctx, (const uint8_t *)s->data + pos, (s->len - pos < step) ? (s->len - pos) : step);
+	}
+	return 0;
+}
+
+/// @brief 多个线程各自解析一个数据流，结果与逐个顺序解析相同
+static void test_streams(void)
+{
+	pthread_t tid[STREAMS];
+
+	for (uint32_t i = 0; i < STREAMS; i++)
+	{
+		stream_fill(&streams[i], i);
+		memcpy(reference[i].data, streams[i].data, streams[i].len);
+		reference[i].len = streams[i].len;
+		stream_parse(&reference[i]);
+	}
+	for (uint32_t i = 0; i < STREAMS; i++)
+	{
+		pthread_create(&tid[i], 0, stream_parse, &streams[i]);
+	}
+	for (uint32_t i = 0; i < STREAMS; i++)
+	{
+		pthread_join(tid[i], 0);
+	}
+	for (uint32_t i = 0; i < STREAMS; i++)
+	{
+		CHECK(streams[i].ctx.sentences == STREAM_EPOCHS * 2);
+		CHECK(streams[i].ctx.errors == 0);
+		CHECK(streams[i].epochs == STREAM_EPOCHS);
+		CHECK(memcmp(&streams[i].ctx.nmea, &reference[i].ctx.nmea, sizeof(fnmea_t)) == 0);
+	}
+	CHECK(streams[0].ctx.nmea.locate.alti != streams[1].ctx.nmea.locate.alti);
+}
+
+int main(void)
+{
+	test_feed_parse();
+	test_empty_fields();
+	test_epoch();
+	test_registry();
+	test_tokens();
+	test_fields();
+	test_frame();
+	test_streams();
+	if (failures != 0)
+	{
+		printf("test_fnmea: %d failed\n", failures);
+		return 1;
+	}
+	printf("test_fnmea: ok\n");
+	return 0;
+}
@@ -0,0 +1,280 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: test/test_fscan.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: fscan 整数与定点小数解析测试
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 随机数字串的期望值由逐位累加的参考实现得到，定点小数的期望值用 128 位整数精确计算：
+ * round((integer * 10^n + frac) * 2^q / 10^n)，按绝对值四舍五入
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "utl_fscan.h"
+
+static int failures;
+
+#define CHECK(expr)                                                         \
+	do                                                                      \
+	{                                                                       \
+		if (!(expr))                                                        \
+		{                                                                   \
+			printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+			failures++;                                                     \
+		}                                                                   \
+	} while (0)
+
+/// @brief 解析字符串字面量，检查返回值与结果
+#define CHECK_U32(fun, str, ret, num)                           \
+	do                                                          \
+	{                                                           \
+		uint32_t got_ = 0xDEADBEEF;                             \
+		CHECK(fun(str, sizeof(str) - 1, &got_) == (ret));       \
+		CHECK(got_ == ((ret) > 0 ? (num) : 0xDEADBEEF));        \
+	} while (0)
+
+#define CHECK_I32(str, ret, num)                                \
+	do                                                          \
+	{                                                           \
+		int32_t got_ = 0x5A5A5A5A;                              \
+		CHECK(fscan_i32(str, sizeof(str) - 1, &got_) == (ret)); \
+		CHECK(got_ == ((ret) > 0 ? (num) : 0x5A5A5A5A));        \
+	} while (0)
+
+#define CHECK_FQ(str, q, ret, num)                              \
+	do                                                          \
+	{                                                           \
+		int32_t got_ = 0x5A5A5A5A;                              \
+		CHECK(fscan_fq(str, sizeof(str) - 1, q, &got_) == (ret)); \
+		CHECK(got_ == ((ret) > 0 ? (num) : 0x5A5A5A5A));        \
+	} while (0)
+
+static uint32_t seed = 1;
+
+/// @brief 固定种子的伪随机数，结果可复现
+static uint32_t next(void)
+{
+	seed = seed * 1103515245u + 12345u;
+	return seed >> 8;
+}
+
+/// @brief 整数边界：2^32-1、INT32_MIN 与溢出
+static void test_integer(void)
+{
+	CHECK_U32(fscan_u32, "0", 1, 0u);
+	CHECK_U32(fscan_u32, "4294967295", 10, UINT32_MAX);
+	CHECK_U32(fscan_u32, "4294967296", FSCAN_Error_Overflow, 0u);
+	CHECK_U32(fscan_u32, "99999999999", FSCAN_Error_Overflow, 0u);
+	CHECK_U32(fscan_u32, "00000000000000004294967295", 26, UINT32_MAX);
+	CHECK_U32(fscan_u32, "123,45", 3, 123u);
+	CHECK_U32(fscan_u32, "", FSCAN_Error_Empty, 0u);
+	CHECK_U32(fscan_u32, "+1", FSCAN_Error_Empty, 0u);
+	CHECK_U32(fscan_u32, "x1", FSCAN_Error_Empty, 0u);
+
+	CHECK_I32("2147483647", 10, INT32_MAX);
+	CHECK_I32("+2147483647", 11, INT32_MAX);
+	CHECK_I32("2147483648", FSCAN_Error_Overflow, 0);
+	CHECK_I32("-2147483648", 11, INT32_MIN);
+	CHECK_I32("-2147483649", FSCAN_Error_Overflow, 0);
+	CHECK_I32("-0", 2, 0);
+	CHECK_I32("-", FSCAN_Error_Empty, 0);
+	CHECK_I32("--1", FSCAN_Error_Empty, 0);
+	CHECK_I32("-12a", 3, -12);
+
+	// 长度限制优先于字符串内容
+	{
+		uint32_t num = 0;
+		CHECK(fscan_u32("12345", 3, &num) == 3 && num == 123);
+		CHECK(fscan_u32("12345", 0, &num) == FSCAN_Error_Empty);
+	}
+}
+
+/// @brief 十六进制：大小写、溢出、不含前缀
+static void test_hex(void)
+{
+	CHECK_U32(fscan_hex, "0", 1, 0u);
+	CHECK_U32(fscan_hex, "ff", 2, 0xFFu);
+	CHECK_U32(fscan_hex, "DeadBeef", 8, 0xDEADBEEFu);
+	CHECK_U32(fscan_hex, "FFFFFFFF", 8, UINT32_MAX);
+	CHECK_U32(fscan_hex, "0000000012345678", 16, 0x12345678u);
+	CHECK_U32(fscan_hex, "100000000", FSCAN_Error_Overflow, 0u);
+	CHECK_U32(fscan_hex, "0x1F", 1, 0u);
+	CHECK_U32(fscan_hex, "1fg", 2, 0x1Fu);
+	CHECK_U32(fscan_hex, "g", FSCAN_Error_Empty, 0u);
+}
+
+/// @brief 按位数生成数字串，覆盖 8 位并行转换与逐位转换的边界
+static void test_digits(void)
+{
+	static const uint32_t lengths[] = {1, 7, 8, 9, 10, 15, 16, 17};
+	char str[32];
+	uint64_t want;
+	uint32_t num;
+	uint32_t len;
+	int32_t ret;
+
+	for (uint32_t i = 0; i < 20000; i++)
+	{
+		len = lengths[i % (sizeof(lengths) / sizeof(lengths[0]))];
+		// 一半数字串带前导 0，使长数字串的有效位数不超过 10 位
+		want = 0;
+		for (uint32_t k = 0; k < len; k++)
+		{
+			str[k] = (char)('0' + ((((i >> 3) & 1) && (k + 10 < len)) ? 0 : next() % 10));
+			want = (want < 100000000000ULL) ? want * 10 + (uint64_t)(str[k] - '0') : want;
+		}
+		// 数字串后跟非数字字符，8 字节读取不能越过它
+		str[len] = (char)("/:.,*a "[i % 7]);
+		str[len + 1] = '9';
+		num = 0;
+		ret = fscan_u32(str, len + 2, &num);
+		if (want > UINT32_MAX)
+		{
+			CHECK(ret == FSCAN_Error_Overflow);
+		}
+		else
+		{
+			CHECK(ret == (int32_t)len);
+			CHECK(num == (uint32_t)want);
+		}
+		// 截短最大长度时停在长度处
+		ret = fscan_u32(str, len - 1, &num);
+		CHECK((len == 1) ? (ret == FSCAN_Error_Empty) : (ret == FSCAN_Error_Overflow || ret == (int32_t)len - 1));
+	}
+}
+
+/// @brief 定点小数的精确期望值
+/// @return 是否在 int32 范围内
+static bool fq_expect(uint64_t integer, uint64_t frac, uint32_t digits, uint8_t q, bool negative, int32_t *num)
+{
+	unsigned __int128 den = 1;
+	unsigned __int128 value;
+
+	for (uint32_t i = 0; i < digits; i++)
+	{
+		den *= 10;
+	}
+	value = ((unsigned __int128)integer * den + frac) << q;
+	// 四舍五入：余数的两倍不小于除数时进位
+	value = (value + den / 2) / den;
+	if (value > (unsigned __int128)INT32_MAX + negative)
+	{
+		return false;
+	}
+	*num = negative ? (int32_t)(0u - (uint32_t)value) : (int32_t)value;
+	return true;
+}
+
+/// @brief 定点小数：Q0 / Q12 / Q30、四舍五入、截取 18 位小数
+static void test_fq(void)
+{
+	char str[64];
+	uint64_t integer;
+	uint64_t frac;
+	uint32_t digits;
+	uint32_t len;
+	uint8_t q;
+	bool negative;
+	int32_t want;
+	int32_t num;
+	int32_t ret;
+
+	// 按绝对值四舍五入
+	CHECK_FQ("0.5", 0, 3, 1);
+	CHECK_FQ("-0.5", 0, 4, -1);
+	CHECK_FQ("2.5", 0, 3, 3);
+	CHECK_FQ("-2.5", 0, 4, -3);
+	CHECK_FQ("0.49999", 0, 7, 0);
+	CHECK_FQ("1.00012207031249", 12, 16, 4096);
+	CHECK_FQ("1.0001220703125", 12, 15, 4097);
+	CHECK_FQ("-1.0001220703125", 12, 16, -4097);
+	CHECK_FQ("1.5", 30, 3, 0x60000000);
+	CHECK_FQ("-2", 30, 2, INT32_MIN);
+	CHECK_FQ("2", 30, FSCAN_Error_Overflow, 0);
+	CHECK_FQ("1.999999999", 30, 11, INT32_MAX);
+	CHECK_FQ("1.99999999996", 30, FSCAN_Error_Overflow, 0);
+	CHECK_FQ("0.000000000465661287", 30, 20, 0);
+	CHECK_FQ("0.000000000465661288", 30, 20, 1);
+	CHECK_FQ("2147483647", 0, 10, INT32_MAX);
+	CHECK_FQ("-2147483648", 0, 11, INT32_MIN);
+	CHECK_FQ("2147483647.5", 0, FSCAN_Error_Overflow, 0);
+	CHECK_FQ("524287.99987792", 12, 15, INT32_MAX);
+	CHECK_FQ("524288", 12, FSCAN_Error_Overflow, 0);
+	// 空数字与省略部分
+	CHECK_FQ(".5", 12, 2, 2048);
+	CHECK_FQ("5.", 12, 2, 20480);
+	CHECK_FQ("-.25", 12, 4, -1024);
+	CHECK_FQ(".", 12, FSCAN_Error_Empty, 0);
+	CHECK_FQ("-", 12, FSCAN_Error_Empty, 0);
+	CHECK_FQ("", 12, FSCAN_Error_Empty, 0);
+	CHECK_FQ("1.2.3", 12, 3, 4915);
+	CHECK_FQ("1", 31, FSCAN_Error_ArgsErr, 0);
+	CHECK(fscan_fq12("0.25", 4, &num) == 4 && num == 1024);
+
+	// 随机小数与精确计算的期望值比较，小数位数覆盖 8 位并行转换的边界与 18 位截取
+	for (uint32_t i = 0; i < 20000; i++)
+	{
+		q = (uint8_t)((i % 3 == 0) ? 0 : (i % 3 == 1) ? 12 : next() % 31);
+		negative = (next() & 1) != 0;
+		integer = next() % ((uint64_t)1 << (31 - q));
+		digits = next() % 21;
+		len = (uint32_t)snprintf(str, sizeof(str), "%s%llu.", negative ? "-" : "", (unsigned long long)integer);
+		frac = 0;
+		for (uint32_t k = 0; k < digits; k++)
+		{
+			str[len] = (char)('0' + next() % 10);
+			if (k < 18)
+			{
+				frac = frac * 10 + (uint64_t)(str[len] - '0');
+			}
+			len++;
+		}
+		str[len] = ',';
+		ret = fscan_fq(str, len + 1, q, &num);
+		if (!fq_expect(integer, frac, (digits < 18) ? digits : 18, q, negative, &want))
+		{
+			CHECK(ret == FSCAN_Error_Overflow);
+			continue;
+		}
+		CHECK(ret == (int32_t)len);
+		CHECK(num == want);
+	}
+}
+
+int main(void)
+{
+	test_integer();
+	test_hex();
+	test_digits();
+	test_fq();
+	printf("test_fscan: %s\n", failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: test/test_fsink.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: fsink 崩溃恢复测试
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ * 
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "utl_fsink.h"
+
+static int failures;
+
+#define CHECK(expr)                                                         \
+    do                                                                      \
+    {                                                                       \
+        if (!(expr))                                                        \
+        {                                                                   \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+#define SEGMENT_SIZE 4096
+
+/// @brief 读取分段文件
+/// @return 文件长度，不存在时为 -1
+static long load(const char *path, char *buf, long max)
+{
+    FILE *f = fopen(path, "rb");
+    long n;
+
+    if (f == 0)
+    {
+        return -1;
+    }
+    n = (long)fread(buf, 1, (size_t)max, f);
+    fclose(f);
+    return n;
+}
+
+/// @brief 生成包含 0 字节的二进制记录，seed 除以 5 余 1 时最后一个字节为 0
+static void record(char *buf, uint32_t len, uint32_t seed)
+{
+    for (uint32_t i = 0; i < len; i++)
+    {
+        buf[i] = (char)(((seed + i) % 5 == 0) ? 0 : (seed * 31 + i));
+    }
+}
+
+/// @brief 子进程写入后不关闭直接退出，模拟崩溃
+static void crash_after(const char *prefix, uint32_t seed, uint32_t count)
+{
+    pid_t pid = fork();
+    char buf[100];
+
+    if (pid == 0)
+    {
+        fsink_open(prefix, SEGMENT_SIZE, 2, FSINK_Sync_None);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            record(buf, sizeof(buf), seed + i);
+            fsink_output(buf, sizeof(buf));
+        }
+        _exit(0);
+    }
+    waitpid(pid, 0, 0);
+}
+
+static void test_recover(void)
+{
+    char prefix[64];
+    char path[80];
+    char file[2 * SEGMENT_SIZE];
+    char expect[100];
+    long n;
+
+    snprintf(prefix, sizeof(prefix), "/tmp/test_fsink_%d", (int)getpid());
+    snprintf(path, sizeof(path), "%s.0.log", prefix);
+    unlink(path);
+
+    // 崩溃后分段保持完整大小，结尾的长度记录给出有效长度
+    crash_after(prefix, 0, 10);
+    n = load(path, file, sizeof(file));
+    CHECK(n == SEGMENT_SIZE);
+    CHECK(fsink_recover(file, (uint32_t)n) == 1000);
+
+    // 重新打开后在有效结尾继续追加，记录中的 0 字节不会被当作结尾
+    crash_after(prefix, 10, 5);
+    n = load(path, file, sizeof(file));
+    CHECK(fsink_recover(file, (uint32_t)n) == 1500);
+
+    // 正常关闭后截断到有效长度
+    CHECK(fsink_open(prefix, SEGMENT_SIZE, 2, FSINK_Sync_Rotate) == FSINK_Error_None);
+    record(expect, sizeof(expect), 15);
+    fsink_output(expect, sizeof(expect));
+    fsink_close();
+    n = load(path, file, sizeof(file));
+    CHECK(n == 1600);
+    CHECK(fsink_recover(file, (uint32_t)n) == 1600);
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        record(expect, sizeof(expect), i);
+        CHECK(memcmp(file + i * 100, expect, sizeof(expect)) == 0);
+    }
+
+    // 写满时切换分段，新分段从头开始
+    crash_after(prefix, 100, 30);
+    n = load(path, file, sizeof(file));
+    CHECK(n == SEGMENT_SIZE);
+    CHECK(fsink_recover(file, (uint32_t)n) == 600);
+    snprintf(path, sizeof(path), "%s.1.log", prefix);
+    n = load(path, file, sizeof(file));
+    CHECK(n == 4000);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s.0.log", prefix);
+    unlink(path);
+}
+
+/// @brief 以 0 结尾的二进制记录（如校验和为 0 的 TLV 记录）完整写入
+static void test_binary_tail(void)
+{
+    static const char records[2][4] = {{(char)0xF6, 1, 2, 0}, {(char)0xF6, 0, 0, 0}};
+    char prefix[64];
+    char path[80];
+    char file[64];
+    long n;
+
+    snprintf(prefix, sizeof(prefix), "/tmp/test_fsink_tail_%d", (int)getpid());
+    snprintf(path, sizeof(path), "%s.0.log", prefix);
+    unlink(path);
+    CHECK(fsink_open(prefix, SEGMENT_SIZE, 1, FSINK_Sync_None) == FSINK_Error_None);
+    fsink_output((char *)records[0], sizeof(records[0]));
+    fsink_output((char *)records[1], sizeof(records[1]));
+    fsink_close();
+    n = load(path, file, sizeof(file));
+    CHECK(n == sizeof(records));
+    CHECK(memcmp(file, records, sizeof(records)) == 0);
+    unlink(path);
+}
+
+int main(void)
+{
+    test_recover();
+    test_binary_tail();
+    if (failures != 0)
+    {
+        printf("test_fsink: %d failed\n", failures);
+        return 1;
+    }
+    printf("test_fsink: ok\n");
+    return 0;
+}
@@ -51,10 +51,28 @@
   * [d]		有符号十进制整数
   * [f]		FQ12 定点小数
   * [u]		无符号十进制整数
-  * [x]		小写十六进制整数
+  * [x]		大写十六进制整数，按长度说明符补 0 输出 2 / 4 / 8 位
   * [s]		字符串
+  * [m]		字节数组十六进制转储，依次传入 uint8_t 指针与 uint32_t 长度
+  * [F]		double 浮点数，最短往返表示（需定义 FFMT_DOUBLE）
   * [%]		输出 "%"
   *
+  * [m] 的输出方式由说明符控制：
+  * %m		紧凑输出，如 "0A1BFF"
+  * %+m		空格分隔，如 "0A 1B FF"
+  * %lm		每行 16 字节并带偏移列，如 "00000000: 0A 1B FF"，行间以 "\n" 分隔
+  *
+  * [F] 的输出与 Python repr 相同：
+  * 小数点位置在 -4 ~ 16 之间时输出为 "0.0001"、"100.0"，否则输出为 "1e+16"、"1.5e-05"
+  * 无穷与非数输出为 "inf"、"nan"，与 locale 无关，不申请内存
+  *
+  * 与 printf 的差异：
+  * 1. 返回值包含结尾的 '\0'，即所需缓存长度，溢出时返回 -1
+  * 2. [d] [u] 始终按 32 位输出，长度说明符只影响 [x] 的位数
+  * 3. [x] 输出大写字母且固定位数，如 %x 输出 0x1A 为 "001A"
+  * 4. [f] 固定输出 5 位小数，多余精度直接截断而非四舍五入
+  * 5. [+] 只对 [d] [f] [F] 生效，0 按正数处理（"+0"、"+0.00000"）
+  *
   * 本 fmt 是 printf 的极致优化（残废）版本
   * 为性能低的嵌入式系统设计
   * 部分语法与 printf 不相同，请一定一定一定注意
@@ -71,7 +89,29 @@
 #include <stdarg.h>
 #include <stdbool.h>
 
+// 定义 FFMT_DOUBLE 宏 以支持 %F 格式化 double
+// 将多耗费 11 KiB 左右 Flash 空间，并需要 64 位乘除法，建议仅在主机端使能
+// #define FFMT_DOUBLE
+
+// 定义 FFMT_THREAD_SAFE 宏 使格式化状态为线程局部存储，允许多个线程同时调用 ffmt
+// 需要编译器支持 C11 _Thread_local
+// #define FFMT_THREAD_SAFE
+
+#ifdef FFMT_THREAD_SAFE
+#define FFMT_TLS _Thread_local
+#else
+#define FFMT_TLS
+#endif
+
 extern int32_t ffmt(char *buffer, uint32_t max_len, bool vs, char *fmt, ...);
 extern int32_t vsffmt(char *buffer, uint32_t max_len, char *fmt, va_list *agrs);
+extern int32_t ffmt_measure(bool vs, char *fmt, ...);
+extern int32_t vsffmt_measure(char *fmt, va_list *agrs);
+
+extern uint32_t ffmt_itoa(char *buffer, int32_t num);
+extern uint32_t ffmt_utoa(char *buffer, uint32_t num);
+extern uint32_t ffmt_fq12toa(char *buffer, int32_t num);
+extern int32_t ffmt_array(char *buffer, uint32_t max_len, const int32_t *array, uint32_t count,
+						  uint32_t cols, char type, const char *sep, const char *eol);
 
 #endif
@@ -0,0 +1,415 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: utl_fingest.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: fnmea 内存映射批量导入
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ * 
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+// madvise / MADV_SEQUENTIAL 与 _SC_NPROCESSORS_ONLN 不在严格的 ISO C 模式下声明
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "utl_fingest.h"
+
+// 每次定位的语句数
+#define FINGEST_SPANS (256)
+// 每次定位的最大长度
+#define FINGEST_FRAME_MAX (1U << 30) // Bytes
+
+/// @brief 一个数据块的输出
+typedef struct tagFINGEST_Part
+{
+	fingest_columns_t cols; /* 列 */
+	bool failed;			/* 内存分配失败 */
+	bool tail;				/* 正在解析块之后的数据，只输出块内最后一个历元 */
+} fingest_part_t;
+
+/// @brief 导入任务，由所有工作线程共享
+typedef struct tagFINGEST_Job
+{
+	const char *buf;		/* 数据 */
+	uint64_t len;			/* 数据长度 */
+	uint64_t *bounds;		/* 各块起始位置，共 chunks + 1 项 */
+	fingest_part_t *parts; /* 各块的输出 */
+	uint32_t chunks;		   /* 块数 */
+	atomic_uint next;		   /* 下一个待领取的块 */
+	atomic_int error;		   /* 第一个错误 */
+} fingest_job_t;
+
+/// @brief 扩大列容量
+/// @param cols 列
+/// @param capacity 新容量
+/// @return 是否成功
+static bool fingest_reserve(fingest_columns_t *cols, uint64_t capacity)
+{
+	void *p;
+
+#define FINGEST_GROW(col)                                          \
+	p = realloc(cols->col, (size_t)(capacity * sizeof(*cols->col))); \
+	if (p == 0)                                                      \
+	{                                                                \
+		return false;                                                \
+	}                                                                \
+	cols->col = p;
+
+	FINGEST_GROW(time);
+	FINGEST_GROW(lat);
+	FINGEST_GROW(lon);
+	FINGEST_GROW(alt);
+	FINGEST_GROW(speed);
+	FINGEST_GROW(course);
+	FINGEST_GROW(status);
+#undef FINGEST_GROW
+	cols->capacity = capacity;
+	return true;
+}
+
+/// @brief 经纬度转换为 1e-7 度
+/// @param degree 经纬度
+/// @param negative 是否为负（南纬、西经）
+/// @return 1e-7 度
+static int32_t fingest_degree(const fnmea_degree_t *degree, bool negative)
+{
+	// 分（单位 0.0001 分）/ 600000 * 1e7 = 分 * 50 / 3
+	int32_t value = (int32_t)degree->deg * 10000000 +
+					(int32_t)((((uint32_t)degree->min * 10000 + degree->min_dec) * 50) / 3);
+	return negative ? -value : value;
+}
+
+/// @brief 历元完成回调，不输出（预先解析与块之后的数据）
+/// @param ctx 解析上下文
+/// @param fix 合并后的记录
+/// @param seen 本历元收到的语句
+static void fingest_skip(fnmea_ctx_t *ctx, const fnmea_t *fix, uint32_t seen)
+{
+	(void)ctx;
+	(void)fix;
+	(void)seen;
+}
+
+/// @brief 历元完成回调，输出一行
+/// @param ctx 解析上下文
+/// @param fix 合并后的记录
+/// @param seen 本历元收到的语句
+static void fingest_row(fnmea_ctx_t *ctx, const fnmea_t *fix, uint32_t seen)
+{
+	fingest_part_t *part = (fingest_part_t *)ctx->user;
+	fingest_columns_t *cols = &part->cols;
+	uint64_t i = cols->count;
+
+	(void)seen;
+	// 块之后的数据中只有第一个输出的历元属于本块，之后的由下一块输出
+	if (part->tail)
+	{
+		ctx->epoch.callback = fingest_skip;
+	}
+	if ((i == cols->capacity) && !fingest_reserve(cols, (cols->capacity == 0) ? 4096 : cols->capacity * 2))
+	{
+		part->failed = true;
+		return;
+	}
+	cols->time[i] = (((uint32_t)fix->utc_time.hour * 60 + fix->utc_time.min) * 60 + fix->utc_time.sec) * 1000 +
+					fix->utc_time.msec;
+	cols->lat[i] = fingest_degree(&fix->locate.lati, fix->locate.lati.sign == 0);
+	cols->lon[i] = fingest_degree(&fix->locate.longi, fix->locate.longi.sign != 0);
+	cols->alt[i] = fix->locate.alti;
+	cols->speed[i] = fix->speed.speed_kph;
+	cols->course[i] = fix->angle.true_north;
+	cols->status[i] = (uint8_t)fix->staus;
+	cols->count = i + 1;
+}
+
+/// @brief 解析一段数据中的所有语句
+/// @param ctx 解析上下文
+/// @param buf 数据
+/// @param start 起始位置
+/// @param end 结束位置
+static void fingest_parse(fnmea_ctx_t *ctx, const char *buf, uint64_t start, uint64_t end)
+{
+	fnmea_span_t spans[FINGEST_SPANS];
+	uint64_t len;
+	uint32_t count;
+	uint32_t used;
+
+	while (start < end)
+	{
+		len = end - start;
+		count = fnmea_frame(buf + start, (len > FINGEST_FRAME_MAX) ? FINGEST_FRAME_MAX : (uint32_t)len, spans,
+							FINGEST_SPANS, &used);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			fnmea_parse_span(ctx, buf + start, &spans[i]);
+		}
+		// 没有填满时剩余部分只有不完整的语句
+		if ((count < FINGEST_SPANS) && (len <= FINGEST_FRAME_MAX))
+		{
+			break;
+		}
+		start += used;
+	}
+}
+
+/// @brief 工作线程，依次领取并解析数据块
+/// @param arg 导入任务
+/// @return NULL
+static void *fingest_worker(void *arg)
+{
+	fingest_job_t *job = (fingest_job_t *)arg;
+	fingest_part_t *part;
+	fnmea_ctx_t ctx;
+	uint64_t start;
+	uint64_t end;
+	uint64_t warmup;
+	uint32_t index;
+
+	while ((index = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed)) < job->chunks)
+	{
+		part = &job->parts[index];
+		start = job->bounds[index];
+		warmup = (start > FINGEST_WARMUP) ? (start - FINGEST_WARMUP) : 0;
+
+		end = job->bounds[index + 1];
+
+		// 预先解析前一块末尾的语句，不输出；未结束的历元由前一块输出，本块只合并其余语句
+		fnmea_init(&ctx, 0, part);
+		fnmea_epoch_init(&ctx, fingest_skip, 0, 0);
+		fingest_parse(&ctx, job->buf, warmup, start);
+		fnmea_epoch_flush(&ctx);
+		ctx.epoch.callback = fingest_row;
+		fingest_parse(&ctx, job->buf, start, end);
+
+		// 继续解析其后的语句，直到块内最后一个历元因 UTC 时间变化输出
+		if (ctx.epoch.open)
+		{
+			part->tail = true;
+			fingest_parse(&ctx, job->buf, end, ((job->len - end) > FINGEST_WARMUP) ? (end + FINGEST_WARMUP) : job->len);
+			fnmea_epoch_flush(&ctx);
+		}
+		if (part->failed)
+		{
+			atomic_store_explicit(&job->error, FINGEST_Error_Memory, memory_order_relaxed);
+		}
+	}
+	return 0;
+}
+
+/// @brief 按文件顺序合并各块的列
+/// @param job 导入任务
+/// @param cols 输出
+/// @return fingest_error_e 错误值
+static int32_t fingest_merge(fingest_job_t *job, fingest_columns_t *cols)
+{
+	uint64_t total = 0;
+	uint64_t offset = 0;
+	fingest_columns_t *part;
+
+	for (uint32_t i = 0; i < job->chunks; i++)
+	{
+		total += job->parts[i].cols.count;
+	}
+	if ((total != 0) && !fingest_reserve(cols, total))
+	{
+		return FINGEST_Error_Memory;
+	}
+	for (uint32_t i = 0; i < job->chunks; i++)
+	{
+		part = &job->parts[i].cols;
+		memcpy(cols->time + offset, part->time, (size_t)(part->count * sizeof(*cols->time)));
+		memcpy(cols->lat + offset, part->lat, (size_t)(part->count * sizeof(*cols->lat)));
+		memcpy(cols->lon + offset, part->lon, (size_t)(part->count * sizeof(*cols->lon)));
+		memcpy(cols->alt + offset, part->alt, (size_t)(part->count * sizeof(*cols->alt)));
+		memcpy(cols->speed + offset, part->speed, (size_t)(part->count * sizeof(*cols->speed)));
+		memcpy(cols->course + offset, part->course, (size_t)(part->count * sizeof(*cols->course)));
+		memcpy(cols->status + offset, part->status, (size_t)(part->count * sizeof(*cols->status)));
+		offset += part->count;
+	}
+	cols->count = total;
+	return FINGEST_Error_None;
+}
+
+/// @brief 导入内存中的 NMEA 数据
+/// @param buf 数据
+/// @param len 数据长度
+/// @param threads 线程数，为 0 时使用在线 CPU 数
+/// @param cols 输出，使用后由 fingest_free 释放
+/// @return fingest_error_e 错误值
+extern int32_t fingest_buffer(const char *buf, uint64_t len, uint32_t threads, fingest_columns_t *cols)
+{
+	fingest_job_t job;
+	pthread_t tid[FINGEST_THREADS_MAX];
+	uint32_t started = 0;
+	const char *p;
+	int32_t ret;
+
+	if ((buf == 0) || (cols == 0))
+	{
+		return FINGEST_Error_ArgsErr;
+	}
+	*cols = (fingest_columns_t){0};
+	if (threads == 0)
+	{
+		long online = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = (online > 0) ? (uint32_t)online : 1;
+	}
+
+	job.buf = buf;
+	job.len = len;
+	job.chunks = (uint32_t)((len + FINGEST_CHUNK_SIZE - 1) / FINGEST_CHUNK_SIZE);
+	job.bounds = (uint64_t *)malloc((job.chunks + 1) * sizeof(uint64_t));
+	job.parts = (fingest_part_t *)calloc(job.chunks + 1, sizeof(fingest_part_t));
+	if ((job.bounds == 0) || (job.parts == 0))
+	{
+		free(job.bounds);
+		free(job.parts);
+		return FINGEST_Error_Memory;
+	}
+	atomic_init(&job.next, 0);
+	atomic_init(&job.error, FINGEST_Error_None);
+
+	// 切分点移到其后第一个换行之后，没有换行的块并入前一块
+	job.bounds[0] = 0;
+	for (uint32_t i = 1; i < job.chunks; i++)
+	{
+		uint64_t pos = (uint64_t)i * FINGEST_CHUNK_SIZE;
+		if (pos < job.bounds[i - 1])
+		{
+			pos = job.bounds[i - 1];
+		}
+		p = (const char *)memchr(buf + pos, '\n', (size_t)(len - pos));
+		job.bounds[i] = (p == 0) ? len : (uint64_t)(p - buf) + 1;
+	}
+	job.bounds[job.chunks] = len;
+
+	if (threads > job.chunks)
+	{
+		threads = job.chunks;
+	}
+	if (threads > FINGEST_THREADS_MAX)
+	{
+		threads = FINGEST_THREADS_MAX;
+	}
+	// 调用者线程也参与解析，创建线程失败时已启动的线程不再领取新的块
+	while (started + 1 < threads)
+	{
+		if (pthread_create(&tid[started], 0, fingest_worker, &job) != 0)
+		{
+			atomic_store_explicit(&job.next, job.chunks, memory_order_relaxed);
+			atomic_store_explicit(&job.error, FINGEST_Error_Thread, memory_order_relaxed);
+			break;
+		}
+		started++;
+	}
+	fingest_worker(&job);
+	for (uint32_t i = 0; i < started; i++)
+	{
+		pthread_join(tid[i], 0);
+	}
+
+	ret = atomic_load_explicit(&job.error, memory_order_relaxed);
+	if (ret == FINGEST_Error_None)
+	{
+		ret = fingest_merge(&job, cols);
+	}
+	for (uint32_t i = 0; i < job.chunks; i++)
+	{
+		fingest_free(&job.parts[i].cols);
+	}
+	free(job.bounds);
+	free(job.parts);
+	if (ret != FINGEST_Error_None)
+	{
+		fingest_free(cols);
+	}
+	return ret;
+}
+
+/// @brief 导入 NMEA 日志文件
+/// @param path 文件路径
+/// @param threads 线程数，为 0 时使用在线 CPU 数
+/// @param cols 输出，使用后由 fingest_free 释放
+/// @return fingest_error_e 错误值
+extern int32_t fingest_file(const char *path, uint32_t threads, fingest_columns_t *cols)
+{
+	struct stat st;
+	char *map;
+	int32_t ret;
+	int fd;
+
+	if ((path == 0) || (cols == 0))
+	{
+		return FINGEST_Error_ArgsErr;
+	}
+	*cols = (fingest_columns_t){0};
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return FINGEST_Error_Open;
+	}
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return FINGEST_Error_Open;
+	}
+	if (st.st_size == 0)
+	{
+		close(fd);
+		return FINGEST_Error_None;
+	}
+	map = (char *)mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		return FINGEST_Error_Map;
+	}
+	madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+	ret = fingest_buffer(map, (uint64_t)st.st_size, threads, cols);
+	munmap(map, (size_t)st.st_size);
+	return ret;
+}
+
+/// @brief 释放导入结果
+/// @param cols 导入结果
+extern void fingest_free(fingest_columns_t *cols)
+{
+	free(cols->time);
+	free(cols->lat);
+	free(cols->lon);
+	free(cols->alt);
+	free(cols->speed);
+	free(cols->course);
+	free(cols->status);
+	*cols = (fingest_columns_t){0};
+}
@@ -0,0 +1,103 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: utl_fingest.h
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: fnmea 内存映射批量导入
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ * 
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * FINGEST 说明：
+ *
+ * fingest 将记录的 NMEA 日志批量导入为按列存储的定位数组（需要 POSIX mmap 与 pthread 支持）
+ *
+ * 文件映射到内存后按 FINGEST_CHUNK_SIZE 切块，切分点移到其后第一个换行之后，语句不会跨块
+ * 工作线程从共享计数器领取数据块，先完成的线程继续领取剩余的块；
+ * 每块用 fnmea_frame 定位语句、fnmea_parse_span 原地解码，同一 UTC 时间的语句由 fnmea 历元合并为一行
+ * 每块先解析之前 FINGEST_WARMUP 字节的语句（不输出），使来自其他语句的列在块开头也有效；
+ * 跨越切分点的历元属于它开始的块，该块继续解析其后最多 FINGEST_WARMUP 字节直到历元结束，
+ * 下一块只把它的其余语句合并到记录，因此一个历元的语句跨度不能超过 FINGEST_WARMUP
+ * 全部完成后按文件顺序合并各块的列
+ *
+ * 用法：
+ * fingest_columns_t cols;
+ * if (fingest_file("track.nmea", 0, &cols) == FINGEST_Error_None)
+ * {
+ *     for (uint64_t i = 0; i < cols.count; i++) { ... cols.lat[i] ... }
+ *     fingest_free(&cols);
+ * }
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef __UTL_FINGEST_H__
+#define __UTL_FINGEST_H__
+
+#include <stdint.h>
+#include "utl_fnmea.h"
+
+// 数据块大小
+#ifndef FINGEST_CHUNK_SIZE
+#define FINGEST_CHUNK_SIZE (4 << 20) // Bytes
+#endif
+// 每块开始前预先解析与结束后继续解析的长度
+#ifndef FINGEST_WARMUP
+#define FINGEST_WARMUP (4096) // Bytes
+#endif
+// 最大线程数
+#ifndef FINGEST_THREADS_MAX
+#define FINGEST_THREADS_MAX (64)
+#endif
+
+/// @brief fingest 错误类型 枚举
+typedef enum tagFINGEST_Error
+{
+	FINGEST_Error_None = 0,	   /* 没有错误 */
+	FINGEST_Error_ArgsErr = -1, /* 参数错误 */
+	FINGEST_Error_Open = -2,	   /* 文件打开失败 */
+	FINGEST_Error_Map = -3,	   /* 内存映射失败 */
+	FINGEST_Error_Memory = -4,  /* 内存分配失败 */
+	FINGEST_Error_Thread = -5,  /* 线程创建失败 */
+} fingest_error_e;
+
+/// @brief 按列存储的定位数据，每列长度为 count
+typedef struct tagFINGEST_Columns
+{
+	uint64_t count;	   /* 行数（历元数） */
+	uint64_t capacity; /* 已分配行数 */
+	uint32_t *time;	   /* UTC 时间（当天毫秒数） */
+	int32_t *lat;	   /* 纬度（1e-7 度，北纬为正） */
+	int32_t *lon;	   /* 经度（1e-7 度，东经为正） */
+	int32_t *alt;	   /* Q12 海拔 */
+	int32_t *speed;	   /* Q12 速度（千米每小时） */
+	int32_t *course;   /* Q12 正北方向角 */
+	uint8_t *status;   /* 定位状态（fnmea_status_e） */
+} fingest_columns_t;
+
+extern int32_t fingest_buffer(const char *buf, uint64_t len, uint32_t threads, fingest_columns_t *cols);
+extern int32_t fingest_file(const char *path, uint32_t threads, fingest_columns_t *cols);
+extern void fingest_free(fingest_columns_t *cols);
+
+#endif
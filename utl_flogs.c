@@ -29,8 +29,22 @@
  *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
+#include <string.h>
 #include "utl_flogs.h"
 #include "utl_ffmt.h"
+#if FLOG_COMPRESS
+#include "utl_flz.h"
+#if FLOG_COMPRESS_BLOCK > FLZ_BLOCK_MAX_SIZE
+#error "FLOG_COMPRESS_BLOCK must not be larger than FLZ_BLOCK_MAX_SIZE"
+#endif
+#endif
+
+#if FLOG_ASYNC || FLOG_RECORDER || FLOG_STATS
+#include <stdatomic.h>
+#endif
+#if FLOG_ASYNC && (defined(__unix__) || defined(__APPLE__))
+#include <sched.h>
+#endif
 
 // 输出颜色定义
 #define LOG_COLOR_NONE "\033[0m"
@@ -45,11 +59,196 @@
 /// @brief 日志输出函数指针
 static void (*log_output_pfun)(char* buffer, uint32_t size) = 0;
 
-/// @brief 日志缓冲区
-static char log_buffer[LOG_BUFFER_MAX_SIZE] = {0};
+#if FLOG_DEFERRED
+/// @brief flogs_fmt 段起止地址（由链接器生成）
+extern const char __start_flogs_fmt[];
+extern const char __stop_flogs_fmt[];
+
+// 记录中段内偏移的位数决定的 flogs_fmt 段长度上限
+#define FLOG_FMT_SECTION_MAX 0x10000
+#endif
+
+/// @brief 日志记录编码函数（文本格式化或二进制记录）
+typedef int32_t (*FLOGS_Encoder)(char *buffer, uint8_t level, const char *tag, char *fmt, va_list *ap);
+
+#if FLOG_KV == FLOG_KV_TLV
+// 结构化二进制记录的同步字节（记录格式见 flogs_encode_kv）
+#define FLOG_KV_SYNC 0xF6
+#endif
+
+#if FLOG_ASYNC
+/// @brief 异步环形缓冲区记录槽
+typedef struct tagFLOGS_Slot
+{
+    atomic_uint seq;                  /* 槽序号，等于写入位置时可写，等于写入位置 + 1 时可读 */
+    uint32_t length;                  /* 记录长度 */
+    char buffer[LOG_BUFFER_MAX_SIZE]; /* 记录内容 */
+} FLOGS_Slot;
+
+/// @brief 异步环形缓冲区
+static FLOGS_Slot log_slots[FLOG_ASYNC_SLOTS];
+
+/// @brief 异步环形缓冲区写入位置
+static atomic_uint log_head;
+
+/// @brief 异步环形缓冲区读取位置
+static atomic_uint log_tail;
+
+/// @brief 异步环形缓冲区丢弃记录计数
+static atomic_uint log_drops;
+
+/// @brief 输出线程占用标志，保证同一时刻只有一个消费者
+static atomic_flag log_draining = ATOMIC_FLAG_INIT;
+#elif FLOG_BATCH
+/// @brief 同步批量缓冲区，定义 FFMT_THREAD_SAFE 时每个线程独立
+static FFMT_TLS struct
+{
+    uint32_t length;               /* 已写入长度 */
+    uint32_t stamp;                /* 第一条记录写入时的时钟计数 */
+    char buffer[FLOG_BATCH_SIZE]; /* 记录内容 */
+} log_batch;
+#else
+/// @brief 日志缓冲区，定义 FFMT_THREAD_SAFE 时每个线程独立
+static FFMT_TLS char log_buffer[LOG_BUFFER_MAX_SIZE] = {0};
+#endif
+
+#if FLOG_RECORDER
+/// @brief 飞行记录仪环形缓冲区
+static char log_recorder[FLOG_RECORDER_SIZE];
+
+/// @brief 飞行记录仪累计写入字节数
+static atomic_uint log_recorder_head;
+
+/// @brief 直接输出的最低等级
+static volatile uint8_t log_live_level = FLOG_RECORDER_LIVE;
+
+/// @brief 直接输出的记录实际使用的编码函数，定义 FFMT_THREAD_SAFE 时每个线程独立
+static FFMT_TLS FLOGS_Encoder log_record_encoder = 0;
+
+#if FLOG_ASYNC || FLOG_BATCH
+/// @brief 只写入飞行记录仪的记录的编码缓冲区，定义 FFMT_THREAD_SAFE 时每个线程独立
+static FFMT_TLS char log_record_buffer[LOG_BUFFER_MAX_SIZE];
+#else
+// 同步模式直接复用日志缓冲区
+#define log_record_buffer log_buffer
+#endif
+
+// 环形缓冲区中每条记录前的记录头：标志字节（不会出现在 UTF-8 文本中）与 2 字节小端长度
+// 导出时按长度逐条跳转，记录内容中的换行等字节不影响定位，记录头不输出
+#define FLOG_RECORD_MARK ((char)0xFF)
+#define FLOG_RECORD_HEAD 3
+#endif
+
+#if FLOG_COMPRESS
+#if FLOG_ASYNC
+// 异步模式下只由持有 log_draining 的消费者使用
+#define FLOG_COMPRESS_TLS
+#else
+#define FLOG_COMPRESS_TLS FFMT_TLS
+#endif
+
+/// @brief 压缩块缓冲区，同步模式下定义 FFMT_THREAD_SAFE 时每个线程独立
+static FLOG_COMPRESS_TLS struct
+{
+    uint32_t length;                                    /* 已写入长度 */
+    flz_state_t state;                                  /* 压缩哈希表 */
+    uint8_t raw[FLOG_COMPRESS_BLOCK];                   /* 待压缩记录 */
+    uint8_t frame[FLZ_FRAME_BOUND(FLOG_COMPRESS_BLOCK)]; /* 压缩帧 */
+} log_lz;
+#endif
+
+#if FLOG_BATCH
+/// @brief 批量输出函数指针，未指定时逐个片段调用 log_output_pfun
+static void (*log_writev_pfun)(const flogs_iovec_t *iov, uint32_t count) = 0;
+
+/// @brief 批量输出最长等待时间对应的时钟计数，未指定时钟源时不按时间输出
+static uint32_t log_batch_ticks = UINT32_MAX;
+
+#if FLOG_ASYNC
+/// @brief 异步批量输出片段，只由持有 log_draining 的消费者使用
+static flogs_iovec_t log_iov[FLOG_BATCH_IOV];
+
+/// @brief 异步模式下是否有记录在等待批量输出
+static bool log_batch_waiting = false;
+
+/// @brief 异步模式下记录开始等待时的时钟计数
+static uint32_t log_batch_stamp = 0;
+#endif
+#endif
+
+#if FLOG_CLOCK
+/// @brief 时钟源函数指针
+static uint32_t (*log_tick_pfun)(void) = 0;
+
+/// @brief 时钟源频率
+static uint32_t log_tick_hz = 1000;
+
+/// @brief 调用 flogs_timestamp_init 时的时钟计数
+static uint32_t log_tick_start = 0;
+#endif
+
+#if FLOG_TIMESTAMP
+/// @brief 时间戳缓存，定义 FFMT_THREAD_SAFE 时每个线程独立
+static FFMT_TLS struct
+{
+    bool valid;     /* 缓存是否有效 */
+    uint32_t sec;   /* 当前秒数 */
+    uint32_t base;  /* 当前秒起始时的时钟计数 */
+    uint8_t length; /* 秒部分文本长度 */
+    char text[16];  /* 秒部分文本 "[秒." */
+} log_ts;
+#endif
+
+#if FLOG_RATE_LIMIT
+/// @brief 当前正在编码的限速调用点，定义 FFMT_THREAD_SAFE 时每个线程独立
+static FFMT_TLS flogs_limit_t *log_limit = 0;
 
-/// @brief 日志缓冲区剩余长度
-static uint32_t buf_count = LOG_BUFFER_MAX_SIZE;
+/// @brief 正在输出限速计数提示，提示不经过直接输出等级过滤，异步缓冲区满时等待而不丢弃
+static FFMT_TLS bool log_limit_note = false;
+
+// 限速计数提示
+#define FLOG_LIMIT_NOTE "last message repeated %u times, %u suppressed"
+#else
+#define log_limit_note false
+#endif
+
+#if FLOG_STATS
+/// @brief 统计计数（原子）
+typedef struct tagFLOGS_AtomicCounter
+{
+    atomic_uint records;     /* 记录数 */
+    atomic_uint bytes;       /* 字节数 */
+    atomic_uint truncations; /* 被截断的记录数 */
+    atomic_uint drops;       /* 因缓冲区满丢弃的记录数 */
+} FLOGS_AtomicCounter;
+
+/// @brief 按等级统计
+static FLOGS_AtomicCounter log_stats_level[LEVEL_NONE];
+
+/// @brief 标签哈希表，最后一项收集放不下的标签
+static _Atomic(const char *) log_stats_tag[FLOG_STATS_TAGS] = {[FLOG_STATS_TAGS - 1] = "*"};
+
+/// @brief 按标签统计
+static FLOGS_AtomicCounter log_stats_tag_count[FLOG_STATS_TAGS];
+
+/// @brief 输出函数调用次数
+static atomic_uint log_stats_sink_calls;
+
+/// @brief 输出函数累计耗时
+static atomic_uint log_stats_sink_time;
+
+/// @brief 格式化耗时分布
+static atomic_uint log_stats_format_hist[FLOG_STATS_BUCKETS];
+
+/// @brief 输出函数耗时分布
+static atomic_uint log_stats_sink_hist[FLOG_STATS_BUCKETS];
+
+/// @brief 高精度计数器函数指针
+static uint32_t (*log_cycle_pfun)(void) = 0;
+
+/// @brief 被统计的实际编码函数，定义 FFMT_THREAD_SAFE 时每个线程独立
+static FFMT_TLS FLOGS_Encoder log_stats_encoder = 0;
+#endif
 
 /// @brief 日志颜色等级输出前缀
 static const char *log_level_prefix[] =
@@ -69,57 +268,1974 @@ static const char *log_level_prefix[] =
         ""
         "\n\r" LOG_COLOR_RED "[ERRO] "
         "",
+        ""
+        "\n\r" LOG_COLOR_PURPLE "[FATL] "
+        "",
 };
 
 /// @brief flogs 初始化
-/// @param log_output_pfun 参数为 buffer 指针，长度的输出定向函数
-extern void flogs_init(void (*pfun_output)(char* buffer, uint32_t size))
+/// @param log_output_pfun 参数为 buffer 指针，长度的输出定向函数（文本记录的长度不含末尾的 '\0'）
+/// @return 是否初始化成功，延迟输出模式下 flogs_fmt 段超过 64 KiB 时失败（超出部分的记录被丢弃）
+extern bool flogs_init(void (*pfun_output)(char* buffer, uint32_t size))
 {
     log_output_pfun = pfun_output;
+#if FLOG_ASYNC
+    for (uint32_t i = 0; i < FLOG_ASYNC_SLOTS; i++)
+    {
+        atomic_store_explicit(&log_slots[i].seq, i, memory_order_relaxed);
+    }
+    atomic_store_explicit(&log_head, 0, memory_order_relaxed);
+    atomic_store_explicit(&log_tail, 0, memory_order_relaxed);
+    atomic_store_explicit(&log_drops, 0, memory_order_release);
+#endif
+#if FLOG_DEFERRED
+    return (size_t)(__stop_flogs_fmt - __start_flogs_fmt) <= FLOG_FMT_SECTION_MAX;
+#else
+    return true;
+#endif
+}
+
+/// @brief 计算记录的输出长度，文本记录不输出末尾的 '\0'
+/// @param record 记录内容
+/// @param size 记录长度
+/// @return 输出长度
+static uint32_t flogs_record_size(const char *record, uint32_t size)
+{
+#if !FLOG_DEFERRED
+#if FLOG_KV == FLOG_KV_TLV
+    // 二进制键值记录以校验和结尾，校验和可能为 0
+    if ((size > 0) && ((uint8_t)record[0] == FLOG_KV_SYNC))
+    {
+        return size;
+    }
+#endif
+    if ((size > 0) && (record[size - 1] == '\0'))
+    {
+        size--;
+    }
+#else
+    (void)record;
+#endif
+    return size;
+}
+
+#if FLOG_STATS
+/// @brief 设置统计耗时使用的高精度计数器
+/// @param pfun_cycles 返回单调递增计数的函数（如 DWT->CYCCNT、rdtsc 低 32 位）
+extern void flogs_stats_init(uint32_t (*pfun_cycles)(void))
+{
+    log_cycle_pfun = pfun_cycles;
+}
+
+/// @brief 读取高精度计数器
+/// @param
+/// @return 计数值，未指定计数器时为 0
+static uint32_t flogs_stats_cycles(void)
+{
+    return (log_cycle_pfun == 0) ? 0 : log_cycle_pfun();
+}
+
+/// @brief 耗时计入 2 的幂分桶
+/// @param hist 分布
+/// @param cycles 耗时
+static void flogs_stats_hist(atomic_uint *hist, uint32_t cycles)
+{
+    uint32_t bucket = (cycles == 0) ? 0 : 32 - (uint32_t)__builtin_clz(cycles);
+
+    if (bucket >= FLOG_STATS_BUCKETS)
+    {
+        bucket = FLOG_STATS_BUCKETS - 1;
+    }
+    atomic_fetch_add_explicit(&hist[bucket], 1, memory_order_relaxed);
+}
+
+/// @brief 查找标签的统计项，首次出现时插入
+/// @param tag 日志标签
+/// @return 统计项
+static FLOGS_AtomicCounter *flogs_stats_tag(const char *tag)
+{
+    uint32_t index = (uint32_t)(((uintptr_t)tag * 2654435761u) >> 4) % (FLOG_STATS_TAGS - 1);
+    const char *current;
+
+    // 按标签指针线性探测，插入只需一次比较交换
+    for (uint32_t i = 0; i < FLOG_STATS_TAGS - 1; i++)
+    {
+        current = atomic_load_explicit(&log_stats_tag[index], memory_order_relaxed);
+        if ((current == tag) ||
+            ((current == 0) &&
+             (atomic_compare_exchange_strong_explicit(&log_stats_tag[index], &current, tag,
+                                                      memory_order_relaxed, memory_order_relaxed) ||
+              (current == tag))))
+        {
+            return &log_stats_tag_count[index];
+        }
+        index = (index + 1) % (FLOG_STATS_TAGS - 1);
+    }
+    return &log_stats_tag_count[FLOG_STATS_TAGS - 1];
+}
+
+/// @brief 统计一条记录
+/// @param level 日志等级
+/// @param tag 日志标签
+/// @param record 记录内容（丢弃时不使用）
+/// @param length 记录长度或错误值（-1）
+/// @param drop 是否被丢弃
+static void flogs_stats_count(uint8_t level, const char *tag, const char *record, int32_t length, bool drop)
+{
+    FLOGS_AtomicCounter *counter[2] = {&log_stats_level[level], flogs_stats_tag(tag)};
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        if (drop)
+        {
+            atomic_fetch_add_explicit(&counter[i]->drops, 1, memory_order_relaxed);
+            continue;
+        }
+        atomic_fetch_add_explicit(&counter[i]->records, 1, memory_order_relaxed);
+        // 与输出函数收到的长度一致
+        atomic_fetch_add_explicit(&counter[i]->bytes,
+                                  flogs_record_size(record, (length < 0) ? LOG_BUFFER_MAX_SIZE : (uint32_t)length),
+                                  memory_order_relaxed);
+        if (length < 0)
+        {
+            atomic_fetch_add_explicit(&counter[i]->truncations, 1, memory_order_relaxed);
+        }
+    }
+}
+
+/// @brief 编码记录并统计格式化耗时
+/// @param buffer 日志缓冲区
+/// @param level 日志等级
+/// @param tag 日志标签
+/// @param fmt 格式化字符串
+/// @param ap 可变参数列表
+/// @return 记录长度、0（已折叠）或错误值（-1）
+static int32_t flogs_encode_stats(char *buffer, uint8_t level, const char *tag, char *fmt, va_list *ap)
+{
+    uint32_t start = flogs_stats_cycles();
+    int32_t length = log_stats_encoder(buffer, level, tag, fmt, ap);
+
+    flogs_stats_hist(log_stats_format_hist, flogs_stats_cycles() - start);
+    if (length != 0)
+    {
+        flogs_stats_count(level, tag, buffer, length, false);
+    }
+    return length;
+}
+
+/// @brief 统计一次输出函数调用
+/// @param start 调用前的计数值
+static void flogs_stats_sink(uint32_t start)
+{
+    uint32_t cycles = flogs_stats_cycles() - start;
+
+    atomic_fetch_add_explicit(&log_stats_sink_calls, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&log_stats_sink_time, cycles, memory_order_relaxed);
+    flogs_stats_hist(log_stats_sink_hist, cycles);
+}
+
+/// @brief 复制统计计数
+/// @param dst 快照
+/// @param src 统计计数
+static void flogs_stats_copy(flogs_counter_t *dst, FLOGS_AtomicCounter *src)
+{
+    dst->records = atomic_load_explicit(&src->records, memory_order_relaxed);
+    dst->bytes = atomic_load_explicit(&src->bytes, memory_order_relaxed);
+    dst->truncations = atomic_load_explicit(&src->truncations, memory_order_relaxed);
+    dst->drops = atomic_load_explicit(&src->drops, memory_order_relaxed);
+}
+
+/// @brief 获取统计快照
+/// @param stats 快照
+/// @note 各计数分别读取，记录并发写入时快照内部可能略有不一致
+extern void flogs_stats_snapshot(flogs_stats_t *stats)
+{
+    for (uint32_t i = 0; i < LEVEL_NONE; i++)
+    {
+        flogs_stats_copy(&stats->level[i], &log_stats_level[i]);
+    }
+    for (uint32_t i = 0; i < FLOG_STATS_TAGS; i++)
+    {
+        stats->tag[i] = atomic_load_explicit(&log_stats_tag[i], memory_order_relaxed);
+        flogs_stats_copy(&stats->tag_count[i], &log_stats_tag_count[i]);
+    }
+    stats->sink_calls = atomic_load_explicit(&log_stats_sink_calls, memory_order_relaxed);
+    stats->sink_time = atomic_load_explicit(&log_stats_sink_time, memory_order_relaxed);
+    for (uint32_t i = 0; i < FLOG_STATS_BUCKETS; i++)
+    {
+        stats->format_hist[i] = atomic_load_explicit(&log_stats_format_hist[i], memory_order_relaxed);
+        stats->sink_hist[i] = atomic_load_explicit(&log_stats_sink_hist[i], memory_order_relaxed);
+    }
+}
+
+/// @brief 清零统计计数（保留已登记的标签）
+/// @param
+extern void flogs_stats_reset(void)
+{
+    FLOGS_AtomicCounter *counter;
+
+    for (uint32_t i = 0; i < LEVEL_NONE + FLOG_STATS_TAGS; i++)
+    {
+        counter = (i < LEVEL_NONE) ? &log_stats_level[i] : &log_stats_tag_count[i - LEVEL_NONE];
+        atomic_store_explicit(&counter->records, 0, memory_order_relaxed);
+        atomic_store_explicit(&counter->bytes, 0, memory_order_relaxed);
+        atomic_store_explicit(&counter->truncations, 0, memory_order_relaxed);
+        atomic_store_explicit(&counter->drops, 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&log_stats_sink_calls, 0, memory_order_relaxed);
+    atomic_store_explicit(&log_stats_sink_time, 0, memory_order_relaxed);
+    for (uint32_t i = 0; i < FLOG_STATS_BUCKETS; i++)
+    {
+        atomic_store_explicit(&log_stats_format_hist[i], 0, memory_order_relaxed);
+        atomic_store_explicit(&log_stats_sink_hist[i], 0, memory_order_relaxed);
+    }
+}
+#endif
+
+/// @brief 调用输出函数
+/// @param buffer 记录内容
+/// @param size 记录长度
+static void flogs_output(char *buffer, uint32_t size)
+{
+#if FLOG_STATS
+    uint32_t start = flogs_stats_cycles();
+    log_output_pfun(buffer, size);
+    flogs_stats_sink(start);
+#else
+    log_output_pfun(buffer, size);
+#endif
+}
+
+#if FLOG_COMPRESS
+/// @brief 压缩块缓冲区中的记录并输出一帧
+/// @param
+static void flogs_compress_flush(void)
+{
+    int32_t length;
+
+    if (log_lz.length == 0)
+    {
+        return;
+    }
+    length = flz_frame(&log_lz.state, log_lz.raw, log_lz.length, log_lz.frame, sizeof(log_lz.frame));
+    if (length > 0)
+    {
+        flogs_output((char *)log_lz.frame, (uint32_t)length);
+    }
+    log_lz.length = 0;
 }
+#endif
+
+/// @brief 输出记录，开启压缩时先写入压缩块缓冲区
+/// @param buffer 记录内容
+/// @param size 输出长度（已由 flogs_record_size 去掉文本记录末尾的 '\0'）
+static void flogs_sink(char *buffer, uint32_t size)
+{
+#if FLOG_COMPRESS
+    uint32_t chunk;
+
+    // 单条记录不跨帧，丢失一帧时不影响相邻帧中的记录；批量输出与导出的大片段直接拆分以填满块
+    if ((size <= LOG_BUFFER_MAX_SIZE) && (log_lz.length + size > FLOG_COMPRESS_BLOCK))
+    {
+        flogs_compress_flush();
+    }
+    while (size > 0)
+    {
+        chunk = FLOG_COMPRESS_BLOCK - log_lz.length;
+        if (chunk > size)
+        {
+            chunk = size;
+        }
+        memcpy(log_lz.raw + log_lz.length, buffer, chunk);
+        log_lz.length += chunk;
+        buffer += chunk;
+        size -= chunk;
+        if (log_lz.length == FLOG_COMPRESS_BLOCK)
+        {
+            flogs_compress_flush();
+        }
+    }
+#else
+    flogs_output(buffer, size);
+#endif
+}
+
+#if FLOG_COMPRESS && !FLOG_ASYNC && !FLOG_BATCH
+/// @brief 输出当前线程压缩块缓冲区中的记录
+/// @param
+/// @note 只处理调用者线程的缓冲区，各线程需自行调用
+extern void flogs_flush(void)
+{
+    flogs_compress_flush();
+}
+#endif
+
+#if FLOG_CLOCK
+/// @brief 设置时间戳与限速使用的时钟源
+/// @param pfun_tick 返回单调递增计数的函数（如 SysTick 毫秒计数、CLOCK_MONOTONIC_COARSE 换算值）
+/// @param tick_hz 计数频率
+/// @note 应在输出日志前调用，时间戳从调用时刻开始计时
+extern void flogs_timestamp_init(uint32_t (*pfun_tick)(void), uint32_t tick_hz)
+{
+    log_tick_hz = (tick_hz == 0) ? 1 : tick_hz;
+    log_tick_start = pfun_tick();
+    log_tick_pfun = pfun_tick;
+#if FLOG_BATCH
+    log_batch_ticks = (uint32_t)(((uint64_t)FLOG_BATCH_LATENCY * log_tick_hz) / 1000);
+#endif
+#if FLOG_TIMESTAMP
+    log_ts.valid = false;
+#endif
+}
+#endif
+
+#if FLOG_TIMESTAMP
+
+/// @brief 更新时间戳缓存
+/// @param msec 输出当前秒内的毫秒数
+/// @return 是否已指定时钟源
+static bool flogs_timestamp_update(uint32_t *msec)
+{
+    uint32_t elapsed;
+
+    if (log_tick_pfun == 0)
+    {
+        return false;
+    }
+    if (!log_ts.valid)
+    {
+        log_ts.valid = true;
+        log_ts.sec = 0;
+        log_ts.base = log_tick_start;
+        log_ts.length = 0;
+    }
+
+    // 按计数差值计算，计数回绕时结果不变
+    elapsed = log_tick_pfun() - log_ts.base;
+    if ((elapsed >= log_tick_hz) || (log_ts.length == 0))
+    {
+        uint32_t sec = elapsed / log_tick_hz;
+
+        log_ts.sec += sec;
+        log_ts.base += sec * log_tick_hz;
+        elapsed -= sec * log_tick_hz;
+
+        // 秒数变化时才重新格式化
+        log_ts.text[0] = '[';
+        log_ts.length = (uint8_t)(ffmt_utoa(&log_ts.text[1], log_ts.sec) + 1);
+        log_ts.text[log_ts.length++] = '.';
+    }
+    *msec = (uint32_t)(((uint64_t)elapsed * 1000) / log_tick_hz);
+    return true;
+}
+
+/// @brief 写入毫秒数字
+/// @param buffer 写入位置，至少 3 字节
+/// @param msec 毫秒数
+/// @return 指向写入尾部的指针
+static char *flogs_timestamp_msec(char *buffer, uint32_t msec)
+{
+    *buffer++ = (char)('0' + msec / 100);
+    *buffer++ = (char)('0' + msec / 10 % 10);
+    *buffer++ = (char)('0' + msec % 10);
+    return buffer;
+}
+
+/// @brief 写入时间戳 "[秒.毫秒] "
+/// @param buffer 日志缓冲区
+/// @param end 缓冲区结尾
+/// @return 指向写入尾部的指针
+static char *flogs_timestamp(char *buffer, const char *end)
+{
+    uint32_t msec;
+
+    if (!flogs_timestamp_update(&msec) || (end - buffer < log_ts.length + 5))
+    {
+        return buffer;
+    }
+    memcpy(buffer, log_ts.text, log_ts.length);
+    buffer = flogs_timestamp_msec(buffer + log_ts.length, msec);
+    *buffer++ = ']';
+    *buffer++ = ' ';
+    return buffer;
+}
+#endif
+
+#if FLOG_RUNTIME_FILTER
+/// @brief flogs_site 段起止地址（由链接器生成，没有调用点时为空）
+extern flogs_site_t __start_flogs_site[] __attribute__((weak));
+extern flogs_site_t __stop_flogs_site[] __attribute__((weak));
+
+/// @brief 设置标签的运行时日志等级
+/// @param tag 日志标签，NULL 表示全部标签
+/// @param level 最低输出等级，LEVEL_NONE 表示关闭
+/// @return 受影响的调用点数量
+extern uint32_t flogs_set_level(const char *tag, uint8_t level)
+{
+    flogs_site_t *site;
+    uint32_t count = 0;
+
+    for (site = __start_flogs_site; site < __stop_flogs_site; site++)
+    {
+        if (tag == 0 || site->tag == tag || strcmp(site->tag, tag) == 0)
+        {
+            site->enable = (site->level >= level);
+            count++;
+        }
+    }
+    return count;
+}
+#endif
 
 /// @brief 追加字符串
 /// @param string 待追加的字符串指针
 /// @param append 追加内容指针
+/// @param end 缓冲区结尾
 /// @return 指向追加尾部的指针
-static char *append2String(char *string, const char *append)
+static char *append2String(char *string, const char *append, const char *end)
 {
-    uint32_t stringCnt = 0;
-
-    while ((append[stringCnt] != '\0') &&
-           (stringCnt < LOG_BUFFER_MAX_SIZE))
+    while ((*append != '\0') && (string < end))
     {
-        string[stringCnt] = append[stringCnt];
-        stringCnt++;
+        *string++ = *append++;
     }
-    buf_count -= stringCnt;
-    return (string + stringCnt);
+    return string;
 }
 
-/// @brief 日志格式化输出函数
+/// @brief 写入记录头（等级前缀、时间戳与标签）
+/// @param buffer 日志缓冲区
+/// @param level 日志等级
+/// @param tag 日志标签
+/// @param end 缓冲区结尾
+/// @return 指向记录内容起始位置的指针
+static char *flogs_format_head(char *buffer, uint8_t level, const char *tag, const char *end)
+{
+    buffer = append2String(buffer, log_level_prefix[level], end);
+#if FLOG_TIMESTAMP
+    buffer = flogs_timestamp(buffer, end);
+#endif
+    buffer = append2String(buffer, tag, end);
+    return append2String(buffer, ": ", end);
+}
+
+/// @brief 格式化一条日志记录
+/// @param buffer 日志缓冲区，长度为 LOG_BUFFER_MAX_SIZE
 /// @param level 日志等级
 /// @param tag 日志标签
 /// @param fmt 格式化字符串
-/// @param  
-/// @return 输出字符串长度或错误值（-1）
-extern int32_t flogs(uint8_t level, const char *tag, char *fmt, ...)
+/// @param ap 可变参数列表
+/// @return 记录长度或错误值（-1，此时缓冲区被截断填满）
+static int32_t flogs_format(char *buffer, uint8_t level, const char *tag, char *fmt, va_list *ap)
 {
-    char *pBuffer = log_buffer;
+    const char *end = buffer + LOG_BUFFER_MAX_SIZE;
+    char *pBuffer = flogs_format_head(buffer, level, tag, end);
     int32_t length;
-    va_list ap;
 
-    buf_count = LOG_BUFFER_MAX_SIZE;
-    pBuffer = append2String(pBuffer, log_level_prefix[level]);
-    pBuffer = append2String(pBuffer, tag);
-    pBuffer = append2String(pBuffer, ": ");
+    length = vsffmt(pBuffer, (uint32_t)(end - pBuffer), fmt, ap);
+    if (length < 0)
+    {
+        return -1;
+    }
+    return length + (int32_t)(pBuffer - buffer);
+}
+
+#if FLOG_BATCH
+/// @brief 设置批量输出函数
+/// @param pfun_writev 参数为 iovec 列表与片段数量的输出函数，POSIX 下可直接转换为 writev 的参数
+extern void flogs_batch_init(void (*pfun_writev)(const flogs_iovec_t *iov, uint32_t count))
+{
+    log_writev_pfun = pfun_writev;
+}
 
-    va_start(ap, fmt);
-    length = vsffmt(pBuffer, buf_count, fmt, &ap);
-    va_end(ap);
+/// @brief 获取当前时钟计数
+/// @param
+/// @return 时钟计数，未指定时钟源时为 0
+static uint32_t flogs_batch_now(void)
+{
+    return (log_tick_pfun == 0) ? 0 : log_tick_pfun();
+}
+
+/// @brief 批量输出
+/// @param iov 片段列表
+/// @param count 片段数量
+static void flogs_writev(const flogs_iovec_t *iov, uint32_t count)
+{
+#if !FLOG_COMPRESS
+    if (log_writev_pfun != 0)
+    {
+#if FLOG_STATS
+        uint32_t start = flogs_stats_cycles();
+        log_writev_pfun(iov, count);
+        flogs_stats_sink(start);
+#else
+        log_writev_pfun(iov, count);
+#endif
+        return;
+    }
+#endif
+    // 压缩时片段依次写入压缩块缓冲区
+    for (uint32_t i = 0; i < count; i++)
+    {
+        flogs_sink(iov[i].base, (uint32_t)iov[i].len);
+    }
+}
+
+#if !FLOG_ASYNC
+/// @brief 输出当前线程的批量缓冲区
+/// @param
+static void flogs_batch_flush(void)
+{
+    flogs_iovec_t iov;
+
+    if (log_batch.length != 0)
+    {
+        iov.base = log_batch.buffer;
+        iov.len = log_batch.length;
+        flogs_writev(&iov, 1);
+        log_batch.length = 0;
+    }
+}
+
+/// @brief 输出当前线程批量缓冲区中的记录
+/// @param
+/// @note 只处理调用者线程的缓冲区，各线程需自行调用
+extern void flogs_flush(void)
+{
+    flogs_batch_flush();
+#if FLOG_COMPRESS
+    flogs_compress_flush();
+#endif
+}
+#endif
+#endif
+
+#if FLOG_ASYNC
+static uint32_t flogs_async_output(bool force);
 
-    length += LOG_BUFFER_MAX_SIZE - buf_count;
+/// @brief 编码日志并写入异步环形缓冲区
+/// @param encoder 记录编码函数
+/// @param level 日志等级
+/// @param tag 日志标签
+/// @param fmt 格式化字符串
+/// @param ap 可变参数列表
+/// @return 记录长度或错误值（-1）
+static int32_t flogs_async_push(FLOGS_Encoder encoder, uint8_t level, const char *tag, char *fmt, va_list *ap)
+{
+    FLOGS_Slot *slot;
+    uint32_t pos = atomic_load_explicit(&log_head, memory_order_relaxed);
+    int32_t diff;
+    int32_t length;
 
-    log_output_pfun(log_buffer, length);
+    // 抢占一个可写的槽
+    for (;;)
+    {
+        slot = &log_slots[pos & (FLOG_ASYNC_SLOTS - 1)];
+        diff = (int32_t)(atomic_load_explicit(&slot->seq, memory_order_acquire) - pos);
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&log_head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // 缓冲区已满
+            if ((FLOG_ASYNC_OVERFLOW == FLOG_OVERFLOW_BLOCK) || log_limit_note)
+            {
+                // 其他线程正在输出时让出处理器，等待其腾出空位
+                if (flogs_async_output(true) == 0)
+                {
+                    FLOG_ASYNC_YIELD();
+                }
+                pos = atomic_load_explicit(&log_head, memory_order_relaxed);
+                continue;
+            }
+            atomic_fetch_add_explicit(&log_drops, 1, memory_order_relaxed);
+#if FLOG_STATS
+            flogs_stats_count(level, tag, 0, 0, true);
+#endif
+            return -1;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&log_head, memory_order_relaxed);
+        }
+    }
 
+    // 直接编码到槽内，完成后发布给消费者
+    length = encoder(slot->buffer, level, tag, fmt, ap);
+    slot->length = (length < 0) ? LOG_BUFFER_MAX_SIZE : (uint32_t)length;
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
     return length;
-}
\ No newline at end of file
+}
+
+#if FLOG_BATCH
+/// @brief 输出异步环形缓冲区中已完成的记录
+/// @param force 是否忽略批量条件立即输出
+/// @return 本次输出的记录数，其他线程正在输出时返回 0
+static uint32_t flogs_async_output(bool force)
+{
+    FLOGS_Slot *slot;
+    uint32_t pos;
+    uint32_t ready;
+    uint32_t bytes;
+    uint32_t iov_count;
+    uint32_t count = 0;
+    uint32_t now;
+
+    if (atomic_flag_test_and_set_explicit(&log_draining, memory_order_acquire))
+    {
+        return 0;
+    }
+    pos = atomic_load_explicit(&log_tail, memory_order_relaxed);
+    for (;;)
+    {
+        // 收集连续的已完成记录，片段直接指向槽
+        ready = 0;
+        bytes = 0;
+        iov_count = 0;
+        while (ready < FLOG_BATCH_IOV)
+        {
+            slot = &log_slots[(pos + ready) & (FLOG_ASYNC_SLOTS - 1)];
+            if (atomic_load_explicit(&slot->seq, memory_order_acquire) != pos + ready + 1)
+            {
+                break;
+            }
+            // 长度为 0 的记录已被折叠，不输出
+            if (slot->length != 0)
+            {
+                log_iov[iov_count].base = slot->buffer;
+                log_iov[iov_count].len = flogs_record_size(slot->buffer, slot->length);
+                bytes += (uint32_t)log_iov[iov_count].len;
+                iov_count++;
+            }
+            ready++;
+        }
+        if (ready == 0)
+        {
+            break;
+        }
+
+        // 未达到批量条件时等待后续记录
+        if (!force && (ready < FLOG_BATCH_IOV) && (bytes < FLOG_BATCH_BYTES))
+        {
+            now = flogs_batch_now();
+            if (!log_batch_waiting)
+            {
+                log_batch_waiting = true;
+                log_batch_stamp = now;
+                break;
+            }
+            if (now - log_batch_stamp < log_batch_ticks)
+            {
+                break;
+            }
+        }
+
+        if (iov_count != 0)
+        {
+            flogs_writev(log_iov, iov_count);
+        }
+        // 输出完成后释放槽，供下一轮写入
+        for (uint32_t i = 0; i < ready; i++)
+        {
+            atomic_store_explicit(&log_slots[(pos + i) & (FLOG_ASYNC_SLOTS - 1)].seq,
+                                  pos + i + FLOG_ASYNC_SLOTS, memory_order_release);
+        }
+        pos += ready;
+        atomic_store_explicit(&log_tail, pos, memory_order_release);
+        log_batch_waiting = false;
+        count += ready;
+    }
+    atomic_flag_clear_explicit(&log_draining, memory_order_release);
+    return count;
+}
+#else
+/// @brief 输出异步环形缓冲区中已完成的记录
+/// @param force 未使用
+/// @return 本次输出的记录数，其他线程正在输出时返回 0
+static uint32_t flogs_async_output(bool force)
+{
+    FLOGS_Slot *slot;
+    uint32_t pos;
+    uint32_t count = 0;
+
+    (void)force;
+    if (atomic_flag_test_and_set_explicit(&log_draining, memory_order_acquire))
+    {
+        return 0;
+    }
+    pos = atomic_load_explicit(&log_tail, memory_order_relaxed);
+    for (;;)
+    {
+        slot = &log_slots[pos & (FLOG_ASYNC_SLOTS - 1)];
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) != pos + 1)
+        {
+            break;
+        }
+        // 长度为 0 的记录已被折叠，不输出
+        if (slot->length != 0)
+        {
+            flogs_sink(slot->buffer, flogs_record_size(slot->buffer, slot->length));
+        }
+        // 释放槽，供下一轮写入
+        atomic_store_explicit(&slot->seq, pos + FLOG_ASYNC_SLOTS, memory_order_release);
+        pos++;
+        atomic_store_explicit(&log_tail, pos, memory_order_release);
+        count++;
+    }
+    atomic_flag_clear_explicit(&log_draining, memory_order_release);
+    return count;
+}
+#endif
+
+/// @brief 输出异步环形缓冲区中已完成的记录
+/// @param
+/// @return 本次输出的记录数，其他线程正在输出时返回 0
+/// @note 在后台线程中循环调用，也可以在空闲任务中调用
+extern uint32_t flogs_drain(void)
+{
+    return flogs_async_output(false);
+}
+
+/// @brief 等待调用前写入的所有记录输出完成
+/// @param
+extern void flogs_flush(void)
+{
+    uint32_t target = atomic_load_explicit(&log_head, memory_order_acquire);
+
+    // 没有后台线程时由调用者自行输出
+    while ((int32_t)(atomic_load_explicit(&log_tail, memory_order_acquire) - target) < 0)
+    {
+        if (flogs_async_output(true) == 0)
+        {
+            FLOG_ASYNC_YIELD();
+        }
+    }
+#if FLOG_COMPRESS
+    // 压缩块缓冲区与输出线程共用，需先占用输出
+    while (atomic_flag_test_and_set_explicit(&log_draining, memory_order_acquire))
+    {
+        FLOG_ASYNC_YIELD();
+    }
+    flogs_compress_flush();
+    atomic_flag_clear_explicit(&log_draining, memory_order_release);
+#endif
+}
+
+/// @brief 获取因缓冲区满而丢弃的记录数
+/// @param
+/// @return 丢弃的记录数
+extern uint32_t flogs_dropped(void)
+{
+    return atomic_load_explicit(&log_drops, memory_order_relaxed);
+}
+#endif
+
+#if FLOG_RECORDER
+/// @brief 设置直接输出的最低等级，低于该等级的记录只写入飞行记录仪
+/// @param level 日志等级，LEVEL_NONE 表示全部只写入飞行记录仪
+extern void flogs_set_live_level(uint8_t level)
+{
+    log_live_level = level;
+}
+
+/// @brief 写入飞行记录仪，超过缓冲区结尾时回绕
+/// @param pos 累计写入位置
+/// @param data 数据
+/// @param size 数据长度
+static void flogs_record_write(uint32_t pos, const char *data, uint32_t size)
+{
+    uint32_t first;
+
+    pos &= FLOG_RECORDER_SIZE - 1;
+    first = FLOG_RECORDER_SIZE - pos;
+    if (first >= size)
+    {
+        memcpy(&log_recorder[pos], data, size);
+    }
+    else
+    {
+        memcpy(&log_recorder[pos], data, first);
+        memcpy(log_recorder, data + first, size - first);
+    }
+}
+
+/// @brief 复制一条记录到飞行记录仪
+/// @param record 记录内容
+/// @param length 记录长度或错误值（-1）
+static void flogs_record_copy(const char *record, int32_t length)
+{
+    uint32_t size = flogs_record_size(record, (length < 0) ? LOG_BUFFER_MAX_SIZE : (uint32_t)length);
+    char head[FLOG_RECORD_HEAD] = {FLOG_RECORD_MARK, (char)size, (char)(size >> 8)};
+    uint32_t pos;
+
+    // 多个线程同时写入时各自占用不同区间
+    pos = atomic_fetch_add_explicit(&log_recorder_head, FLOG_RECORD_HEAD + size, memory_order_relaxed);
+    flogs_record_write(pos, head, FLOG_RECORD_HEAD);
+    flogs_record_write(pos + FLOG_RECORD_HEAD, record, size);
+}
+
+/// @brief 读取记录头中的记录长度，并检查其后紧接下一个记录头或写入位置
+/// @param pos 累计写入位置
+/// @param head 当前写入位置
+/// @return 记录长度，pos 处不是有效记录头时返回 0
+static uint32_t flogs_record_at(uint32_t pos, uint32_t head)
+{
+    uint32_t size;
+    uint32_t next;
+
+    if ((head - pos < FLOG_RECORD_HEAD) || (log_recorder[pos & (FLOG_RECORDER_SIZE - 1)] != FLOG_RECORD_MARK))
+    {
+        return 0;
+    }
+    size = (uint8_t)log_recorder[(pos + 1) & (FLOG_RECORDER_SIZE - 1)] |
+           ((uint32_t)(uint8_t)log_recorder[(pos + 2) & (FLOG_RECORDER_SIZE - 1)] << 8);
+    next = pos + FLOG_RECORD_HEAD + size;
+    if ((size == 0) || (size > LOG_BUFFER_MAX_SIZE) || (head - pos < FLOG_RECORD_HEAD + size) ||
+        ((next != head) && (log_recorder[next & (FLOG_RECORDER_SIZE - 1)] != FLOG_RECORD_MARK)))
+    {
+        return 0;
+    }
+    return size;
+}
+
+/// @brief 编码记录并同时写入飞行记录仪
+/// @param buffer 日志缓冲区
+/// @param level 日志等级
+/// @param tag 日志标签
+/// @param fmt 格式化字符串
+/// @param ap 可变参数列表
+/// @return 记录长度、0（已折叠）或错误值（-1）
+static int32_t flogs_encode_record(char *buffer, uint8_t level, const char *tag, char *fmt, va_list *ap)
+{
+    int32_t length = log_record_encoder(buffer, level, tag, fmt, ap);
+
+    if (length != 0)
+    {
+        flogs_record_copy(buffer, length);
+    }
+    return length;
+}
+
+/// @brief 导出飞行记录仪中的全部记录
+/// @param
+/// @note 只读取缓冲区并调用输出函数，其他线程同时写入时导出在尚未写完的记录处结束
+extern void flogs_dump(void)
+{
+    uint32_t head = atomic_load_explicit(&log_recorder_head, memory_order_acquire);
+    uint32_t pos = 0;
+    uint32_t size = 0;
+    uint32_t first;
+
+    if (head > FLOG_RECORDER_SIZE)
+    {
+        // 最旧的记录已被部分覆盖，跳到第一个有效记录头
+        pos = head - FLOG_RECORDER_SIZE;
+        while ((head - pos >= FLOG_RECORD_HEAD) && ((size = flogs_record_at(pos, head)) == 0))
+        {
+            pos++;
+        }
+    }
+    else
+    {
+        size = flogs_record_at(pos, head);
+    }
+    if (size == 0)
+    {
+        return;
+    }
+#if FLOG_ASYNC && FLOG_COMPRESS
+    while (atomic_flag_test_and_set_explicit(&log_draining, memory_order_acquire))
+    {
+    }
+#endif
+    while (size != 0)
+    {
+        pos += FLOG_RECORD_HEAD;
+        first = FLOG_RECORDER_SIZE - (pos & (FLOG_RECORDER_SIZE - 1));
+        if (first >= size)
+        {
+            flogs_sink(&log_recorder[pos & (FLOG_RECORDER_SIZE - 1)], size);
+        }
+        else
+        {
+            flogs_sink(&log_recorder[pos & (FLOG_RECORDER_SIZE - 1)], first);
+            flogs_sink(log_recorder, size - first);
+        }
+        pos += size;
+        size = flogs_record_at(pos, head);
+    }
+#if FLOG_COMPRESS
+    // 导出内容立即成帧输出
+    flogs_compress_flush();
+#endif
+#if FLOG_ASYNC && FLOG_COMPRESS
+    atomic_flag_clear_explicit(&log_draining, memory_order_release);
+#endif
+}
+
+/// @brief 只写入飞行记录仪的记录，致命日志写入后导出全部记录
+/// @param encoder 记录编码函数
+/// @param level 日志等级
+/// @param tag 日志标签
+/// @param fmt 格式化字符串
+/// @param ap 可变参数列表
+/// @return 记录长度、0（已折叠）或错误值（-1）
+static int32_t flogs_record(FLOGS_Encoder encoder, uint8_t level, const char *tag, char *fmt, va_list *ap)
+{
+    int32_t length = encoder(log_record_buffer, level, tag, fmt, ap);
+
+    if (length != 0)
+    {
+        flogs_record_copy(log_record_buffer, length);
+    }
+    if (level == LEVEL_FATAL)
+    {
+        // 先输出尚在缓冲中的记录，避免与导出内容交错
+#if FLOG_ASYNC || FLOG_BATCH
+        flogs_flush();
+#endif
+        flogs_dump();
+    }
+    return length;
+}
+#endif
+
+/// @brief 编码并输出一条日志记录
+/// @param encoder 记录编码函数
+/// @param level 日志等级
+/// @param tag 日志标签
+/// @param fmt 格式化字符串
+/// @param ap 可变参数列表
+/// @return 记录长度或错误值（-1）
+static int32_t flogs_emit(FLOGS_Encoder encoder, uint8_t level, const char *tag, char *fmt, va_list *ap)
+{
+#if FLOG_STATS
+    log_stats_encoder = encoder;
+    encoder = flogs_encode_stats;
+#endif
+#if FLOG_RECORDER
+    // 低于直接输出等级的记录与致命日志不经过输出函数
+    if (((level < log_live_level) && !log_limit_note) || (level == LEVEL_FATAL))
+    {
+        return flogs_record(encoder, level, tag, fmt, ap);
+    }
+    log_record_encoder = encoder;
+    encoder = flogs_encode_record;
+#endif
+#if FLOG_ASYNC
+    return flogs_async_push(encoder, level, tag, fmt, ap);
+#elif FLOG_BATCH
+    char *buffer;
+    uint32_t now;
+    int32_t length;
+
+    // 剩余空间不足一条记录时先输出，记录直接格式化到批量缓冲区中
+    if (FLOG_BATCH_SIZE - log_batch.length < LOG_BUFFER_MAX_SIZE)
+    {
+        flogs_batch_flush();
+    }
+    buffer = log_batch.buffer + log_batch.length;
+    length = encoder(buffer, level, tag, fmt, ap);
+    if (length != 0)
+    {
+        now = flogs_batch_now();
+        if (log_batch.length == 0)
+        {
+            log_batch.stamp = now;
+        }
+        log_batch.length += flogs_record_size(buffer, (length < 0) ? LOG_BUFFER_MAX_SIZE : (uint32_t)length);
+        if ((log_batch.length >= FLOG_BATCH_BYTES) || (now - log_batch.stamp >= log_batch_ticks))
+        {
+            flogs_batch_flush();
+        }
+    }
+    return length;
+#else
+    int32_t length = encoder(log_buffer, level, tag, fmt, ap);
+    if (length != 0)
+    {
+        flogs_sink(log_buffer, flogs_record_size(log_buffer, (length < 0) ? LOG_BUFFER_MAX_SIZE : (uint32_t)length));
+    }
+    return length;
+#endif
+}
+
+/// @brief 日志格式化输出函数
+/// @param level 日志等级
+/// @param tag 日志标签
+/// @param fmt 格式化字符串
+/// @param  
+/// @return 输出字符串长度或错误值（-1）
+extern int32_t flogs(uint8_t level, const char *tag, char *fmt, ...)
+{
+    int32_t length;
+    va_list ap;
+
+    va_start(ap, fmt);
+    length = flogs_emit(flogs_format, level, tag, fmt, &ap);
+    va_end(ap);
+
+    return length;
+}
+
+#if FLOG_RATE_LIMIT
+/// @brief flogs_limit 段起止地址（由链接器生成，没有调用点时为空）
+extern flogs_limit_t __start_flogs_limit[] __attribute__((weak));
+extern flogs_limit_t __stop_flogs_limit[] __attribute__((weak));
+
+/// @brief 计算记录内容的哈希值（FNV-1a）
+/// @param data 记录内容
+/// @param len 内容长度
+/// @return 哈希值
+static uint32_t flogs_hash(const char *data, uint32_t len)
+{
+    uint32_t hash = 2166136261u;
+
+    while (len--)
+    {
+        hash = (hash ^ (uint8_t)*data++) * 16777619u;
+    }
+    return hash;
+}
+
+/// @brief 翻转缓冲区
+/// @param begin 起始位置
+/// @param end 结束位置（不包含）
+static void flogs_reverse(char *begin, char *end)
+{
+    char temp;
+
+    while (begin < --end)
+    {
+        temp = *begin;
+        *begin++ = *end;
+        *end = temp;
+    }
+}
+
+/// @brief 从调用点取一个令牌
+/// @param site 调用点限速状态
+/// @return 是否允许输出，不允许时计入丢弃数
+extern bool flogs_limit_take(flogs_limit_t *site)
+{
+    uint32_t now = (log_tick_pfun == 0) ? 0 : log_tick_pfun();
+    uint32_t add = (uint32_t)(((uint64_t)(now - site->stamp) * FLOG_RATE_LIMIT_RATE) / log_tick_hz);
+
+    site->last = now;
+    if (add > 0)
+    {
+        // 桶满时不保留余数，否则只扣除已换算为令牌的时间
+        if (add >= (uint32_t)(FLOG_RATE_LIMIT_BURST - site->tokens))
+        {
+            site->tokens = FLOG_RATE_LIMIT_BURST;
+            site->stamp = now;
+        }
+        else
+        {
+            site->tokens += add;
+            site->stamp += (uint32_t)(((uint64_t)add * log_tick_hz) / FLOG_RATE_LIMIT_RATE);
+        }
+    }
+    if (site->tokens == 0)
+    {
+        if (site->suppressed != UINT16_MAX)
+        {
+            site->suppressed++;
+        }
+        return false;
+    }
+    site->tokens--;
+    return true;
+}
+
+/// @brief 格式化一条限速调用点的记录，折叠重复内容并在记录前附加计数提示
+/// @param buffer 日志缓冲区，长度为 LOG_BUFFER_MAX_SIZE
+/// @param level 日志等级
+/// @param tag 日志标签
+/// @param fmt 格式化字符串
+/// @param ap 可变参数列表
+/// @return 记录长度、0（与上一条相同，已折叠）或错误值（-1）
+static int32_t flogs_format_limited(char *buffer, uint8_t level, const char *tag, char *fmt, va_list *ap)
+{
+    flogs_limit_t *site = log_limit;
+    const char *end = buffer + LOG_BUFFER_MAX_SIZE;
+    char *body = flogs_format_head(buffer, level, tag, end);
+    char *note;
+    int32_t length;
+    int32_t note_length;
+    uint32_t size;
+    uint32_t keep;
+    uint32_t hash;
+
+    length = vsffmt(body, (uint32_t)(end - body), fmt, ap);
+    // 时间戳不参与比较；哈希相同时再比较长度与保存的内容，确认重复后才折叠
+    size = (length < 0) ? (uint32_t)(end - body) : (uint32_t)length;
+    keep = (size < FLOG_RATE_LIMIT_TEXT) ? size : FLOG_RATE_LIMIT_TEXT;
+    hash = flogs_hash(body, size);
+    if ((hash == site->hash) && (size == site->length) && (memcmp(body, site->text, keep) == 0))
+    {
+        if (site->repeated != UINT16_MAX)
+        {
+            site->repeated++;
+        }
+        return 0;
+    }
+    site->hash = hash;
+    site->length = (uint16_t)size;
+    memcpy(site->text, body, keep);
+    if (length < 0)
+    {
+        return -1;
+    }
+    length += (int32_t)(body - buffer);
+
+    // 有计数时在记录末尾写入提示，再旋转到记录之前，放不下时留到下一条
+    if ((site->repeated != 0) || (site->suppressed != 0))
+    {
+        note = flogs_format_head(buffer + length - 1, level, tag, end);
+        note_length = (note < end) ? ffmt(note, (uint32_t)(end - note), false, FLOG_LIMIT_NOTE,
+                                          (uint32_t)site->repeated, (uint32_t)site->suppressed)
+                                   : -1;
+        if (note_length > 0)
+        {
+            note += note_length - 1;
+            flogs_reverse(buffer, buffer + length - 1);
+            flogs_reverse(buffer + length - 1, note);
+            flogs_reverse(buffer, note);
+            site->repeated = 0;
+            site->suppressed = 0;
+            return (int32_t)(note - buffer) + 1;
+        }
+        buffer[length - 1] = '\0';
+    }
+    return length;
+}
+
+/// @brief 限速调用点日志输出函数
+/// @param site 调用点限速状态
+/// @param fmt 格式化字符串
+/// @param
+/// @return 输出字符串长度、0（已折叠）或错误值（-1）
+extern int32_t flogs_limited(flogs_limit_t *site, char *fmt, ...)
+{
+    int32_t length;
+    va_list ap;
+
+    va_start(ap, fmt);
+    log_limit = site;
+    length = flogs_emit(flogs_format_limited, site->level, site->tag, fmt, &ap);
+    va_end(ap);
+
+    return length;
+}
+
+/// @brief 输出空闲调用点的折叠与丢弃计数
+/// @param
+/// @return 输出的提示条数
+/// @note 在空闲任务或定时器中周期调用，调用点最后一次调用 1 秒后才输出
+extern uint32_t flogs_limit_poll(void)
+{
+    flogs_limit_t *site;
+    uint32_t now = (log_tick_pfun == 0) ? 0 : log_tick_pfun();
+    uint32_t count = 0;
+
+    for (site = __start_flogs_limit; site < __stop_flogs_limit; site++)
+    {
+        if (((site->repeated != 0) || (site->suppressed != 0)) && (now - site->last >= log_tick_hz))
+        {
+            // 提示不受直接输出等级与异步丢弃影响，否则计数会无声丢失
+            log_limit_note = true;
+            flogs(site->level, site->tag, FLOG_LIMIT_NOTE, (uint32_t)site->repeated, (uint32_t)site->suppressed);
+            log_limit_note = false;
+            site->repeated = 0;
+            site->suppressed = 0;
+            // 之后相同的记录重新输出
+            site->hash = 0;
+            site->length = 0;
+            count++;
+        }
+    }
+    return count;
+}
+#endif
+
+#if FLOG_DEFERRED || defined(FLOG_DECODER) || (FLOG_KV == FLOG_KV_TLV)
+// 延迟记录格式（小端）：
+// [0] 同步字节 [1] 日志等级 [2..3] 标签偏移 [4..5] 格式化字符串偏移 [6] 参数长度 [7..] 参数 [末尾] 校验和
+//
+// 参数按格式化字符串中的说明符依次存放：
+// [d] [f]  zigzag 变长整数（1 ~ 5 字节）
+// [u]      变长整数（1 ~ 5 字节）
+// [x]      按长度说明符存放 1 / 2 / 4 字节
+// [s] [m]  1 字节长度 + 内容
+// [F]      8 字节 IEEE-754 双精度
+#define FLOG_DEFER_SYNC 0xF5
+#define FLOG_DEFER_HEAD 7
+
+/// @brief 计算记录校验和
+/// @param record 记录
+/// @param length 不含校验和的记录长度
+/// @return 校验和
+static uint8_t flogs_defer_sum(const uint8_t *record, uint32_t length)
+{
+    uint8_t sum = 0;
+    while (length--)
+    {
+        sum += *record++;
+    }
+    return sum;
+}
+#endif
+
+#if FLOG_DEFERRED || (FLOG_KV == FLOG_KV_TLV)
+/// @brief 写入变长整数
+/// @param p 写入位置
+/// @param num 无符号数
+/// @return 写入的字节数
+static uint32_t flogs_put_varint(uint8_t *p, uint32_t num)
+{
+    uint32_t length = 0;
+    while (num >= 0x80)
+    {
+        p[length++] = (uint8_t)(num | 0x80);
+        num >>= 7;
+    }
+    p[length++] = (uint8_t)num;
+    return length;
+}
+
+/// @brief 写入带长度的字节串，超出剩余空间时截断
+/// @param p 写入位置
+/// @param end 缓冲区结尾
+/// @param data 数据
+/// @param length 数据长度
+/// @return 写入后的位置
+static uint8_t *flogs_put_bytes(uint8_t *p, const uint8_t *end, const uint8_t *data, uint32_t length)
+{
+    if (length > (uint32_t)(end - p) - 1)
+    {
+        length = (uint32_t)(end - p) - 1;
+    }
+    *p++ = (uint8_t)length;
+    memcpy(p, data, length);
+    return p + length;
+}
+#endif
+
+#if FLOG_DEFERRED
+/// @brief 编码一条延迟日志记录
+/// @param buffer 日志缓冲区，长度为 LOG_BUFFER_MAX_SIZE
+/// @param level 日志等级
+/// @param tag 日志标签（位于 flogs_fmt 段）
+/// @param fmt 格式化字符串（位于 flogs_fmt 段）
+/// @param ap 可变参数列表
+/// @return 记录长度、0（偏移超出 16 位，已丢弃）或错误值（-1）
+static int32_t flogs_encode(char *buffer, uint8_t level, const char *tag, char *fmt, va_list *ap)
+{
+    uint8_t *record = (uint8_t *)buffer;
+    uint8_t *p = record + FLOG_DEFER_HEAD;
+    const char *fmt_start = fmt;
+    // 参数长度字段只有 1 字节，且结尾要留出校验和
+    const uint8_t *end = record + ((LOG_BUFFER_MAX_SIZE < FLOG_DEFER_HEAD + 256) ? LOG_BUFFER_MAX_SIZE - 1 : FLOG_DEFER_HEAD + 255);
+    uint32_t offset;
+    uint32_t size;
+    uint32_t num;
+    int32_t value;
+    const char *str;
+
+    while (*fmt != '\0')
+    {
+        if (*fmt++ != '%')
+        {
+            continue;
+        }
+        if (*fmt == '%')
+        {
+            fmt++;
+            continue;
+        }
+        if (*fmt == '+' || *fmt == '-')
+        {
+            fmt++;
+        }
+        size = 2;
+        if (*fmt == 'h')
+        {
+            size = 1;
+            fmt++;
+        }
+        else if (*fmt == 'l')
+        {
+            size = 4;
+            fmt++;
+        }
+        // 任何数值参数最多占用 8 字节
+        if (end - p < 8)
+        {
+            return -1;
+        }
+        switch (*fmt++)
+        {
+        case 'd':
+        case 'f':
+            value = va_arg(*ap, int32_t);
+            p += flogs_put_varint(p, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+            break;
+        case 'u':
+            p += flogs_put_varint(p, va_arg(*ap, uint32_t));
+            break;
+        case 'x':
+            num = va_arg(*ap, uint32_t);
+            while (size--)
+            {
+                *p++ = (uint8_t)num;
+                num >>= 8;
+            }
+            break;
+        case 's':
+            str = va_arg(*ap, const char *);
+            p = flogs_put_bytes(p, end, (const uint8_t *)str, (uint32_t)strlen(str));
+            break;
+        case 'm':
+            str = va_arg(*ap, const char *);
+            num = va_arg(*ap, uint32_t);
+            p = flogs_put_bytes(p, end, (const uint8_t *)str, num);
+            break;
+#ifdef FFMT_DOUBLE
+        case 'F':
+        {
+            double dnum = va_arg(*ap, double);
+            uint64_t bits;
+            memcpy(&bits, &dnum, sizeof(bits));
+            for (size = 0; size < 8; size++)
+            {
+                *p++ = (uint8_t)(bits >> (size * 8));
+            }
+            break;
+        }
+#endif
+        default:
+            return -1;
+        }
+    }
+
+    // 偏移超出 16 位的记录无法还原，直接丢弃
+    offset = (uint32_t)(tag - __start_flogs_fmt);
+    if (offset >= FLOG_FMT_SECTION_MAX)
+    {
+        return 0;
+    }
+    record[0] = FLOG_DEFER_SYNC;
+    record[1] = level;
+    record[2] = (uint8_t)offset;
+    record[3] = (uint8_t)(offset >> 8);
+    offset = (uint32_t)(fmt_start - __start_flogs_fmt);
+    if (offset >= FLOG_FMT_SECTION_MAX)
+    {
+        return 0;
+    }
+    record[4] = (uint8_t)offset;
+    record[5] = (uint8_t)(offset >> 8);
+    record[6] = (uint8_t)(p - record - FLOG_DEFER_HEAD);
+    *p = flogs_defer_sum(record, (uint32_t)(p - record));
+    return (int32_t)(p - record) + 1;
+}
+
+/// @brief 延迟日志输出函数，由 FLOG_EMIT 调用
+/// @param level 日志等级
+/// @param tag 日志标签（位于 flogs_fmt 段）
+/// @param fmt 格式化字符串（位于 flogs_fmt 段）
+/// @param
+/// @return 记录长度或错误值（-1）
+extern int32_t flogs_deferred(uint8_t level, const char *tag, char *fmt, ...)
+{
+    int32_t length;
+    va_list ap;
+
+    va_start(ap, fmt);
+    length = flogs_emit(flogs_encode, level, tag, fmt, &ap);
+    va_end(ap);
+
+    return length;
+}
+#endif
+
+#ifdef FLOG_DECODER
+/// @brief 读取变长整数
+/// @param p 读取位置，完成后指向下一个字节
+/// @param end 参数结尾
+/// @param num 读取结果
+/// @return 是否读取成功
+static bool flogs_get_varint(const uint8_t **p, const uint8_t *end, uint32_t *num)
+{
+    uint32_t shift = 0;
+    *num = 0;
+    while (*p < end && shift < 35)
+    {
+        *num |= (uint32_t)(**p & 0x7F) << shift;
+        if ((*(*p)++ & 0x80) == 0)
+        {
+            return true;
+        }
+        shift += 7;
+    }
+    return false;
+}
+
+/// @brief 将一条延迟记录还原为文本
+/// @param buffer 文本缓冲区，长度为 LOG_BUFFER_MAX_SIZE
+/// @param record 完整且校验通过的记录
+/// @param strtab flogs_fmt 段内容
+/// @return 文本长度（含 '\0'）或错误值（-1，参数与格式化字符串不匹配）
+static int32_t flogs_render(char *buffer, const uint8_t *record, const char *strtab)
+{
+    const char *end = buffer + LOG_BUFFER_MAX_SIZE - 1;
+    const uint8_t *p = record + FLOG_DEFER_HEAD;
+    const uint8_t *pend = p + record[6];
+    const char *fmt = strtab + (record[4] | (record[5] << 8));
+    char *pBuffer = buffer;
+    char spec[5];
+    uint32_t spec_len;
+    uint32_t size;
+    uint32_t num;
+    uint32_t i;
+    int32_t length;
+
+    pBuffer = append2String(pBuffer, log_level_prefix[record[1]], end);
+    pBuffer = append2String(pBuffer, strtab + (record[2] | (record[3] << 8)), end);
+    pBuffer = append2String(pBuffer, ": ", end);
+
+    while (*fmt != '\0')
+    {
+        if (*fmt != '%' || fmt[1] == '%')
+        {
+            if (pBuffer < end)
+            {
+                *pBuffer++ = *fmt;
+            }
+            fmt += (*fmt == '%') ? 2 : 1;
+            continue;
+        }
+        // 复制说明符，逐个交给 ffmt 格式化
+        spec_len = 0;
+        spec[spec_len++] = *fmt++;
+        if (*fmt == '+' || *fmt == '-')
+        {
+            spec[spec_len++] = *fmt++;
+        }
+        size = 2;
+        if (*fmt == 'h' || *fmt == 'l')
+        {
+            size = (*fmt == 'h') ? 1 : 4;
+            spec[spec_len++] = *fmt++;
+        }
+        spec[spec_len++] = *fmt;
+        spec[spec_len] = '\0';
+
+        switch (*fmt++)
+        {
+        case 'd':
+        case 'f':
+            if (!flogs_get_varint(&p, pend, &num))
+            {
+                return -1;
+            }
+            length = ffmt(pBuffer, (uint32_t)(end - pBuffer) + 1, false, spec, (int32_t)((num >> 1) ^ (0u - (num & 1))));
+            break;
+        case 'u':
+            if (!flogs_get_varint(&p, pend, &num))
+            {
+                return -1;
+            }
+            length = ffmt(pBuffer, (uint32_t)(end - pBuffer) + 1, false, spec, num);
+            break;
+        case 'x':
+            if ((uint32_t)(pend - p) < size)
+            {
+                return -1;
+            }
+            for (num = 0, i = size; i > 0; i--)
+            {
+                num = (num << 8) | p[i - 1];
+            }
+            p += size;
+            length = ffmt(pBuffer, (uint32_t)(end - pBuffer) + 1, false, spec, num);
+            break;
+        case 's':
+            if (p >= pend || (uint32_t)(pend - p) - 1 < *p)
+            {
+                return -1;
+            }
+            for (num = *p++; num > 0; num--, p++)
+            {
+                if (pBuffer < end)
+                {
+                    *pBuffer++ = (char)*p;
+                }
+            }
+            length = 1;
+            break;
+        case 'm':
+            if (p >= pend || (uint32_t)(pend - p) - 1 < *p)
+            {
+                return -1;
+            }
+            num = *p++;
+            length = ffmt(pBuffer, (uint32_t)(end - pBuffer) + 1, false, spec, p, num);
+            p += num;
+            break;
+#ifdef FFMT_DOUBLE
+        case 'F':
+        {
+            uint64_t bits = 0;
+            double dnum;
+            if (pend - p < 8)
+            {
+                return -1;
+            }
+            for (size = 8; size > 0; size--)
+            {
+                bits = (bits << 8) | p[size - 1];
+            }
+            p += 8;
+            memcpy(&dnum, &bits, sizeof(dnum));
+            length = ffmt(pBuffer, (uint32_t)(end - pBuffer) + 1, false, spec, dnum);
+            break;
+        }
+#endif
+        default:
+            return -1;
+        }
+        // ffmt 返回值包含 '\0'，溢出时文本已截断到缓冲区结尾
+        pBuffer = (length < 0) ? (char *)end : pBuffer + length - 1;
+    }
+    if (p != pend)
+    {
+        return -1;
+    }
+    *pBuffer++ = '\0';
+    return (int32_t)(pBuffer - buffer);
+}
+
+/// @brief 解码延迟日志数据流，每条记录还原为文本后交给输出函数
+/// @param stream 数据流
+/// @param len 数据流长度
+/// @param strtab flogs_fmt 段内容
+/// @param strtab_len flogs_fmt 段长度
+/// @return 已处理的字节数，末尾不完整的记录留待下次与后续数据一起传入
+/// @note 数据流中的错误字节会被跳过，遇到下一个有效记录时自动重新同步
+extern uint32_t flogs_decode(const uint8_t *stream, uint32_t len, const char *strtab, uint32_t strtab_len)
+{
+    char text[LOG_BUFFER_MAX_SIZE];
+    const uint8_t *record;
+    uint32_t pos = 0;
+    uint32_t size;
+    int32_t length;
+
+    while (pos < len)
+    {
+        record = stream + pos;
+        if (record[0] != FLOG_DEFER_SYNC)
+        {
+            pos++;
+            continue;
+        }
+        if (len - pos < FLOG_DEFER_HEAD + 1)
+        {
+            break;
+        }
+        size = FLOG_DEFER_HEAD + record[6];
+        if (len - pos < size + 1)
+        {
+            break;
+        }
+        // 校验失败或偏移越界视为误同步，跳过同步字节继续查找
+        if (flogs_defer_sum(record, size) != record[size] ||
+            record[1] >= LEVEL_NONE ||
+            (uint32_t)(record[2] | (record[3] << 8)) >= strtab_len ||
+            (uint32_t)(record[4] | (record[5] << 8)) >= strtab_len)
+        {
+            pos++;
+            continue;
+        }
+        length = flogs_render(text, record, strtab);
+        if (length < 0)
+        {
+            pos++;
+            continue;
+        }
+        // 与文本模式一致，输出长度不含末尾的 '\0'
+        log_output_pfun(text, (uint32_t)length - 1);
+        pos += size + 1;
+    }
+    return pos;
+}
+#endif
+
+#if FLOG_KV == FLOG_KV_JSON
+/// @brief 结构化日志等级名称
+static const char *log_level_name[] = {"SUCC", "INFO", "DEBG", "WARN", "ERRO", "FATL"};
+
+// 截断时在记录末尾写入 ,"trunc":true}\n 与 '\0' 所需的空间
+#define FLOG_KV_TAIL 17
+
+/// @brief 写入 JSON 字符串（含引号与转义）
+/// @param p 写入位置
+/// @param end 可写入的结尾
+/// @param str 字符串
+/// @return 写入后的位置，空间不足时返回 0
+static char *flogs_json_str(char *p, const char *end, const char *str)
+{
+    static const char hex[] = "0123456789abcdef";
+    uint8_t c;
+
+    if (p >= end)
+    {
+        return 0;
+    }
+    *p++ = '"';
+    while ((c = (uint8_t)*str++) != '\0')
+    {
+        if ((c >= 0x20) && (c != '"') && (c != '\\'))
+        {
+            if (p >= end)
+            {
+                return 0;
+            }
+            *p++ = (char)c;
+            continue;
+        }
+        if (end - p < 6)
+        {
+            return 0;
+        }
+        *p++ = '\\';
+        switch (c)
+        {
+        case '"':
+        case '\\':
+            *p++ = (char)c;
+            break;
+        case '\n':
+            *p++ = 'n';
+            break;
+        case '\r':
+            *p++ = 'r';
+            break;
+        case '\t':
+            *p++ = 't';
+            break;
+        default:
+            *p++ = 'u';
+            *p++ = '0';
+            *p++ = '0';
+            *p++ = hex[c >> 4];
+            *p++ = hex[c & 0x0F];
+            break;
+        }
+    }
+    if (p >= end)
+    {
+        return 0;
+    }
+    *p++ = '"';
+    return p;
+}
+
+/// @brief 写入 JSON 键（含逗号与冒号）
+/// @param p 写入位置
+/// @param end 可写入的结尾
+/// @param key 键名
+/// @return 写入后的位置，空间不足时返回 0
+static char *flogs_json_key(char *p, const char *end, const char *key)
+{
+    if (p >= end)
+    {
+        return 0;
+    }
+    *p++ = ',';
+    p = flogs_json_str(p, end, key);
+    if ((p == 0) || (p >= end))
+    {
+        return 0;
+    }
+    *p++ = ':';
+    return p;
+}
+
+/// @brief 写入 JSON 键值对
+/// @param p 写入位置
+/// @param end 可写入的结尾
+/// @param kv 键值对
+/// @return 写入后的位置，空间不足时返回 0
+static char *flogs_json_kv(char *p, const char *end, const flogs_kv_t *kv)
+{
+    p = flogs_json_key(p, end, kv->key);
+    if (p == 0)
+    {
+        return 0;
+    }
+    if (kv->type == FLOGS_KV_Str)
+    {
+        return flogs_json_str(p, end, kv->value.s);
+    }
+    // 数值最长 13 字节
+    if (end - p < 13)
+    {
+        return 0;
+    }
+    switch (kv->type)
+    {
+    case FLOGS_KV_Int:
+        return p + ffmt_itoa(p, kv->value.i);
+    case FLOGS_KV_Uint:
+        return p + ffmt_utoa(p, kv->value.u);
+    case FLOGS_KV_Fq12:
+        return p + ffmt_fq12toa(p, kv->value.fq);
+    default:
+        memcpy(p, "null", 4);
+        return p + 4;
+    }
+}
+
+/// @brief 编码一条 JSON 行记录
+/// @param buffer 日志缓冲区，长度为 LOG_BUFFER_MAX_SIZE
+/// @param level 日志等级
+/// @param tag 日志标签
+/// @param msg 日志消息
+/// @param ap 键值对数组指针与数量
+/// @return 记录长度（含 '\0'）
+static int32_t flogs_encode_kv(char *buffer, uint8_t level, const char *tag, char *msg, va_list *ap)
+{
+    const flogs_kv_t *kv = va_arg(*ap, const flogs_kv_t *);
+    uint32_t count = va_arg(*ap, uint32_t);
+    const char *end = buffer + LOG_BUFFER_MAX_SIZE - FLOG_KV_TAIL;
+    char *p = buffer;
+    char *next;
+    bool trunc = false;
+
+    // 固定字段
+    p = append2String(p, "{\"lvl\":\"", end);
+    p = append2String(p, log_level_name[level], end);
+    *p++ = '"';
+#if FLOG_TIMESTAMP
+    uint32_t msec;
+    if (flogs_timestamp_update(&msec) && (end - p > log_ts.length + 8))
+    {
+        // 时间戳缓存为 "[秒."，去掉方括号
+        p = append2String(p, ",\"ts\":", end);
+        memcpy(p, &log_ts.text[1], log_ts.length - 1);
+        p = flogs_timestamp_msec(p + log_ts.length - 1, msec);
+    }
+#endif
+    next = flogs_json_key(p, end, "tag");
+    next = (next == 0) ? 0 : flogs_json_str(next, end, tag);
+    next = (next == 0) ? 0 : flogs_json_key(next, end, "msg");
+    next = (next == 0) ? 0 : flogs_json_str(next, end, msg);
+    if (next == 0)
+    {
+        trunc = true;
+    }
+    else
+    {
+        p = next;
+    }
+
+    // 键值对，放不下时丢弃剩余部分
+    for (uint32_t i = 0; (i < count) && !trunc; i++)
+    {
+        next = flogs_json_kv(p, end, &kv[i]);
+        if (next == 0)
+        {
+            trunc = true;
+            break;
+        }
+        p = next;
+    }
+    if (trunc)
+    {
+        memcpy(p, ",\"trunc\":true", 13);
+        p += 13;
+    }
+    *p++ = '}';
+    *p++ = '\n';
+    *p++ = '\0';
+    return (int32_t)(p - buffer);
+}
+#endif
+
+#if FLOG_KV == FLOG_KV_TLV
+// 结构化二进制记录格式（小端）：
+// [0] 同步字节 [1] 日志等级 [2..3] TLV 总长度 [4..] TLV 序列 [末尾] 校验和
+//
+// TLV 为 1 字节类型 + 1 字节长度 + 内容：
+// [01] 标签 [02] 消息 [03] 时间戳（秒、毫秒两个变长整数） [04] 记录被截断（无内容）
+// [10] 键名 [11] 有符号整数（zigzag 变长整数） [12] 无符号整数（变长整数）
+// [13] fq12_t（zigzag 变长整数） [14] 字符串
+#define FLOG_KV_HEAD 4
+
+/// @brief TLV 类型 枚举
+typedef enum tagFLOGS_TLV_Type
+{
+    FLOGS_TLV_Tag = 0x01,
+    FLOGS_TLV_Msg = 0x02,
+    FLOGS_TLV_Time = 0x03,
+    FLOGS_TLV_Trunc = 0x04,
+    FLOGS_TLV_Key = 0x10,
+    FLOGS_TLV_Int = 0x11,
+    FLOGS_TLV_Uint = 0x12,
+    FLOGS_TLV_Fq12 = 0x13,
+    FLOGS_TLV_Str = 0x14,
+} FLOGS_TLV_Type;
+
+/// @brief 写入字符串 TLV
+/// @param p 写入位置
+/// @param end 可写入的结尾
+/// @param type TLV 类型
+/// @param str 字符串
+/// @param cut 空间不足时是否截断写入
+/// @return 写入后的位置，空间不足且不截断时返回 0
+static uint8_t *flogs_tlv_str(uint8_t *p, const uint8_t *end, uint8_t type, const char *str, bool cut)
+{
+    uint32_t length = (uint32_t)strlen(str);
+
+    if (length > 0xFF)
+    {
+        length = 0xFF;
+    }
+    if ((end - p < 2) || ((!cut) && ((uint32_t)(end - p) < length + 2)))
+    {
+        return 0;
+    }
+    *p++ = type;
+    return flogs_put_bytes(p, end, (const uint8_t *)str, length);
+}
+
+/// @brief 写入整数 TLV
+/// @param p 写入位置（至少 7 字节）
+/// @param type TLV 类型
+/// @param num 无符号数或 zigzag 编码后的有符号数
+/// @return 写入后的位置
+static uint8_t *flogs_tlv_int(uint8_t *p, uint8_t type, uint32_t num)
+{
+    uint32_t length = flogs_put_varint(p + 2, num);
+
+    p[0] = type;
+    p[1] = (uint8_t)length;
+    return p + 2 + length;
+}
+
+/// @brief 编码一条二进制 TLV 记录
+/// @param buffer 日志缓冲区，长度为 LOG_BUFFER_MAX_SIZE
+/// @param level 日志等级
+/// @param tag 日志标签
+/// @param msg 日志消息
+/// @param ap 键值对数组指针与数量
+/// @return 记录长度
+static int32_t flogs_encode_kv(char *buffer, uint8_t level, const char *tag, char *msg, va_list *ap)
+{
+    const flogs_kv_t *kv = va_arg(*ap, const flogs_kv_t *);
+    uint32_t count = va_arg(*ap, uint32_t);
+    uint8_t *record = (uint8_t *)buffer;
+    // 保留截断标记与校验和的空间
+    const uint8_t *end = record + LOG_BUFFER_MAX_SIZE - 3;
+    uint8_t *p = record + FLOG_KV_HEAD;
+    uint8_t *next;
+    uint32_t length;
+    bool trunc = false;
+
+    record[0] = FLOG_KV_SYNC;
+    record[1] = level;
+    // 标签截断时为消息 TLV 头保留 2 字节，两者始终能写入
+    p = flogs_tlv_str(p, end - 2, FLOGS_TLV_Tag, tag, true);
+    p = flogs_tlv_str(p, end, FLOGS_TLV_Msg, msg, true);
+#if FLOG_TIMESTAMP
+    uint32_t msec;
+    if (flogs_timestamp_update(&msec) && (end - p >= 9))
+    {
+        p[0] = FLOGS_TLV_Time;
+        length = flogs_put_varint(p + 2, log_ts.sec);
+        length += flogs_put_varint(p + 2 + length, msec);
+        p[1] = (uint8_t)length;
+        p += 2 + length;
+    }
+#endif
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        next = flogs_tlv_str(p, end, FLOGS_TLV_Key, kv[i].key, false);
+        if ((next == 0) || ((kv[i].type != FLOGS_KV_Str) && (end - next < 7)))
+        {
+            trunc = true;
+            break;
+        }
+        switch (kv[i].type)
+        {
+        case FLOGS_KV_Int:
+            next = flogs_tlv_int(next, FLOGS_TLV_Int, ((uint32_t)kv[i].value.i << 1) ^ (uint32_t)(kv[i].value.i >> 31));
+            break;
+        case FLOGS_KV_Uint:
+            next = flogs_tlv_int(next, FLOGS_TLV_Uint, kv[i].value.u);
+            break;
+        case FLOGS_KV_Fq12:
+            next = flogs_tlv_int(next, FLOGS_TLV_Fq12, ((uint32_t)kv[i].value.fq << 1) ^ (uint32_t)(kv[i].value.fq >> 31));
+            break;
+        default:
+            next = flogs_tlv_str(next, end, FLOGS_TLV_Str, kv[i].value.s, false);
+            break;
+        }
+        if (next == 0)
+        {
+            trunc = true;
+            break;
+        }
+        p = next;
+    }
+    if (trunc)
+    {
+        *p++ = FLOGS_TLV_Trunc;
+        *p++ = 0;
+    }
+
+    length = (uint32_t)(p - record);
+    record[2] = (uint8_t)(length - FLOG_KV_HEAD);
+    record[3] = (uint8_t)((length - FLOG_KV_HEAD) >> 8);
+    *p = flogs_defer_sum(record, length);
+    return (int32_t)length + 1;
+}
+#endif
+
+#if FLOG_KV
+/// @brief 以可变参数方式传递键值对，交给编码函数
+/// @param level 日志等级
+/// @param tag 日志标签
+/// @param msg 日志消息
+/// @param  键值对数组指针与数量
+/// @return 记录长度或错误值（-1）
+static int32_t flogs_kv_call(uint8_t level, const char *tag, char *msg, ...)
+{
+    int32_t length;
+    va_list ap;
+
+    va_start(ap, msg);
+    length = flogs_emit(flogs_encode_kv, level, tag, msg, &ap);
+    va_end(ap);
+
+    return length;
+}
+
+/// @brief 结构化日志输出函数
+/// @param level 日志等级
+/// @param tag 日志标签
+/// @param msg 日志消息
+/// @param kv 键值对数组
+/// @param count 键值对数量
+/// @return 记录长度或错误值（-1）
+extern int32_t flogs_kv(uint8_t level, const char *tag, const char *msg, const flogs_kv_t *kv, uint32_t count)
+{
+    return flogs_kv_call(level, tag, (char *)msg, kv, count);
+}
+#endif
@@ -33,51 +33,431 @@
 #define __FLOGS_H__
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// 输出函数收到的文本记录长度不含末尾的 '\0'，二进制记录（延迟输出、TLV、压缩帧）为完整长度
 
 // 日志最大缓冲区
+// 定义 FFMT_THREAD_SAFE 时同步模式下每个线程各有一个缓冲区，多线程可同时打印日志而无需加锁
 #define LOG_BUFFER_MAX_SIZE (256) // Bytes
 // 最大输出日志等级
 #define FLOG_LEVEL LEVEL_SUCCESS
 
+// 环形缓冲区满时的处理策略
+#define FLOG_OVERFLOW_DROP 0  // 丢弃新记录
+#define FLOG_OVERFLOW_BLOCK 1 // 等待空位
+
+// 异步输出模式（需要 C11 原子操作支持）
+// 0：同步输出，在调用者线程直接调用输出函数
+// 1：异步输出，记录写入无锁环形缓冲区，由 flogs_drain 在后台线程调用输出函数
+#ifndef FLOG_ASYNC
+#define FLOG_ASYNC 0
+#endif
+// 异步环形缓冲区记录数量（必须为 2 的幂）
+#ifndef FLOG_ASYNC_SLOTS
+#define FLOG_ASYNC_SLOTS (16)
+#endif
+// 异步环形缓冲区满时的处理策略
+#ifndef FLOG_ASYNC_OVERFLOW
+#define FLOG_ASYNC_OVERFLOW FLOG_OVERFLOW_DROP
+#endif
+// 等待空位时其他线程正在输出，写入线程让出处理器的方式，避免空转抢占输出线程
+// 默认在 POSIX 系统上调用 sched_yield，裸机上为空（中断中等待空位前应确保输出不会被其打断）
+#ifndef FLOG_ASYNC_YIELD
+#if defined(__unix__) || defined(__APPLE__)
+#define FLOG_ASYNC_YIELD() sched_yield()
+#else
+#define FLOG_ASYNC_YIELD() ((void)0)
+#endif
+#endif
+
+// 延迟（二进制）输出模式（需要 GCC 兼容编译器与链接器）
+// 0：在调用者线程格式化文本
+// 1：只记录等级、标签与格式化字符串在 flogs_fmt 段中的偏移以及原始参数，
+//    由主机端使用 flogs_decode 还原为文本
+// 段内容可使用 objcopy -O binary --only-section=flogs_fmt 从固件中导出
+// 主机端定义 FLOG_DECODER 宏以编译解码函数 flogs_decode
+// 记录中的偏移为 16 位，flogs_fmt 段不能超过 64 KiB（flogs_init 检查），FLOG_EMIT 的标签必须为字符串字面量
+#ifndef FLOG_DEFERRED
+#define FLOG_DEFERRED 0
+#endif
+// flogs_fmt 段属性：GCC 下声明为可合并字符串段，链接器合并各调用点相同的标签与格式化字符串
+// 段标志附加在段名之后，末尾的汇编注释符屏蔽编译器自动追加的段标志
+#ifndef FLOG_FMT_SECTION
+#if defined(__clang__)
+#define FLOG_FMT_SECTION "flogs_fmt"
+#elif defined(__aarch64__)
+#define FLOG_FMT_SECTION "flogs_fmt,\"aMS\",%progbits,1 //"
+#elif defined(__arm__)
+#define FLOG_FMT_SECTION "flogs_fmt,\"aMS\",%progbits,1 @"
+#else
+#define FLOG_FMT_SECTION "flogs_fmt,\"aMS\",%progbits,1 #"
+#endif
+#endif
+
+// 时间戳
+// 0：不输出时间戳
+// 1：在等级前缀后输出 "[秒.毫秒] "，时钟源由 flogs_timestamp_init 指定
+//    秒部分的文本被缓存，同一秒内只改写毫秒数字
+// 时钟计数按 32 位无符号数回绕处理，两次记录的间隔不能超过 2^32 个计数
+// 高频计数器（如 TSC）请先分频后再作为时钟源；延迟输出模式不包含时间戳
+#ifndef FLOG_TIMESTAMP
+#define FLOG_TIMESTAMP 0
+#endif
+
+// 调用点限速与重复折叠（需要 GCC 兼容编译器与链接器，不支持延迟输出模式）
+// 0：不限速
+// 1：每个调用点使用令牌桶限速，超出速率的记录直接丢弃（不计算参数）并计数，
+//    内容与该调用点上一条记录相同时折叠计数；计数附在该调用点下一条记录之前输出，
+//    或由 flogs_limit_poll 在调用点空闲 1 秒后输出（不受直接输出等级过滤，异步缓冲区满时等待）
+// 令牌补充使用 flogs_timestamp_init 指定的时钟源，未指定时每个调用点只有初始的突发令牌
+// 调用点状态不加锁，多个线程同时使用同一调用点时计数为近似值
+#ifndef FLOG_RATE_LIMIT
+#define FLOG_RATE_LIMIT 0
+#endif
+// 每个调用点每秒补充的令牌数
+#ifndef FLOG_RATE_LIMIT_RATE
+#define FLOG_RATE_LIMIT_RATE (10)
+#endif
+// 每个调用点的令牌桶容量（不超过 255）
+#ifndef FLOG_RATE_LIMIT_BURST
+#define FLOG_RATE_LIMIT_BURST (20)
+#endif
+// 每个调用点保存的上一条记录内容长度，用于确认重复（哈希与长度也必须相同）
+// 默认保存完整记录；调小可节省内存，超出部分只比较哈希
+#ifndef FLOG_RATE_LIMIT_TEXT
+#define FLOG_RATE_LIMIT_TEXT LOG_BUFFER_MAX_SIZE
+#endif
+#if FLOG_RATE_LIMIT && FLOG_DEFERRED
+#error "FLOG_RATE_LIMIT is not supported with FLOG_DEFERRED"
+#endif
+
+// 批量输出
+// 0：每条记录调用一次输出函数
+// 1：多条记录合并后以 iovec 列表一次交给 flogs_batch_init 指定的输出函数（writev 风格）
+//    同步模式下记录直接格式化到批量缓冲区中（定义 FFMT_THREAD_SAFE 时每个线程独立），
+//    异步模式下 iovec 直接指向环形缓冲区的槽，输出完成后才释放
+//    累计字节数达到 FLOG_BATCH_BYTES、最早的记录等待超过 FLOG_BATCH_LATENCY 毫秒或调用 flogs_flush 时输出
+//    等待时间使用 flogs_timestamp_init 指定的时钟源，只在输出日志或调用 flogs_drain 时检查
+// 异步丢弃模式下 FLOG_BATCH_BYTES 应小于环形缓冲区容量，否则等待期间新记录会被丢弃
+#ifndef FLOG_BATCH
+#define FLOG_BATCH 0
+#endif
+// 同步模式批量缓冲区大小（不小于 LOG_BUFFER_MAX_SIZE）
+#ifndef FLOG_BATCH_SIZE
+#define FLOG_BATCH_SIZE (2048) // Bytes
+#endif
+// 累计字节数达到该值时输出
+#ifndef FLOG_BATCH_BYTES
+#define FLOG_BATCH_BYTES (1024) // Bytes
+#endif
+// 最早的记录最长等待时间
+#ifndef FLOG_BATCH_LATENCY
+#define FLOG_BATCH_LATENCY (100) // ms
+#endif
+// 异步模式单次输出的最大记录数
+#ifndef FLOG_BATCH_IOV
+#define FLOG_BATCH_IOV (16)
+#endif
+#if FLOG_BATCH && (FLOG_BATCH_SIZE < LOG_BUFFER_MAX_SIZE)
+#error "FLOG_BATCH_SIZE must not be smaller than LOG_BUFFER_MAX_SIZE"
+#endif
+
+// 飞行记录仪（需要 C11 原子操作支持）
+// 0：不记录
+// 1：所有等级的记录都写入 FLOG_RECORDER_SIZE 字节的内存环形缓冲区，
+//    只有不低于直接输出等级（默认 FLOG_RECORDER_LIVE，可由 flogs_set_live_level 修改）的记录才调用输出函数
+//    调用 flogs_dump 或输出 FLOGF 致命日志时，经输出函数导出缓冲区中的全部记录
+//    延迟输出模式下缓冲区中为二进制记录，导出后同样由 flogs_decode 还原
+// flogs_dump 只读取缓冲区并调用输出函数，输出函数可重入时也可以在信号处理函数中调用
+#ifndef FLOG_RECORDER
+#define FLOG_RECORDER 0
+#endif
+// 飞行记录仪缓冲区大小（必须为 2 的幂，且不小于 LOG_BUFFER_MAX_SIZE）
+#ifndef FLOG_RECORDER_SIZE
+#define FLOG_RECORDER_SIZE (4096) // Bytes
+#endif
+// 默认直接输出等级
+#ifndef FLOG_RECORDER_LIVE
+#define FLOG_RECORDER_LIVE LEVEL_WARN
+#endif
+#if FLOG_RECORDER && (FLOG_RECORDER_SIZE < LOG_BUFFER_MAX_SIZE)
+#error "FLOG_RECORDER_SIZE must not be smaller than LOG_BUFFER_MAX_SIZE"
+#endif
+
+// 结构化日志编码方式
+#define FLOG_KV_JSON 1 // JSON 行
+#define FLOG_KV_TLV 2  // 二进制 TLV
+
+// 结构化（键值对）日志
+// 0：不编译 flogs_kv
+// FLOG_KV_JSON：flogs_kv 输出一行 JSON，{"lvl":"WARN","ts":1.234,"tag":"net","msg":"...","key":value,...}
+// FLOG_KV_TLV：flogs_kv 输出二进制 TLV 记录，格式见 utl_flogs.c
+// 两种编码都直接写入日志缓冲区，不分配内存；放不下的键值对被丢弃并标记截断
+#ifndef FLOG_KV
+#define FLOG_KV 0
+#endif
+
+// 日志自身统计（需要 C11 原子操作支持）
+// 0：不统计
+// 1：按等级与标签统计记录数、字节数、截断数与丢弃数，并按 2 的幂分桶统计格式化耗时与输出函数耗时
+//    计数使用 relaxed 原子操作，耗时使用 flogs_stats_init 指定的高精度计数器（如 DWT->CYCCNT）
+//    标签按指针区分，超出 FLOG_STATS_TAGS - 1 个标签后计入最后一项（标签为 "*"）
+//    输出函数耗时按调用统计，异步与批量模式下一次调用可能包含多条记录
+#ifndef FLOG_STATS
+#define FLOG_STATS 0
+#endif
+// 统计的标签数量（含最后一项）
+#ifndef FLOG_STATS_TAGS
+#define FLOG_STATS_TAGS (16)
+#endif
+// 耗时分布分桶数量，第 n 项为 [2^(n-1), 2^n) 个计数
+#define FLOG_STATS_BUCKETS (32)
+
+// 输出压缩（需要 utl_flz.c）
+// 0：不压缩
+// 1：记录先写入 FLOG_COMPRESS_BLOCK 字节的块缓冲区，写满时压缩为 flz 帧交给输出函数
+//    每帧可独立解码，接收端丢失或损坏部分数据后由 flz_unframe 从下一帧重新同步
+//    未写满的块暂存在缓冲区中，需定期调用 flogs_flush 输出；flogs_dump 导出后立即成帧
+//    同步模式下定义 FFMT_THREAD_SAFE 时每个线程的块缓冲区独立，异步模式下由输出线程独占
+//    开启后不再调用 flogs_batch_init 指定的批量输出函数，flogs_dump 也不能在信号处理函数中调用
+#ifndef FLOG_COMPRESS
+#define FLOG_COMPRESS 0
+#endif
+// 压缩块大小（不大于 FLZ_BLOCK_MAX_SIZE）
+#ifndef FLOG_COMPRESS_BLOCK
+#define FLOG_COMPRESS_BLOCK (2048) // Bytes
+#endif
+
+// 需要时钟源的功能
+#define FLOG_CLOCK (FLOG_TIMESTAMP || FLOG_RATE_LIMIT || FLOG_BATCH)
+
+// 运行时按标签过滤日志（需要 GCC 兼容编译器与链接器）
+// 0：只按 FLOG_LEVEL 在编译期过滤
+// 1：每个调用点在 flogs_site 段中登记一个静态开关，flogs_set_level 按标签修改开关
+//    关闭的调用点只有一次分支判断，不会计算参数
+// 使用自定义链接脚本时，需将 flogs_site 段放入 .data 中，并保留 __start_flogs_site / __stop_flogs_site 符号
+// 开启后日志标签必须为字符串常量
+#ifndef FLOG_RUNTIME_FILTER
+#define FLOG_RUNTIME_FILTER 0
+#endif
+// 运行时过滤的初始日志等级
+#ifndef FLOG_RUNTIME_LEVEL
+#define FLOG_RUNTIME_LEVEL FLOG_LEVEL
+#endif
+
 // 日志等级定义
 #define   LEVEL_SUCCESS  0
 #define   LEVEL_INFO  1
 #define   LEVEL_DEBUG  2
 #define   LEVEL_WARN  3
 #define   LEVEL_ERROR  4
-#define   LEVEL_NONE  5
+#define   LEVEL_FATAL  5
+#define   LEVEL_NONE  6
+
+#if FLOG_DEFERRED
+// 格式化字符串与标签驻留在 flogs_fmt 段中，记录中只保存段内偏移
+#define FLOG_EMIT(level, tag, fmt, ...)                                                             \
+    do                                                                                              \
+    {                                                                                               \
+        static const char __attribute__((section(FLOG_FMT_SECTION), aligned(1))) _flog_tag[] = tag; \
+        static const char __attribute__((section(FLOG_FMT_SECTION), aligned(1))) _flog_fmt[] = fmt; \
+        flogs_deferred(level, _flog_tag, (char *)_flog_fmt, ##__VA_ARGS__);                         \
+    } while (0)
+#else
+#define FLOG_EMIT(level, tag, ...) flogs(level, tag, __VA_ARGS__)
+#endif
+
+/// @brief 批量输出片段，内存布局与 POSIX struct iovec 相同
+typedef struct tagFLOGS_Iovec
+{
+    char *base; /* 片段起始地址 */
+    size_t len; /* 片段长度 */
+} flogs_iovec_t;
+
+/// @brief 键值对类型 枚举
+typedef enum tagFLOGS_KV_Type
+{
+    FLOGS_KV_Int = 0, /* int32_t */
+    FLOGS_KV_Uint,    /* uint32_t */
+    FLOGS_KV_Fq12,    /* fq12_t */
+    FLOGS_KV_Str,     /* 字符串 */
+} flogs_kv_type_e;
+
+/// @brief 键值对
+typedef struct tagFLOGS_KV
+{
+    const char *key; /* 键名 */
+    uint8_t type;    /* flogs_kv_type_e */
+    union
+    {
+        int32_t i;
+        uint32_t u;
+        int32_t fq;
+        const char *s;
+    } value;
+} flogs_kv_t;
+
+#define FLOGS_KV_INT(k, v) {(k), FLOGS_KV_Int, {.i = (int32_t)(v)}}
+#define FLOGS_KV_UINT(k, v) {(k), FLOGS_KV_Uint, {.u = (uint32_t)(v)}}
+#define FLOGS_KV_FQ12(k, v) {(k), FLOGS_KV_Fq12, {.fq = (int32_t)(v)}}
+#define FLOGS_KV_STR(k, v) {(k), FLOGS_KV_Str, {.s = (v)}}
+
+/// @brief 日志统计计数
+typedef struct tagFLOGS_Counter
+{
+    uint32_t records;     /* 记录数 */
+    uint32_t bytes;       /* 字节数（不含文本记录末尾的 '\0'） */
+    uint32_t truncations; /* 被截断的记录数 */
+    uint32_t drops;       /* 因缓冲区满丢弃的记录数 */
+} flogs_counter_t;
+
+/// @brief 日志统计快照
+typedef struct tagFLOGS_Stats
+{
+    flogs_counter_t level[LEVEL_NONE];            /* 按等级统计 */
+    const char *tag[FLOG_STATS_TAGS];             /* 标签，未使用的项为 NULL */
+    flogs_counter_t tag_count[FLOG_STATS_TAGS];   /* 按标签统计 */
+    uint32_t sink_calls;                          /* 输出函数调用次数 */
+    uint32_t sink_time;                           /* 输出函数累计耗时（按 32 位回绕） */
+    uint32_t format_hist[FLOG_STATS_BUCKETS];     /* 格式化耗时分布 */
+    uint32_t sink_hist[FLOG_STATS_BUCKETS];       /* 输出函数耗时分布 */
+} flogs_stats_t;
+
+/// @brief 调用点限速状态
+typedef struct tagFLOGS_Limit
+{
+    const char *tag;     /* 日志标签 */
+    uint8_t level;       /* 日志等级 */
+    uint8_t tokens;      /* 剩余令牌数 */
+    uint16_t repeated;   /* 折叠的重复记录数 */
+    uint16_t suppressed; /* 超出速率丢弃的记录数 */
+    uint32_t stamp;      /* 上次补充令牌时的时钟计数 */
+    uint32_t last;       /* 上次调用时的时钟计数 */
+    uint32_t hash;       /* 上一条记录内容的哈希值 */
+#if FLOG_RATE_LIMIT
+    uint16_t length;                 /* 上一条记录内容的长度 */
+    char text[FLOG_RATE_LIMIT_TEXT]; /* 上一条记录内容 */
+#endif
+} flogs_limit_t;
+
+#if FLOG_RATE_LIMIT
+#define FLOG_SITE_EMIT(level, tag, ...)                                                            \
+    do                                                                                             \
+    {                                                                                              \
+        static flogs_limit_t __attribute__((section("flogs_limit"), used)) _flog_limit =           \
+            {tag, level, FLOG_RATE_LIMIT_BURST, 0, 0, 0, 0, 0, 0, {0}};                            \
+        if (flogs_limit_take(&_flog_limit))                                                        \
+        {                                                                                          \
+            flogs_limited(&_flog_limit, __VA_ARGS__);                                              \
+        }                                                                                          \
+    } while (0)
+#else
+#define FLOG_SITE_EMIT(level, tag, ...) FLOG_EMIT(level, tag, __VA_ARGS__)
+#endif
+
+/// @brief 日志调用点
+typedef struct tagFLOGS_Site
+{
+    const char *tag;         /* 日志标签 */
+    uint8_t level;           /* 日志等级 */
+    volatile uint8_t enable; /* 是否输出 */
+} flogs_site_t;
+
+#if FLOG_RUNTIME_FILTER
+#define FLOG_CALL(level, tag, ...)                                                                 \
+    do                                                                                             \
+    {                                                                                              \
+        static flogs_site_t __attribute__((section("flogs_site"), used)) _flog_site =              \
+            {tag, level, (level) >= FLOG_RUNTIME_LEVEL};                                           \
+        if (_flog_site.enable)                                                                     \
+        {                                                                                          \
+            FLOG_SITE_EMIT(level, tag, __VA_ARGS__);                                               \
+        }                                                                                          \
+    } while (0)
+#else
+#define FLOG_CALL(level, tag, ...) FLOG_SITE_EMIT(level, tag, __VA_ARGS__)
+#endif
 
 #if (FLOG_LEVEL <= LEVEL_SUCCESS)
-#define FLOGS(tag, ...) flogs(LEVEL_SUCCESS, tag, __VA_ARGS__)
+#define FLOGS(tag, ...) FLOG_CALL(LEVEL_SUCCESS, tag, __VA_ARGS__)
 #else
 #define FLOGS(tag, ...)
 #endif
 
 #if (FLOG_LEVEL <= LEVEL_INFO)
-#define FLOGI(tag, ...) flogs(LEVEL_INFO, tag, __VA_ARGS__)
+#define FLOGI(tag, ...) FLOG_CALL(LEVEL_INFO, tag, __VA_ARGS__)
 #else
 #define FLOGI(tag, ...)
 #endif
 
 #if (FLOG_LEVEL <= LEVEL_DEBUG)
-#define FLOGD(tag, ...) flogs(LEVEL_DEBUG, tag, __VA_ARGS__)
+#define FLOGD(tag, ...) FLOG_CALL(LEVEL_DEBUG, tag, __VA_ARGS__)
 #else
 #define FLOGD(tag, ...)
 #endif
 
 #if (FLOG_LEVEL <= LEVEL_WARN)
-#define FLOGW(tag, ...) flogs(LEVEL_WARN, tag, __VA_ARGS__)
+#define FLOGW(tag, ...) FLOG_CALL(LEVEL_WARN, tag, __VA_ARGS__)
 #else
 #define FLOGW(tag, ...)
 #endif
 
 #if (FLOG_LEVEL <= LEVEL_ERROR)
-#define FLOGE(tag, ...) flogs(LEVEL_ERROR, tag, __VA_ARGS__)
+#define FLOGE(tag, ...) FLOG_CALL(LEVEL_ERROR, tag, __VA_ARGS__)
 #else
 #define FLOGE(tag, ...)
 #endif
 
-extern void flogs_init(void (*pfun_output)(char* buffer, uint32_t size));
+#if (FLOG_LEVEL <= LEVEL_FATAL)
+#define FLOGF(tag, ...) FLOG_CALL(LEVEL_FATAL, tag, __VA_ARGS__)
+#else
+#define FLOGF(tag, ...)
+#endif
+
+extern bool flogs_init(void (*pfun_output)(char* buffer, uint32_t size));
 extern int32_t flogs(uint8_t level, const char *tag, char *fmt, ...);
 
+#if FLOG_CLOCK
+extern void flogs_timestamp_init(uint32_t (*pfun_tick)(void), uint32_t tick_hz);
+#endif
+#if FLOG_RATE_LIMIT
+extern bool flogs_limit_take(flogs_limit_t *site);
+extern int32_t flogs_limited(flogs_limit_t *site, char *fmt, ...);
+extern uint32_t flogs_limit_poll(void);
+#endif
+#if FLOG_KV
+extern int32_t flogs_kv(uint8_t level, const char *tag, const char *msg, const flogs_kv_t *kv, uint32_t count);
+#endif
+#if FLOG_STATS
+extern void flogs_stats_init(uint32_t (*pfun_cycles)(void));
+extern void flogs_stats_snapshot(flogs_stats_t *stats);
+extern void flogs_stats_reset(void);
+#endif
+#if FLOG_RECORDER
+extern void flogs_set_live_level(uint8_t level);
+extern void flogs_dump(void);
+#endif
+#if FLOG_RUNTIME_FILTER
+extern uint32_t flogs_set_level(const char *tag, uint8_t level);
+#endif
+#if FLOG_DEFERRED
+extern int32_t flogs_deferred(uint8_t level, const char *tag, char *fmt, ...);
+#endif
+#ifdef FLOG_DECODER
+extern uint32_t flogs_decode(const uint8_t *stream, uint32_t len, const char *strtab, uint32_t strtab_len);
+#endif
+
+#if FLOG_BATCH
+extern void flogs_batch_init(void (*pfun_writev)(const flogs_iovec_t *iov, uint32_t count));
+#endif
+#if FLOG_ASYNC || FLOG_BATCH || FLOG_COMPRESS
+extern void flogs_flush(void);
+#endif
+#if FLOG_ASYNC
+extern uint32_t flogs_drain(void);
+extern uint32_t flogs_dropped(void);
+#endif
+
 #endif
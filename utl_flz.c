@@ -0,0 +1,404 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: utl_flz.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: 无内存分配的 LZ77 块压缩库
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ * 
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <string.h>
+#include "utl_flz.h"
+
+// 帧同步字
+#define FLZ_SYNC0 0xF7
+#define FLZ_SYNC1 0x5A
+// 最短匹配长度
+#define FLZ_MIN_MATCH 4
+// LZ4 块结尾规则：最后 5 字节必须为字面量，最后一个匹配至少在块结尾 12 字节之前开始
+#define FLZ_LAST_LITERALS 5
+#define FLZ_MF_LIMIT 12
+
+/// @brief 读取 4 字节（不要求对齐）
+/// @param p 地址
+/// @return 数值
+static inline uint32_t flz_read32(const uint8_t *p)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+/// @brief 读取 4 字节小端整数
+/// @param p 地址
+/// @return 数值
+static inline uint32_t flz_read32le(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/// @brief 4 字节序列哈希
+/// @param seq 序列
+/// @return 哈希表下标
+static inline uint32_t flz_hash(uint32_t seq)
+{
+	return (seq * 2654435761u) >> (32 - FLZ_HASH_BITS);
+}
+
+/// @brief 写入扩展长度（255 累加）
+/// @param op 写入位置
+/// @param length 扩展部分长度
+/// @return 写入后的位置
+static uint8_t *flz_put_length(uint8_t *op, uint32_t length)
+{
+	while (length >= 255)
+	{
+		*op++ = 255;
+		length -= 255;
+	}
+	*op++ = (uint8_t)length;
+	return op;
+}
+
+/// @brief 写入一个序列
+/// @param op 写入位置
+/// @param end 输出缓冲区结尾
+/// @param literal 字面量
+/// @param lit_len 字面量长度
+/// @param offset 匹配偏移，0 表示最后一个序列
+/// @param match_len 匹配长度
+/// @return 写入后的位置，空间不足时返回 0
+static uint8_t *flz_put_sequence(uint8_t *op, const uint8_t *end, const uint8_t *literal, uint32_t lit_len,
+								 uint32_t offset, uint32_t match_len)
+{
+	uint32_t need = 1 + lit_len + lit_len / 255 + 1 + ((offset != 0) ? 2 + match_len / 255 + 1 : 0);
+	uint8_t *token = op;
+
+	if ((uint32_t)(end - op) < need)
+	{
+		return 0;
+	}
+	*token = (uint8_t)(((lit_len >= 15) ? 15 : lit_len) << 4);
+	op++;
+	if (lit_len >= 15)
+	{
+		op = flz_put_length(op, lit_len - 15);
+	}
+	memcpy(op, literal, lit_len);
+	op += lit_len;
+	if (offset == 0)
+	{
+		return op;
+	}
+
+	*op++ = (uint8_t)offset;
+	*op++ = (uint8_t)(offset >> 8);
+	match_len -= FLZ_MIN_MATCH;
+	*token |= (uint8_t)((match_len >= 15) ? 15 : match_len);
+	if (match_len >= 15)
+	{
+		op = flz_put_length(op, match_len - 15);
+	}
+	return op;
+}
+
+/// @brief 压缩一个块
+/// @param state 压缩状态（哈希表在每个块开始时清零）
+/// @param src 原始数据
+/// @param len 原始数据长度，不超过 FLZ_BLOCK_MAX_SIZE
+/// @param dst 输出缓冲区
+/// @param max_len 输出缓冲区长度
+/// @return 压缩后长度或 flz_error_e 错误值
+extern int32_t flz_compress(flz_state_t *state, const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t max_len)
+{
+	const uint8_t *end = dst + max_len;
+	uint8_t *op = dst;
+	uint32_t anchor = 0;
+	uint32_t ip = 0;
+	uint32_t ref;
+	uint32_t seq;
+	uint32_t hash;
+	uint32_t match_len;
+
+	if ((state == 0) || (len > FLZ_BLOCK_MAX_SIZE))
+	{
+		return FLZ_Error_ArgsErr;
+	}
+
+	// 清零后未出现过的序列都指向位置 0，由内容比较排除
+	memset(state->hash, 0, sizeof(state->hash));
+	while (ip + FLZ_MF_LIMIT <= len)
+	{
+		seq = flz_read32(src + ip);
+		hash = flz_hash(seq);
+		ref = state->hash[hash];
+		state->hash[hash] = (uint16_t)ip;
+		if ((ref >= ip) || (flz_read32(src + ref) != seq))
+		{
+			ip++;
+			continue;
+		}
+
+		match_len = FLZ_MIN_MATCH;
+		while ((ip + match_len < len - FLZ_LAST_LITERALS) && (src[ref + match_len] == src[ip + match_len]))
+		{
+			match_len++;
+		}
+		op = flz_put_sequence(op, end, src + anchor, ip - anchor, ip - ref, match_len);
+		if (op == 0)
+		{
+			return FLZ_Error_Overflow;
+		}
+		ip += match_len;
+		anchor = ip;
+	}
+
+	// 剩余字面量
+	op = flz_put_sequence(op, end, src + anchor, len - anchor, 0, 0);
+	if (op == 0)
+	{
+		return FLZ_Error_Overflow;
+	}
+	return (int32_t)(op - dst);
+}
+
+/// @brief 读取扩展长度
+/// @param ip 读取位置
+/// @param end 输入结尾
+/// @param length 累加的长度
+/// @return 读取后的位置，数据不完整时返回 0
+static const uint8_t *flz_get_length(const uint8_t *ip, const uint8_t *end, uint32_t *length)
+{
+	uint8_t byte;
+
+	do
+	{
+		if (ip >= end)
+		{
+			return 0;
+		}
+		byte = *ip++;
+		*length += byte;
+	} while (byte == 255);
+	return ip;
+}
+
+/// @brief 解压一个块
+/// @param src 压缩数据
+/// @param len 压缩数据长度
+/// @param dst 输出缓冲区
+/// @param max_len 输出缓冲区长度
+/// @return 原始数据长度或 flz_error_e 错误值
+extern int32_t flz_decompress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t max_len)
+{
+	const uint8_t *ip = src;
+	const uint8_t *end = src + len;
+	uint8_t *op = dst;
+	uint8_t token;
+	uint32_t length;
+	uint32_t offset;
+
+	while (ip < end)
+	{
+		token = *ip++;
+
+		// 字面量
+		length = token >> 4;
+		if ((length == 15) && ((ip = flz_get_length(ip, end, &length)) == 0))
+		{
+			return FLZ_Error_Corrupt;
+		}
+		if ((length > (uint32_t)(end - ip)) || (length > max_len - (uint32_t)(op - dst)))
+		{
+			return (length > (uint32_t)(end - ip)) ? FLZ_Error_Corrupt : FLZ_Error_Overflow;
+		}
+		memcpy(op, ip, length);
+		ip += length;
+		op += length;
+		if (ip == end)
+		{
+			break;
+		}
+
+		// 匹配
+		if (end - ip < 2)
+		{
+			return FLZ_Error_Corrupt;
+		}
+		offset = (uint32_t)ip[0] | ((uint32_t)ip[1] << 8);
+		ip += 2;
+		length = token & 0x0F;
+		if ((length == 15) && ((ip = flz_get_length(ip, end, &length)) == 0))
+		{
+			return FLZ_Error_Corrupt;
+		}
+		length += FLZ_MIN_MATCH;
+		if ((offset == 0) || (offset > (uint32_t)(op - dst)))
+		{
+			return FLZ_Error_Corrupt;
+		}
+		if (length > max_len - (uint32_t)(op - dst))
+		{
+			return FLZ_Error_Overflow;
+		}
+		// 匹配可能与输出重叠，逐字节复制
+		while (length--)
+		{
+			*op = *(op - offset);
+			op++;
+		}
+	}
+	return (int32_t)(op - dst);
+}
+
+/// @brief 原始数据校验（FNV-1a）
+/// @param data 数据
+/// @param len 数据长度
+/// @return 校验值
+static uint32_t flz_check(const uint8_t *data, uint32_t len)
+{
+	uint32_t hash = 2166136261u;
+
+	while (len--)
+	{
+		hash = (hash ^ *data++) * 16777619u;
+	}
+	return hash;
+}
+
+/// @brief 帧头校验和
+/// @param head 帧头
+/// @return 校验和
+static uint8_t flz_head_sum(const uint8_t *head)
+{
+	uint8_t sum = 0;
+
+	for (uint32_t i = 0; i < FLZ_FRAME_HEAD - 1; i++)
+	{
+		sum += head[i];
+	}
+	return sum;
+}
+
+/// @brief 压缩一个块并成帧，压缩后不变小时原样存储
+/// @param state 压缩状态
+/// @param src 原始数据
+/// @param len 原始数据长度，不超过 FLZ_BLOCK_MAX_SIZE
+/// @param dst 输出缓冲区，长度至少为 FLZ_FRAME_BOUND(len)
+/// @param max_len 输出缓冲区长度
+/// @return 帧长度或 flz_error_e 错误值
+extern int32_t flz_frame(flz_state_t *state, const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t max_len)
+{
+	int32_t length;
+	uint32_t check;
+
+	if (len > FLZ_BLOCK_MAX_SIZE)
+	{
+		return FLZ_Error_ArgsErr;
+	}
+	if (max_len < FLZ_FRAME_BOUND(len))
+	{
+		return FLZ_Error_Overflow;
+	}
+
+	length = flz_compress(state, src, len, dst + FLZ_FRAME_HEAD, len);
+	dst[2] = 1;
+	if ((length < 0) || ((uint32_t)length >= len))
+	{
+		memcpy(dst + FLZ_FRAME_HEAD, src, len);
+		length = (int32_t)len;
+		dst[2] = 0;
+	}
+
+	dst[0] = FLZ_SYNC0;
+	dst[1] = FLZ_SYNC1;
+	dst[3] = (uint8_t)len;
+	dst[4] = (uint8_t)(len >> 8);
+	dst[5] = (uint8_t)length;
+	dst[6] = (uint8_t)(length >> 8);
+	dst[7] = flz_head_sum(dst);
+	check = flz_check(src, len);
+	for (uint32_t i = 0; i < FLZ_FRAME_TAIL; i++)
+	{
+		dst[FLZ_FRAME_HEAD + length + i] = (uint8_t)(check >> (i * 8));
+	}
+	return length + FLZ_FRAME_HEAD + FLZ_FRAME_TAIL;
+}
+
+/// @brief 从数据流中解码下一个有效帧
+/// @param stream 数据流
+/// @param len 数据流长度
+/// @param dst 输出缓冲区，长度应不小于编码端的块长度
+/// @param max_len 输出缓冲区长度
+/// @param used 输出已处理的字节数，下次从 stream + used 继续
+/// @return 原始数据长度，或 FLZ_Error_Incomplete（需要更多数据，used 之前的字节可以丢弃）
+extern int32_t flz_unframe(const uint8_t *stream, uint32_t len, uint8_t *dst, uint32_t max_len, uint32_t *used)
+{
+	const uint8_t *p;
+	uint32_t pos;
+	uint32_t raw;
+	uint32_t length;
+	int32_t ret;
+
+	for (pos = 0; pos + FLZ_FRAME_HEAD <= len; pos++)
+	{
+		p = stream + pos;
+		if ((p[0] != FLZ_SYNC0) || (p[1] != FLZ_SYNC1) || (p[2] > 1) || (p[7] != flz_head_sum(p)))
+		{
+			continue;
+		}
+		raw = (uint32_t)p[3] | ((uint32_t)p[4] << 8);
+		length = (uint32_t)p[5] | ((uint32_t)p[6] << 8);
+		// 只有压缩后变小才会使用压缩帧
+		if ((raw > max_len) || ((p[2] == 0) ? (length != raw) : (length >= raw)))
+		{
+			continue;
+		}
+		if (len - pos < FLZ_FRAME_HEAD + length + FLZ_FRAME_TAIL)
+		{
+			*used = pos;
+			return FLZ_Error_Incomplete;
+		}
+
+		if (p[2] == 0)
+		{
+			memcpy(dst, p + FLZ_FRAME_HEAD, raw);
+			ret = (int32_t)raw;
+		}
+		else
+		{
+			ret = flz_decompress(p + FLZ_FRAME_HEAD, length, dst, max_len);
+		}
+		// 解码失败或校验不通过时从下一个字节重新同步
+		if ((ret != (int32_t)raw) || (flz_check(dst, raw) != flz_read32le(p + FLZ_FRAME_HEAD + length)))
+		{
+			continue;
+		}
+		*used = pos + FLZ_FRAME_HEAD + length + FLZ_FRAME_TAIL;
+		return ret;
+	}
+	*used = pos;
+	return FLZ_Error_Incomplete;
+}
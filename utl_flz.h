@@ -0,0 +1,88 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: utl_flz.h
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: 无内存分配的 LZ77 块压缩库
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ * 
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+ /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+  * FLZ 说明：
+  *
+  * flz 是不分配内存的 LZ77 块压缩库，块格式与 LZ4 块相同：
+  * [令牌] [扩展字面量长度] [字面量] [2 字节偏移] [扩展匹配长度] ...
+  * 令牌高 4 位为字面量长度，低 4 位为匹配长度 - 4，为 15 时后续字节继续累加（遇到非 255 结束）
+  * 最后一个序列只有字面量
+  * 遵守 LZ4 块结尾规则：最后 5 字节始终为字面量，最后一个匹配在块结尾 12 字节之前开始，
+  * 因此输出可直接由 LZ4 解压（LZ4_decompress_safe）
+  *
+  * 每个块独立压缩（窗口为块本身，不超过 64KB），哈希表由调用者提供并在每个块开始时清零，可重入
+  *
+  * 帧格式（小端）：
+  * [0..1] 同步字 F7 5A [2] 标志（1：压缩，0：原样存储） [3..4] 原始长度 [5..6] 数据长度
+  * [7] 帧头校验和（前 7 字节之和） [8..] 数据 [末尾 4 字节] 原始数据 FNV-1a 校验
+  *
+  * 数据丢失或损坏时，flz_unframe 跳过无效字节，从下一个通过校验的帧继续解码
+  *
+  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef __UTL_FLZ_H__
+#define __UTL_FLZ_H__
+
+#include <stdint.h>
+
+// 哈希表位数，哈希表占用 2^FLZ_HASH_BITS * 2 字节
+#define FLZ_HASH_BITS (10)
+// 块最大长度
+#define FLZ_BLOCK_MAX_SIZE (0xFFFF) // Bytes
+// 帧头长度
+#define FLZ_FRAME_HEAD (8) // Bytes
+// 帧尾长度
+#define FLZ_FRAME_TAIL (4) // Bytes
+// 长度为 n 的块成帧后的最大长度（无法压缩时原样存储）
+#define FLZ_FRAME_BOUND(n) ((n) + FLZ_FRAME_HEAD + FLZ_FRAME_TAIL)
+
+/// @brief flz 错误类型 枚举
+typedef enum tagFLZ_Error
+{
+	FLZ_Error_Overflow = -1,   /* 输出缓冲区不足 */
+	FLZ_Error_Corrupt = -2,	   /* 数据损坏 */
+	FLZ_Error_Incomplete = -3, /* 没有完整的帧 */
+	FLZ_Error_ArgsErr = -4,	   /* 参数错误 */
+} flz_error_e;
+
+/// @brief flz 压缩状态
+typedef struct tagFLZ_State
+{
+	uint16_t hash[1 << FLZ_HASH_BITS]; /* 4 字节序列哈希 => 块内位置 */
+} flz_state_t;
+
+extern int32_t flz_compress(flz_state_t *state, const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t max_len);
+extern int32_t flz_decompress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t max_len);
+extern int32_t flz_frame(flz_state_t *state, const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t max_len);
+extern int32_t flz_unframe(const uint8_t *stream, uint32_t len, uint8_t *dst, uint32_t max_len, uint32_t *used);
+
+#endif
@@ -34,43 +34,18 @@
  * 
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
  
+#include <string.h>
 #include "utl_fnmea.h"
+#include "utl_fscan.h"
 
-#define INDEX_BUFFER(buf) (buf[nmea_buffer_cnt])
-#define MOVE_TO_NEXT() {if(nmea_buffer_cnt<=FNMEA_BUFFER_MAX_SIZE)nmea_buffer_cnt++;else{return FNMEA_Error_Overflow;}}
-#define CHECK_RETURN(expr) {ret=expr;if(ret!=FNMEA_Error_None){return ret;}}
-#define MOVE_TO_HEAD() (nmea_buffer_cnt=0) 
-#define MOVE_TO_NEXT_PARAM(buf) {while(INDEX_BUFFER(buf)!=','){MOVE_TO_NEXT();}MOVE_TO_NEXT();}
-
-typedef enum tagFNMEA_CMD_Type
-{
-	FNMEA_CMD_GGA,
-	FNMEA_CMD_GSA,
-	FNMEA_CMD_GSV,
-	FNMEA_CMD_RMC,
-	FNMEA_CMD_VTG,
-	FNMEA_CMD_GLL
-} FNMEA_CMD_Type;
-
-typedef enum tagFNMEA_Error_Type
-{
-	FNMEA_Error_None,
-	FNMEA_Error_Overflow,
-	FNMEA_Error_Parse_uint8,
-	FNMEA_Error_Parse_uint16,
-	FNMEA_Error_Parse_int32,
-	FNMEA_Error_Parse_type,
-	FNMEA_Error_Parse_CMD_type,
-	FNMEA_Error_Parse_Fix_Char
-
-} FNMEA_Error_Type;
-
-static FNMEA_CMD_Type nmea_cmd_type;
-
-static fnmea_t fnema;
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-/// @brief NMEA Buffer 计数
-uint32_t nmea_buffer_cnt = 0;
+#define INDEX_BUFFER() ((ctx->cursor < ctx->size) ? ctx->buffer[ctx->cursor] : '\0')
+#define MOVE_TO_NEXT() {if(ctx->cursor<ctx->size)ctx->cursor++;else{return FNMEA_Error_Overflow;}}
+#define CHECK_RETURN(expr) {ret=expr;if(ret!=FNMEA_Error_None){return ret;}}
+#define MOVE_TO_HEAD() (ctx->cursor=0)
 
 /// @brief 快速模 10 函数
 /// @param x 输入
@@ -126,342 +101,1455 @@ static void div_mod_100(uint32_t x, uint32_t* div, uint32_t* rem)
 	}
 }
 
-/// 
-static FNMEA_Error_Type fnmea_parse_uint8(char* pbuffer, uint8_t* pNum)
+/// @brief 解析固定字符
+/// @param ctx 解析上下文
+/// @param fix 期望的字符
+/// @return 错误类型
+static FNMEA_Error_Type fnmea_parse_fix_char(fnmea_ctx_t *ctx, char fix)
 {
-	uint8_t num = 0;
-	while (INDEX_BUFFER(pbuffer) != ',' && INDEX_BUFFER(pbuffer) != '.' && INDEX_BUFFER(pbuffer) != '\0')
+	if (INDEX_BUFFER() == fix)
 	{
-		if (!(INDEX_BUFFER(pbuffer) >= '0' && INDEX_BUFFER(pbuffer) <= '9'))
-		{
-			return FNMEA_Error_Parse_uint8;
-		}
-		num = num * 10 + (INDEX_BUFFER(pbuffer) - '0');
 		MOVE_TO_NEXT();
+		return FNMEA_Error_None;
+	}
+	else
+	{
+		return FNMEA_Error_Parse_Fix_Char;
 	}
-	*pNum = num;
-	return FNMEA_Error_None;
 }
 
-/// 
-static FNMEA_Error_Type fnmea_parse_uint16(char* pbuffer, uint16_t* pNum)
+// 流式解析状态
+typedef enum tagFNMEA_State
+{
+	FNMEA_STATE_Idle,	 // 等待 '$'
+	FNMEA_STATE_Address, // 地址字段（讲话者 + 语句标识）
+	FNMEA_STATE_Field,	 // 数据字段
+	FNMEA_STATE_Check_H, // 校验和高 4 位
+	FNMEA_STATE_Check_L, // 校验和低 4 位
+	FNMEA_STATE_End,	 // 等待 "\r\n"
+} FNMEA_State;
+
+// 按字符打包地址字段
+#define FNMEA_TALKER(c0, c1) (((uint16_t)(c0) << 8) | (uint16_t)(c1))
+#define FNMEA_ADDRESS(c0, c1, c2) (((uint32_t)(c0) << 16) | ((uint32_t)(c1) << 8) | (uint32_t)(c2))
+// 打包后地址字段的乘法散列，取高 bits 位
+#define FNMEA_HASH(key, bits) ((uint32_t)(((uint64_t)(key) * 0x9E3779B97F4A7C15ULL) >> (64 - (bits))))
+
+#if (1 << FNMEA_HANDLER_BITS) <= FNMEA_HANDLER_MAX
+#error "FNMEA_HANDLER_BITS too small for FNMEA_HANDLER_MAX"
+#endif
+
+/// @brief 10 的幂
+static const uint32_t fnmea_pow10[10] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+/// @brief 将字段的小数部分换算为指定位数（截断）
+/// @param field 字段
+/// @param digits 位数
+/// @return 小数部分
+static uint32_t fnmea_field_frac(const fnmea_field_t *field, uint8_t digits)
 {
-	uint16_t num = 0;
-	while (INDEX_BUFFER(pbuffer) != ',' && INDEX_BUFFER(pbuffer) != '.' && INDEX_BUFFER(pbuffer) != '\0')
+	if (field->frac_digits >= digits)
 	{
-		if (!(INDEX_BUFFER(pbuffer) >= '0' && INDEX_BUFFER(pbuffer) <= '9'))
-		{
-			return FNMEA_Error_Parse_uint16;
-		}
-		num = num * 10 + (INDEX_BUFFER(pbuffer) - '0');
-		MOVE_TO_NEXT();
+		return field->frac / fnmea_pow10[field->frac_digits - digits];
 	}
-	*pNum = num;
-	return FNMEA_Error_None;
+	return field->frac * fnmea_pow10[digits - field->frac_digits];
 }
 
-/// 
-static FNMEA_Error_Type fnmea_parse_int32(char* pbuffer, int32_t* pNum)
+/// @brief 解码数值字段
+/// @param field 字段
+/// @param max 整数部分允许的最大值
+/// @return 是否为有效数值
+static bool fnmea_field_number(const fnmea_field_t *field, uint32_t max)
 {
-	int32_t num = 0;
-	int8_t sign = 1;
-	while (INDEX_BUFFER(pbuffer) != ',' && INDEX_BUFFER(pbuffer) != '.' && INDEX_BUFFER(pbuffer) != '\0')
+	return ((field->flags & (FNMEA_FIELD_NEGATIVE | FNMEA_FIELD_INVALID)) == 0) && (field->integer <= max);
+}
+
+/// @brief 解码 Q12 定点数字段
+/// @param field 字段
+/// @param num 解码结果
+/// @return 错误类型
+static FNMEA_Error_Type fnmea_field_fq12(const fnmea_field_t *field, int32_t *num)
+{
+	int32_t value;
+
+	if (field->length == 0)
 	{
-		if (!((INDEX_BUFFER(pbuffer) == '-') || (INDEX_BUFFER(pbuffer) >= '0' && INDEX_BUFFER(pbuffer) <= '9')))
-		{
-			return FNMEA_Error_Parse_int32;
-		}
-		if (INDEX_BUFFER(pbuffer) == '-')
-		{
-			sign = -1;
-			MOVE_TO_NEXT();
-			continue;
-		}
-		num = num * 10 + (INDEX_BUFFER(pbuffer) - '0');
-		MOVE_TO_NEXT();
+		*num = 0;
+		return FNMEA_Error_None;
 	}
-	num *= sign;
-	*pNum = num;
+	if (((field->flags & FNMEA_FIELD_INVALID) != 0) || (field->integer > (INT32_MAX >> 12)))
+	{
+		return FNMEA_Error_Parse_int32;
+	}
+	value = (int32_t)((field->integer << 12) + (uint32_t)(((uint64_t)field->frac << 12) / fnmea_pow10[field->frac_digits]));
+	*num = ((field->flags & FNMEA_FIELD_NEGATIVE) != 0) ? -value : value;
 	return FNMEA_Error_None;
 }
 
-/// 
-static FNMEA_Error_Type fnmea_parse_type(char* pbuffer, fnmea_type_e* type)
+/// @brief 解码精度因子字段（单位 0.1，超出范围时为 255，为空时为 0）
+/// @param field 字段
+/// @param dop 解码结果
+/// @return 错误类型
+static FNMEA_Error_Type fnmea_field_dop(const fnmea_field_t *field, uint8_t *dop)
 {
-	// 第一个字符
-	switch (INDEX_BUFFER(pbuffer))
+	if (field->length == 0)
 	{
-		MOVE_TO_NEXT();
-	case 'G':
-		goto parse_nmea_type_stage_1g;
-	case 'B':
-		goto parse_nmea_type_stage_1b;
-	default:
-		return FNMEA_Error_Parse_type;
+		*dop = 0;
+		return FNMEA_Error_None;
 	}
-	// 第二个字符
-parse_nmea_type_stage_1g:
-	switch (INDEX_BUFFER(pbuffer))
+	if (!fnmea_field_number(field, UINT16_MAX))
 	{
-		MOVE_TO_NEXT();
-	case 'P':
-		*type = FNMEA_TYPE_GP;
-		return FNMEA_Error_None;
-	case 'L':
-		*type = FNMEA_TYPE_GL;
-		return FNMEA_Error_None;
-	case 'N':
-		*type = FNMEA_TYPE_GN;
+		return FNMEA_Error_Parse_uint8;
+	}
+	uint32_t value = field->integer * 10 + fnmea_field_frac(field, 1);
+	*dop = (value > UINT8_MAX) ? UINT8_MAX : (uint8_t)value;
+	return FNMEA_Error_None;
+}
+
+/// @brief 解码 UTC 时间字段 hhmmss.sss
+/// @param field 字段
+/// @param time 解码结果
+/// @return 错误类型
+static FNMEA_Error_Type fnmea_field_time(const fnmea_field_t *field, fnmea_utc_time_t *time)
+{
+	uint32_t div;
+	uint32_t rem;
+
+	if (field->length == 0)
+	{
+		*time = (fnmea_utc_time_t){0};
 		return FNMEA_Error_None;
-	default:
-		return FNMEA_Error_Parse_type;
 	}
-parse_nmea_type_stage_1b:
-	if (INDEX_BUFFER(pbuffer) == 'D')
+	if (!fnmea_field_number(field, 235960))
 	{
-		MOVE_TO_NEXT();
-		*type = FNMEA_TYPE_BD;
+		return FNMEA_Error_Parse_int32;
+	}
+	div_mod_100(field->integer, &div, &rem);
+	time->sec = (uint8_t)rem;
+	div_mod_100(div, &div, &rem);
+	if ((rem > 59) || (time->sec > 60))
+	{
+		return FNMEA_Error_Parse_int32;
+	}
+	time->min = (uint8_t)rem;
+	time->hour = (uint8_t)div;
+	time->msec = (uint16_t)fnmea_field_frac(field, 3);
+	return FNMEA_Error_None;
+}
+
+/// @brief 解码 UTC 日期字段 ddmmyy
+/// @param field 字段
+/// @param date 解码结果
+/// @return 错误类型
+static FNMEA_Error_Type fnmea_field_date(const fnmea_field_t *field, fnmea_utc_date_t *date)
+{
+	uint32_t div;
+	uint32_t rem;
+
+	if (field->length == 0)
+	{
+		*date = (fnmea_utc_date_t){0};
 		return FNMEA_Error_None;
 	}
-	else
+	if (!fnmea_field_number(field, 311299) || (field->frac_digits != 0))
 	{
-		MOVE_TO_NEXT();
-		return FNMEA_Error_Parse_type;
+		return FNMEA_Error_Parse_int32;
 	}
+	div_mod_100(field->integer, &div, &rem);
+	// 两位年份，GPS 时间从 1980 年开始
+	date->year = (uint16_t)((rem < 80) ? (2000 + rem) : (1900 + rem));
+	div_mod_100(div, &div, &rem);
+	date->mon = (uint8_t)rem;
+	date->day = (uint8_t)div;
+	return FNMEA_Error_None;
 }
 
-/// 
-static FNMEA_Error_Type fnmea_parse_cmd_type(char* pbuffer, FNMEA_CMD_Type* cmd)
+/// @brief 解码经纬度字段 (d)ddmm.mmmm
+/// @param field 字段
+/// @param degree 解码结果
+/// @param max 度数最大值
+/// @return 错误类型
+static FNMEA_Error_Type fnmea_field_degree(const fnmea_field_t *field, fnmea_degree_t *degree, uint32_t max)
 {
-	// 第一个字符
-	switch (INDEX_BUFFER(pbuffer))
+	uint32_t div;
+	uint32_t rem;
+
+	if (field->length == 0)
 	{
-		MOVE_TO_NEXT();
-	case 'G':
-		goto parse_nmea_cmd_type_stage_1g;
-	case 'R':
-		goto parse_nmea_cmd_type_stage_1r;
-	case 'V':
-		goto parse_nmea_cmd_type_stage_1v;
-	default:
-		return FNMEA_Error_Parse_CMD_type;
+		*degree = (fnmea_degree_t){0};
+		return FNMEA_Error_None;
 	}
-	// 第二个字符
-parse_nmea_cmd_type_stage_1g:
-	switch (INDEX_BUFFER(pbuffer))
+	if (!fnmea_field_number(field, max * 100 + 59))
 	{
-		MOVE_TO_NEXT();
-	case 'G':
-		goto parse_nmea_cmd_type_stage_1g2g;
-	case 'L':
-		goto parse_nmea_cmd_type_stage_1g2l;
-	case 'S':
-		goto parse_nmea_cmd_type_stage_1g2s;
-	default:
-		return FNMEA_Error_Parse_CMD_type;
+		return FNMEA_Error_Parse_uint16;
 	}
-parse_nmea_cmd_type_stage_1r:
-	switch (INDEX_BUFFER(pbuffer))
+	div_mod_100(field->integer, &div, &rem);
+	if (rem > 59)
 	{
-		MOVE_TO_NEXT();
-	case 'M':
-		goto parse_nmea_cmd_type_stage_1r2m;
-	default:
-		return FNMEA_Error_Parse_CMD_type;
+		return FNMEA_Error_Parse_uint16;
 	}
-parse_nmea_cmd_type_stage_1v:
-	switch (INDEX_BUFFER(pbuffer))
+	degree->deg = (uint8_t)div;
+	degree->min = (uint8_t)rem;
+	degree->min_dec = (uint16_t)fnmea_field_frac(field, 4);
+	return FNMEA_Error_None;
+}
+
+/// @brief 解码位置字段组：纬度、N/S、经度、E/W
+/// @param field 字段
+/// @param locate 解码结果
+/// @param index 字段在组内的序号
+/// @return 错误类型
+static FNMEA_Error_Type fnmea_field_location(const fnmea_field_t *field, fnmea_location_t *locate, uint8_t index)
+{
+	switch (index)
 	{
-		MOVE_TO_NEXT();
-	case 'T':
-		goto parse_nmea_cmd_type_stage_1v2t;
+	case 0:
+		return fnmea_field_degree(field, &locate->lati, 90);
+	case 1:
+		if (field->length == 0)
+		{
+			locate->lati.sign = 0;
+			return FNMEA_Error_None;
+		}
+		if ((field->head != 'N') && (field->head != 'S'))
+		{
+			return FNMEA_Error_Parse_Fix_Char;
+		}
+		locate->lati.sign = (field->head == 'N') ? 1 : 0;
+		return FNMEA_Error_None;
+	case 2:
+		return fnmea_field_degree(field, &locate->longi, 180);
 	default:
-		return FNMEA_Error_Parse_CMD_type;
+		if (field->length == 0)
+		{
+			locate->longi.sign = 0;
+			return FNMEA_Error_None;
+		}
+		if ((field->head != 'E') && (field->head != 'W'))
+		{
+			return FNMEA_Error_Parse_Fix_Char;
+		}
+		locate->longi.sign = (field->head == 'W') ? 1 : 0;
+		return FNMEA_Error_None;
 	}
-	// 第三个字符
-parse_nmea_cmd_type_stage_1g2g:
-	switch (INDEX_BUFFER(pbuffer))
+}
+
+/// @brief 解码定位模式字段（A/D/E/N，NMEA 4.1 起还有 F/R/M/S）
+/// @param field 字段
+/// @param status 解码结果
+/// @return 错误类型
+/// @note 模式字段为空时以语句的状态字段为准，不修改记录
+static FNMEA_Error_Type fnmea_field_mode(const fnmea_field_t *field, fnmea_status_e *status)
+{
+	switch (field->head)
 	{
-		MOVE_TO_NEXT();
+	case '\0':
+		break;
 	case 'A':
-		nmea_cmd_type = FNMEA_CMD_GGA;
-		return FNMEA_Error_None;
+		*status = FNMEA_STAT_Autonomous;
+		break;
+	case 'D':
+	case 'F':
+	case 'R':
+		*status = FNMEA_STAT_Differential;
+		break;
+	case 'E':
+		*status = FNMEA_STAT_Estimation;
+		break;
+	case 'N':
+	case 'M':
+	case 'S':
+		*status = FNMEA_STAT_Invalid;
+		break;
 	default:
-		return FNMEA_Error_Parse_CMD_type;
+		return FNMEA_Error_Parse_Fix_Char;
 	}
-parse_nmea_cmd_type_stage_1g2l:
-	switch (INDEX_BUFFER(pbuffer))
+	return FNMEA_Error_None;
+}
+
+/// @brief 流式解码 GGA 字段
+/// @param field 字段
+/// @param nmea 解析中的记录
+/// @param index 字段序号
+/// @return 错误类型
+static FNMEA_Error_Type fnmea_stream_gga(const fnmea_field_t *field, fnmea_t *nmea, uint8_t index)
+{
+	// 定位质量 => 定位状态
+	static const uint8_t quality_status[] = {
+		FNMEA_STAT_Invalid, FNMEA_STAT_Autonomous, FNMEA_STAT_Differential, FNMEA_STAT_Differential,
+		FNMEA_STAT_Differential, FNMEA_STAT_Differential, FNMEA_STAT_Estimation, FNMEA_STAT_Invalid,
+		FNMEA_STAT_Invalid};
+
+	switch (index)
 	{
-		MOVE_TO_NEXT();
-	case 'L':
-		nmea_cmd_type = FNMEA_CMD_GLL;
+	case 1:
+		return fnmea_field_time(field, &nmea->utc_time);
+	case 2:
+	case 3:
+	case 4:
+	case 5:
+		return fnmea_field_location(field, &nmea->locate, index - 2);
+	case 6:
+		if (field->length == 0)
+		{
+			nmea->staus = FNMEA_STAT_Invalid;
+			return FNMEA_Error_None;
+		}
+		if (!fnmea_field_number(field, sizeof(quality_status) - 1))
+		{
+			return FNMEA_Error_Parse_uint8;
+		}
+		nmea->staus = (fnmea_status_e)quality_status[field->integer];
 		return FNMEA_Error_None;
+	case 7:
+		if (field->length == 0)
+		{
+			nmea->precision.satellite_num = 0;
+			return FNMEA_Error_None;
+		}
+		if (!fnmea_field_number(field, UINT8_MAX))
+		{
+			return FNMEA_Error_Parse_uint8;
+		}
+		nmea->precision.satellite_num = (uint8_t)field->integer;
+		return FNMEA_Error_None;
+	case 8:
+		return fnmea_field_dop(field, &nmea->precision.hdop);
+	case 9:
+		return fnmea_field_fq12(field, &nmea->locate.alti);
 	default:
-		return FNMEA_Error_Parse_CMD_type;
+		return FNMEA_Error_None;
 	}
-parse_nmea_cmd_type_stage_1g2s:
-	switch (INDEX_BUFFER(pbuffer))
+}
+
+/// @brief 流式解码 GSA 字段
+/// @param field 字段
+/// @param nmea 解析中的记录
+/// @param index 字段序号
+/// @return 错误类型
+static FNMEA_Error_Type fnmea_stream_gsa(const fnmea_field_t *field, fnmea_t *nmea, uint8_t index)
+{
+	switch (index)
 	{
-		MOVE_TO_NEXT();
-	case 'A':
-		nmea_cmd_type = FNMEA_CMD_GSA;
+	case 15:
+		return fnmea_field_dop(field, &nmea->precision.pdop);
+	case 16:
+		return fnmea_field_dop(field, &nmea->precision.hdop);
+	case 17:
+		return fnmea_field_dop(field, &nmea->precision.vdpop);
+	default:
 		return FNMEA_Error_None;
-	case 'V':
-		nmea_cmd_type = FNMEA_CMD_GSV;
+	}
+}
+
+/// @brief 流式解码 GSV 字段（卫星详情不写入记录，只校验语句）
+/// @param field 字段
+/// @param nmea 解析中的记录
+/// @param index 字段序号
+/// @return 错误类型
+static FNMEA_Error_Type fnmea_stream_gsv(const fnmea_field_t *field, fnmea_t *nmea, uint8_t index)
+{
+	(void)field;
+	(void)nmea;
+	(void)index;
+	return FNMEA_Error_None;
+}
+
+/// @brief 流式解码 RMC 字段
+/// @param field 字段
+/// @param nmea 解析中的记录
+/// @param index 字段序号
+/// @return 错误类型
+static FNMEA_Error_Type fnmea_stream_rmc(const fnmea_field_t *field, fnmea_t *nmea, uint8_t index)
+{
+	FNMEA_Error_Type ret;
+
+	switch (index)
+	{
+	case 1:
+		return fnmea_field_time(field, &nmea->utc_time);
+	case 2:
+		// NMEA 2.3 之前没有模式字段，有效时按自主定位处理
+		nmea->staus = (field->head == 'A') ? FNMEA_STAT_Autonomous : FNMEA_STAT_Invalid;
 		return FNMEA_Error_None;
+	case 3:
+	case 4:
+	case 5:
+	case 6:
+		return fnmea_field_location(field, &nmea->locate, index - 3);
+	case 7:
+		ret = fnmea_field_fq12(field, &nmea->speed.speed_sog);
+		// 1 节 = 1.852 千米每小时
+		nmea->speed.speed_kph = (int32_t)(((int64_t)nmea->speed.speed_sog * 1852) / 1000);
+		return ret;
+	case 8:
+		return fnmea_field_fq12(field, &nmea->angle.true_north);
+	case 9:
+		return fnmea_field_date(field, &nmea->utc_date);
+	case 12:
+		return fnmea_field_mode(field, &nmea->staus);
 	default:
-		return FNMEA_Error_Parse_CMD_type;
+		return FNMEA_Error_None;
 	}
-parse_nmea_cmd_type_stage_1r2m:
-	switch (INDEX_BUFFER(pbuffer))
+}
+
+/// @brief 流式解码 VTG 字段
+/// @param field 字段
+/// @param nmea 解析中的记录
+/// @param index 字段序号
+/// @return 错误类型
+static FNMEA_Error_Type fnmea_stream_vtg(const fnmea_field_t *field, fnmea_t *nmea, uint8_t index)
+{
+	switch (index)
 	{
-		MOVE_TO_NEXT();
-	case 'C':
-		nmea_cmd_type = FNMEA_CMD_RMC;
-		return FNMEA_Error_None;
+	case 1:
+		return fnmea_field_fq12(field, &nmea->angle.true_north);
+	case 3:
+		return fnmea_field_fq12(field, &nmea->angle.magnetic_north);
+	case 5:
+		return fnmea_field_fq12(field, &nmea->speed.speed_sog);
+	case 7:
+		return fnmea_field_fq12(field, &nmea->speed.speed_kph);
+	case 9:
+		return fnmea_field_mode(field, &nmea->staus);
 	default:
-		return FNMEA_Error_Parse_CMD_type;
+		return FNMEA_Error_None;
 	}
-parse_nmea_cmd_type_stage_1v2t:
-	switch (INDEX_BUFFER(pbuffer))
+}
+
+/// @brief 流式解码 GLL 字段
+/// @param field 字段
+/// @param nmea 解析中的记录
+/// @param index 字段序号
+/// @return 错误类型
+static FNMEA_Error_Type fnmea_stream_gll(const fnmea_field_t *field, fnmea_t *nmea, uint8_t index)
+{
+	switch (index)
 	{
-		MOVE_TO_NEXT();
-	case 'G':
-		nmea_cmd_type = FNMEA_CMD_VTG;
+	case 1:
+	case 2:
+	case 3:
+	case 4:
+		return fnmea_field_location(field, &nmea->locate, index - 1);
+	case 5:
+		return fnmea_field_time(field, &nmea->utc_time);
+	case 6:
+		nmea->staus = (field->head == 'A') ? FNMEA_STAT_Autonomous : FNMEA_STAT_Invalid;
 		return FNMEA_Error_None;
+	case 7:
+		return fnmea_field_mode(field, &nmea->staus);
 	default:
-		return FNMEA_Error_Parse_CMD_type;
+		return FNMEA_Error_None;
 	}
 }
 
-static FNMEA_Error_Type fnmea_parse_fix_char(char* pbuffer, char fix)
+/// @brief 内置语句
+typedef struct tagFNMEA_Command
+{
+	uint32_t mask; // 用到的字段（第 n 位对应第 n 个字段）
+	FNMEA_Error_Type (*decode)(const fnmea_field_t *field, fnmea_t *nmea, uint8_t index); // 字段解码函数
+} fnmea_command_t;
+
+/// @brief 各内置语句，按 FNMEA_CMD_Type 排列
+static const fnmea_command_t fnmea_command[] = {
+	{0x000003FE, fnmea_stream_gga},											// GGA：1 ~ 9
+	{(1U << 15) | (1U << 16) | (1U << 17), fnmea_stream_gsa},				// GSA：15 ~ 17
+	{0x00000000, fnmea_stream_gsv},											// GSV：无
+	{0x000013FE, fnmea_stream_rmc},											// RMC：1 ~ 9、12
+	{(1U << 1) | (1U << 3) | (1U << 5) | (1U << 7) | (1U << 9), fnmea_stream_vtg}, // VTG：1、3、5、7、9
+	{0x000000FE, fnmea_stream_gll},											// GLL：1 ~ 7
+};
+
+/// @brief 散列表项
+typedef struct tagFNMEA_Slot
 {
-	if (INDEX_BUFFER(pbuffer) == fix)
+	uint32_t key; // 打包后的讲话者或语句标识，0 为空位
+	uint8_t value; // fnmea_type_e 或 FNMEA_CMD_Type
+} fnmea_slot_t;
+
+// 内置散列表大小为 2^n，新增条目时出现 "initialized field overwritten" 警告说明散列冲突，需增大 n
+#define FNMEA_SLOT_BITS 5
+#define FNMEA_SLOT(key) FNMEA_HASH(key, FNMEA_SLOT_BITS)
+
+/// @brief 讲话者散列表
+static const fnmea_slot_t fnmea_talker_slot[1 << FNMEA_SLOT_BITS] = {
+	[FNMEA_SLOT(FNMEA_TALKER('B', 'D'))] = {FNMEA_TALKER('B', 'D'), FNMEA_TYPE_BD},
+	[FNMEA_SLOT(FNMEA_TALKER('G', 'B'))] = {FNMEA_TALKER('G', 'B'), FNMEA_TYPE_BD},
+	[FNMEA_SLOT(FNMEA_TALKER('G', 'P'))] = {FNMEA_TALKER('G', 'P'), FNMEA_TYPE_GP},
+	[FNMEA_SLOT(FNMEA_TALKER('G', 'L'))] = {FNMEA_TALKER('G', 'L'), FNMEA_TYPE_GL},
+	[FNMEA_SLOT(FNMEA_TALKER('G', 'N'))] = {FNMEA_TALKER('G', 'N'), FNMEA_TYPE_GN},
+	[FNMEA_SLOT(FNMEA_TALKER('G', 'A'))] = {FNMEA_TALKER('G', 'A'), FNMEA_TYPE_GA},
+	[FNMEA_SLOT(FNMEA_TALKER('G', 'Q'))] = {FNMEA_TALKER('G', 'Q'), FNMEA_TYPE_GQ},
+	[FNMEA_SLOT(FNMEA_TALKER('G', 'I'))] = {FNMEA_TALKER('G', 'I'), FNMEA_TYPE_GI},
+};
+
+/// @brief 内置语句散列表
+static const fnmea_slot_t fnmea_command_slot[1 << FNMEA_SLOT_BITS] = {
+	[FNMEA_SLOT(FNMEA_ADDRESS('G', 'G', 'A'))] = {FNMEA_ADDRESS('G', 'G', 'A'), FNMEA_CMD_GGA},
+	[FNMEA_SLOT(FNMEA_ADDRESS('G', 'S', 'A'))] = {FNMEA_ADDRESS('G', 'S', 'A'), FNMEA_CMD_GSA},
+	[FNMEA_SLOT(FNMEA_ADDRESS('G', 'S', 'V'))] = {FNMEA_ADDRESS('G', 'S', 'V'), FNMEA_CMD_GSV},
+	[FNMEA_SLOT(FNMEA_ADDRESS('R', 'M', 'C'))] = {FNMEA_ADDRESS('R', 'M', 'C'), FNMEA_CMD_RMC},
+	[FNMEA_SLOT(FNMEA_ADDRESS('V', 'T', 'G'))] = {FNMEA_ADDRESS('V', 'T', 'G'), FNMEA_CMD_VTG},
+	[FNMEA_SLOT(FNMEA_ADDRESS('G', 'L', 'L'))] = {FNMEA_ADDRESS('G', 'L', 'L'), FNMEA_CMD_GLL},
+};
+
+/// @brief 清空当前字段
+/// @param ctx 解析上下文
+static void fnmea_field_reset(fnmea_ctx_t *ctx)
+{
+	ctx->field.integer = 0;
+	ctx->field.frac = 0;
+	ctx->field.frac_digits = 0;
+	ctx->field.flags = 0;
+	ctx->field.length = 0;
+	ctx->field.head = '\0';
+}
+
+/// @brief 累加字段字符
+/// @param field 字段
+/// @param c 字符
+static void fnmea_field_push(fnmea_field_t *field, uint8_t c)
+{
+	uint32_t digit = (uint32_t)c - '0';
+
+	if (field->length == 0)
 	{
-		MOVE_TO_NEXT();
-		return FNMEA_Error_None;
+		field->head = (char)c;
+	}
+	if (field->length < UINT8_MAX)
+	{
+		field->length++;
+	}
+	if (digit < 10)
+	{
+		if ((field->flags & FNMEA_FIELD_DOT) == 0)
+		{
+			if ((field->integer > UINT32_MAX / 10) || ((field->integer == UINT32_MAX / 10) && (digit > UINT32_MAX % 10)))
+			{
+				field->flags |= FNMEA_FIELD_INVALID;
+			}
+			field->integer = field->integer * 10 + digit;
+		}
+		else if (field->frac_digits < 9)
+		{
+			field->frac = field->frac * 10 + digit;
+			field->frac_digits++;
+		}
+	}
+	else if ((c == '.') && ((field->flags & FNMEA_FIELD_DOT) == 0))
+	{
+		field->flags |= FNMEA_FIELD_DOT;
+	}
+	else if ((c == '-') && (field->length == 1))
+	{
+		field->flags |= FNMEA_FIELD_NEGATIVE;
 	}
 	else
 	{
-		return FNMEA_Error_Parse_Fix_Char;
+		field->flags |= FNMEA_FIELD_INVALID;
+	}
+}
+
+/// @brief 查找自定义语句
+/// @param registry 注册表
+/// @param key 打包后的语句标识
+/// @return 处理函数，未注册时为 NULL
+static fnmea_handler_t fnmea_registry_find(const fnmea_registry_t *registry, uint64_t key)
+{
+	uint32_t slot = FNMEA_HASH(key, FNMEA_HANDLER_BITS);
+
+	// 线性探测，注册表中总有空位
+	while (registry->key[slot] != 0)
+	{
+		if (registry->key[slot] == key)
+		{
+			return registry->handler[slot];
+		}
+		slot = (slot + 1) & ((1U << FNMEA_HANDLER_BITS) - 1);
+	}
+	return 0;
+}
+
+/// @brief 由打包后的地址字段确定讲话者与语句类型
+/// @param ctx 解析上下文
+/// @param length 地址字段字符数
+/// @param handler 自定义语句处理函数，为 NULL 时只查找内置语句
+/// @return 错误类型
+/// @note 内置语句只接受卫星导航讲话者，其他讲话者（如 HE、II）的语句只按语句标识查找自定义语句
+static FNMEA_Error_Type fnmea_dispatch(fnmea_ctx_t *ctx, uint32_t length, fnmea_handler_t *handler)
+{
+	FNMEA_Error_Type miss = FNMEA_Error_Parse_CMD_type;
+	const fnmea_slot_t *slot;
+	uint32_t talker;
+	uint64_t key;
+
+	if ((length == 0) || (length > FNMEA_ADDRESS_MAX))
+	{
+		return FNMEA_Error_Format;
+	}
+	if ((uint8_t)(ctx->address >> ((length - 1) * 8)) == 'P')
+	{
+		// 专有语句按完整地址字段查找
+		ctx->work.type = FNMEA_TYPE_Proprietary;
+		key = ctx->address;
 	}
+	else
+	{
+		if (length != 5)
+		{
+			return FNMEA_Error_Format;
+		}
+		talker = (uint32_t)(ctx->address >> 24);
+		key = ctx->address & 0xFFFFFF;
+		slot = &fnmea_talker_slot[FNMEA_SLOT(talker)];
+		if (slot->key == talker)
+		{
+			ctx->work.type = (fnmea_type_e)slot->value;
+			slot = &fnmea_command_slot[FNMEA_SLOT(key)];
+			if (slot->key == key)
+			{
+				ctx->cmd = (FNMEA_CMD_Type)slot->value;
+				return FNMEA_Error_None;
+			}
+		}
+		else
+		{
+			ctx->work.type = FNMEA_TYPE_Unknown;
+			miss = FNMEA_Error_Parse_type;
+		}
+	}
+	ctx->cmd = FNMEA_CMD_Custom;
+	if ((handler != 0) && (ctx->registry != 0))
+	{
+		*handler = fnmea_registry_find(ctx->registry, key);
+		if (*handler != 0)
+		{
+			return FNMEA_Error_None;
+		}
+	}
+	return miss;
 }
 
-static FNMEA_Error_Type fnmea_parse_utc_time(char* pbuffer, fnmea_utc_time_t* time)
+/// @brief 解码已结束的字段，空字段清除语句自身负责的记录字段
+/// @param ctx 解析上下文
+/// @return 错误类型
+static FNMEA_Error_Type fnmea_stream_field(fnmea_ctx_t *ctx)
 {
 	FNMEA_Error_Type ret = FNMEA_Error_None;
-	int32_t time_num;
-	uint32_t div;
-	uint32_t rem;
 
-	// 获取时间信息
-	CHECK_RETURN(fnmea_parse_int32(pbuffer, &time_num));
-	// 解析秒
-	div_mod_100((uint32_t)time_num, &div, &rem);
-	time->sec = rem;
-	// 解析分和时
-	div_mod_100(div, &div, &rem);
-	time->min = rem;
-	time->hour = div;
-	// 解析小数点
-	CHECK_RETURN(fnmea_parse_fix_char(pbuffer, '.'));
-	// 解析毫秒
-	CHECK_RETURN(fnmea_parse_uint16(pbuffer, &time->msec));
+	if (ctx->index == 0)
+	{
+		// 每条语句从最近一次提交的记录开始更新，流式解析不处理自定义语句
+		ctx->work = ctx->nmea;
+		ret = fnmea_dispatch(ctx, ctx->length - 2U, 0);
+	}
+	else
+	{
+		ret = fnmea_command[ctx->cmd].decode(&ctx->field, &ctx->work, ctx->index);
+	}
+	if (ctx->index < UINT8_MAX)
+	{
+		ctx->index++;
+	}
+	fnmea_field_reset(ctx);
+	return ret;
+}
 
+/// @brief UTC 时间换算为当日毫秒数
+/// @param time UTC 时间
+/// @return 当日毫秒数
+static uint32_t fnmea_time_key(const fnmea_utc_time_t *time)
+{
+	return (((uint32_t)time->hour * 60 + time->min) * 60 + time->sec) * 1000 + time->msec;
+}
+
+/// @brief 输出当前历元
+/// @param ctx 解析上下文
+static void fnmea_epoch_emit(fnmea_ctx_t *ctx)
+{
+	uint32_t seen = ctx->epoch.seen;
+
+	ctx->epoch.open = 0;
+	ctx->epoch.seen = 0;
+	ctx->epoch.last = ctx->epoch.time;
+	ctx->epoch.epochs++;
+	ctx->epoch.callback(ctx, &ctx->nmea, seen);
+}
+
+/// @brief 提交通过校验的记录
+/// @param ctx 解析上下文
+static void fnmea_commit(fnmea_ctx_t *ctx)
+{
+	fnmea_epoch_t *epoch = &ctx->epoch;
+	// 带 UTC 时间的语句
+	bool timed = (ctx->cmd == FNMEA_CMD_GGA) || (ctx->cmd == FNMEA_CMD_RMC) || (ctx->cmd == FNMEA_CMD_GLL);
+	uint32_t time = fnmea_time_key(&ctx->work.utc_time);
+
+	// UTC 时间变化时先输出上一历元，此时记录中还没有合并新语句
+	if ((epoch->callback != 0) && epoch->open && timed && (time != epoch->time))
+	{
+		fnmea_epoch_emit(ctx);
+	}
+	ctx->nmea = ctx->work;
+	ctx->sentences++;
+	if (ctx->callback != 0)
+	{
+		ctx->callback(ctx, ctx->cmd, &ctx->nmea);
+	}
+	if (epoch->callback == 0)
+	{
+		return;
+	}
+	// 已输出历元的迟到语句（如凑齐后才到的 GLL）只合并到记录，不开始新历元
+	if (timed && !epoch->open && (epoch->epochs != 0) && (time == epoch->last))
+	{
+		return;
+	}
+	// 历元从带 UTC 时间的语句开始，之前收到的不带时间的语句一并计入
+	epoch->seen |= FNMEA_EPOCH(ctx->cmd);
+	if (timed && !epoch->open)
+	{
+		epoch->open = 1;
+		epoch->time = time;
+		epoch->start = epoch->now;
+	}
+	if (epoch->open && (epoch->expect != 0) && ((epoch->seen & epoch->expect) == epoch->expect))
+	{
+		fnmea_epoch_emit(ctx);
+	}
+}
+
+/// @brief 解析十六进制字符
+/// @param c 字符
+/// @return 数值，非十六进制字符时为 0xFF
+static uint8_t fnmea_hex(uint8_t c)
+{
+	if ((uint8_t)(c - '0') < 10)
+	{
+		return (uint8_t)(c - '0');
+	}
+	if ((uint8_t)(c - 'A') < 6)
+	{
+		return (uint8_t)(c - 'A' + 10);
+	}
+	if ((uint8_t)(c - 'a') < 6)
+	{
+		return (uint8_t)(c - 'a' + 10);
+	}
+	return 0xFF;
+}
+
+/// @brief 初始化解析上下文
+/// @param ctx 解析上下文
+/// @param callback 语句解析完成回调，可为 NULL
+/// @param user 用户数据
+extern void fnmea_init(fnmea_ctx_t *ctx, fnmea_callback_t callback, void *user)
+{
+	*ctx = (fnmea_ctx_t){0};
+	ctx->nmea.staus = FNMEA_STAT_Invalid;
+	ctx->callback = callback;
+	ctx->user = user;
+}
+
+/// @brief 输入一个字节
+/// @param ctx 解析上下文
+/// @param byte 字节
+/// @return 错误类型，出错时丢弃当前语句并等待下一个 '$'
+/// @note 可以直接在串口接收中断中调用，回调函数在收到 '\n' 的调用中执行
+extern FNMEA_Error_Type fnmea_feed(fnmea_ctx_t *ctx, uint8_t byte)
+{
+	FNMEA_Error_Type ret = FNMEA_Error_None;
+	uint8_t hex;
+
+	// 任意位置的 '$' 都开始新语句
+	if (byte == '$')
+	{
+		if (ctx->state != FNMEA_STATE_Idle)
+		{
+			ctx->errors++;
+		}
+		ctx->state = FNMEA_STATE_Address;
+		ctx->index = 0;
+		ctx->checksum = 0;
+		ctx->length = 1;
+		ctx->address = 0;
+		fnmea_field_reset(ctx);
+		return FNMEA_Error_None;
+	}
+	if (ctx->state == FNMEA_STATE_Idle)
+	{
+		return FNMEA_Error_None;
+	}
+	if (++ctx->length > FNMEA_BUFFER_MAX_SIZE)
+	{
+		ret = FNMEA_Error_Overflow;
+		goto fnmea_feed_error;
+	}
+
+	switch (ctx->state)
+	{
+	case FNMEA_STATE_Address:
+		if (byte == ',')
+		{
+			ctx->checksum ^= byte;
+			ret = fnmea_stream_field(ctx);
+			if (ret != FNMEA_Error_None)
+			{
+				goto fnmea_feed_error;
+			}
+			ctx->state = FNMEA_STATE_Field;
+		}
+		else if ((uint8_t)(byte - 'A') < 26 || (uint8_t)(byte - '0') < 10)
+		{
+			if (ctx->length > FNMEA_ADDRESS_MAX + 1)
+			{
+				ret = FNMEA_Error_Format;
+				goto fnmea_feed_error;
+			}
+			ctx->checksum ^= byte;
+			ctx->address = (ctx->address << 8) | byte;
+		}
+		else
+		{
+			ret = FNMEA_Error_Format;
+			goto fnmea_feed_error;
+		}
+		break;
+	case FNMEA_STATE_Field:
+		if ((byte == ',') || (byte == '*'))
+		{
+			ret = fnmea_stream_field(ctx);
+			if (ret != FNMEA_Error_None)
+			{
+				goto fnmea_feed_error;
+			}
+			if (byte == '*')
+			{
+				ctx->state = FNMEA_STATE_Check_H;
+				break;
+			}
+			ctx->checksum ^= byte;
+		}
+		else if ((byte >= 0x20) && (byte < 0x7F))
+		{
+			ctx->checksum ^= byte;
+			fnmea_field_push(&ctx->field, byte);
+		}
+		else
+		{
+			ret = FNMEA_Error_Format;
+			goto fnmea_feed_error;
+		}
+		break;
+	case FNMEA_STATE_Check_H:
+	case FNMEA_STATE_Check_L:
+		hex = fnmea_hex(byte);
+		if (hex == 0xFF)
+		{
+			ret = FNMEA_Error_Format;
+			goto fnmea_feed_error;
+		}
+		ctx->expect = (uint8_t)((ctx->expect << 4) | hex);
+		ctx->state++;
+		break;
+	default:
+		if (byte == '\r')
+		{
+			break;
+		}
+		if (byte != '\n')
+		{
+			ret = FNMEA_Error_Format;
+			goto fnmea_feed_error;
+		}
+		ctx->state = FNMEA_STATE_Idle;
+		if (ctx->checksum != ctx->expect)
+		{
+			ctx->errors++;
+			return FNMEA_Error_Checksum;
+		}
+		fnmea_commit(ctx);
+		break;
+	}
+	return FNMEA_Error_None;
+
+fnmea_feed_error:
+	ctx->state = FNMEA_STATE_Idle;
+	ctx->errors++;
 	return ret;
 }
 
-static FNMEA_Error_Type fnmea_parse_degree(char* pbuffer, fnmea_degree_t* degree)
+/// @brief 输入一段数据
+/// @param ctx 解析上下文
+/// @param buf 数据
+/// @param len 数据长度
+/// @return 本次提交的语句数
+extern uint32_t fnmea_feed_n(fnmea_ctx_t *ctx, const uint8_t *buf, uint32_t len)
+{
+	uint32_t sentences = ctx->sentences;
+
+	for (uint32_t i = 0; i < len; i++)
+	{
+		fnmea_feed(ctx, buf[i]);
+	}
+	return ctx->sentences - sentences;
+}
+
+// 按 8 字节并行比较的常量
+#define FNMEA_SWAR_ONES 0x0101010101010101ULL
+#define FNMEA_SWAR_HIGHS 0x8080808080808080ULL
+#define FNMEA_SWAR_LOWS 0x7F7F7F7F7F7F7F7FULL
+// 64 位字中是否有为 0 的字节
+#define FNMEA_SWAR_HAS_ZERO(v) (((v) - FNMEA_SWAR_ONES) & ~(v) & FNMEA_SWAR_HIGHS)
+// 64 位字中等于 c 的字节的最高位置 1，其他位为 0（没有进位误判）
+#define FNMEA_SWAR_MATCH(v, c) \
+	(~(((((v) ^ (FNMEA_SWAR_ONES * (c))) & FNMEA_SWAR_LOWS) + FNMEA_SWAR_LOWS) | ((v) ^ (FNMEA_SWAR_ONES * (c))) | FNMEA_SWAR_LOWS))
+
+/// @brief 计算异或校验和
+/// @param buf 数据
+/// @param len 数据长度
+/// @return 校验和
+static uint8_t fnmea_xor(const char *buf, uint32_t len)
+{
+	uint64_t acc = 0;
+	uint8_t sum;
+
+#ifdef __SSE2__
+	__m128i acc128 = _mm_setzero_si128();
+
+	while (len >= 16)
+	{
+		acc128 = _mm_xor_si128(acc128, _mm_loadu_si128((const __m128i *)buf));
+		buf += 16;
+		len -= 16;
+	}
+	acc128 = _mm_xor_si128(acc128, _mm_srli_si128(acc128, 8));
+	_mm_storel_epi64((__m128i *)&acc, acc128);
+#endif
+	while (len >= 8)
+	{
+		uint64_t v;
+		memcpy(&v, buf, 8);
+		acc ^= v;
+		buf += 8;
+		len -= 8;
+	}
+	acc ^= acc >> 32;
+	acc ^= acc >> 16;
+	acc ^= acc >> 8;
+	sum = (uint8_t)acc;
+	while (len-- > 0)
+	{
+		sum ^= (uint8_t)*buf++;
+	}
+	return sum;
+}
+
+/// @brief 记录一个字段
+/// @param tokens 字段位置
+/// @param start 字段起始位置，更新为下一个字段的起始位置
+/// @param pos 分隔符位置
+static void fnmea_token_push(fnmea_tokens_t *tokens, uint32_t *start, uint32_t pos)
+{
+	if (tokens->count < FNMEA_FIELDS_MAX)
+	{
+		tokens->start[tokens->count] = (uint16_t)*start;
+		tokens->length[tokens->count] = (uint16_t)(pos - *start);
+		tokens->count++;
+	}
+	*start = pos + 1;
+}
+
+/// @brief 一次扫描记录语句中所有字段的位置
+/// @param buf 语句（从 '$' 开始）
+/// @param len 语句长度
+/// @param tokens 字段位置
+/// @return 错误类型，没有 '*' 时为 FNMEA_Error_Format
+static FNMEA_Error_Type fnmea_tokenize(const char *buf, uint32_t len, fnmea_tokens_t *tokens)
+{
+	uint32_t start = 1;
+	uint32_t pos = 1;
+
+	tokens->count = 0;
+	if (len > FNMEA_BUFFER_MAX_SIZE)
+	{
+		len = FNMEA_BUFFER_MAX_SIZE;
+	}
+#ifdef __SSE2__
+	const __m128i comma = _mm_set1_epi8(',');
+	const __m128i star = _mm_set1_epi8('*');
+	__m128i v;
+	unsigned int mask;
+
+	while (pos + 16 <= len)
+	{
+		v = _mm_loadu_si128((const __m128i *)(buf + pos));
+		mask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, comma), _mm_cmpeq_epi8(v, star)));
+		while (mask != 0)
+		{
+			uint32_t at = pos + (uint32_t)__builtin_ctz(mask);
+			fnmea_token_push(tokens, &start, at);
+			if (buf[at] == '*')
+			{
+				tokens->star = (uint16_t)at;
+				return FNMEA_Error_None;
+			}
+			mask &= mask - 1;
+		}
+		pos += 16;
+	}
+#else
+	uint64_t v;
+	uint64_t mask;
+
+	// 每次比较 8 字节，按匹配位依次取出分隔符
+	while (pos + 8 <= len)
+	{
+		memcpy(&v, buf + pos, 8);
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+		v = __builtin_bswap64(v);
+#endif
+		mask = FNMEA_SWAR_MATCH(v, ',') | FNMEA_SWAR_MATCH(v, '*');
+		while (mask != 0)
+		{
+			uint32_t at = pos + ((uint32_t)__builtin_ctzll(mask) >> 3);
+			fnmea_token_push(tokens, &start, at);
+			if (buf[at] == '*')
+			{
+				tokens->star = (uint16_t)at;
+				return FNMEA_Error_None;
+			}
+			mask &= mask - 1;
+		}
+		pos += 8;
+	}
+#endif
+	for (; pos < len; pos++)
+	{
+		if ((buf[pos] == ',') || (buf[pos] == '*'))
+		{
+			fnmea_token_push(tokens, &start, pos);
+			if (buf[pos] == '*')
+			{
+				tokens->star = (uint16_t)pos;
+				return FNMEA_Error_None;
+			}
+		}
+	}
+	return FNMEA_Error_Format;
+}
+
+/// @brief 由字段视图加载字段
+/// @param field 字段
+/// @param str 字段内容
+/// @param len 字段长度
+/// @note 字段内容完整可见，整数部分与小数部分由 fscan_u32 转换（长数字串每次 8 位）；
+///       有效字段的标志与数值与逐字节调用 fnmea_field_push 相同，无效字段只保证带有 FNMEA_FIELD_INVALID
+static void fnmea_field_load(fnmea_field_t *field, const char *str, uint32_t len)
+{
+	uint32_t pos = 0;
+	uint32_t digits;
+	int32_t ret;
+
+	*field = (fnmea_field_t){0};
+	if (len == 0)
+	{
+		return;
+	}
+	field->head = str[0];
+	field->length = (len < UINT8_MAX) ? (uint8_t)len : UINT8_MAX;
+	if (str[0] == '-')
+	{
+		field->flags |= FNMEA_FIELD_NEGATIVE;
+		pos = 1;
+	}
+	ret = fscan_u32(str + pos, len - pos, &field->integer);
+	if (ret == FSCAN_Error_Overflow)
+	{
+		field->flags |= FNMEA_FIELD_INVALID;
+		return;
+	}
+	pos += (ret > 0) ? (uint32_t)ret : 0;
+	if ((pos < len) && (str[pos] == '.'))
+	{
+		field->flags |= FNMEA_FIELD_DOT;
+		pos++;
+		// 只保留前 9 位小数，其余数字跳过
+		digits = (len - pos < 9) ? len - pos : 9;
+		ret = fscan_u32(str + pos, digits, &field->frac);
+		if (ret > 0)
+		{
+			field->frac_digits = (uint8_t)ret;
+			pos += (uint32_t)ret;
+		}
+		while ((pos < len) && ((uint8_t)(str[pos] - '0') <= 9))
+		{
+			pos++;
+		}
+	}
+	if (pos != len)
+	{
+		field->flags |= FNMEA_FIELD_INVALID;
+	}
+}
+
+/// @brief 解析一条完整语句
+/// @param ctx 解析上下文
+/// @param verify 是否检查校验和
+/// @return 错误类型
+static FNMEA_Error_Type fnmea_parse_sentence(fnmea_ctx_t *ctx, bool verify)
 {
 	FNMEA_Error_Type ret;
-	uint16_t integer;
-	uint16_t decimal;
+	fnmea_tokens_t tokens;
+	fnmea_handler_t handler = 0;
+	uint64_t address;
+	uint32_t mask;
+	uint32_t index;
+	uint8_t high;
+	uint8_t low;
 
-	uint32_t div;
-	uint32_t rem;
+	MOVE_TO_HEAD();
+	CHECK_RETURN(fnmea_parse_fix_char(ctx, '$'));
+	CHECK_RETURN(fnmea_tokenize(ctx->buffer, ctx->size, &tokens));
+	if (tokens.length[0] > FNMEA_ADDRESS_MAX)
+	{
+		return FNMEA_Error_Format;
+	}
+	if (verify)
+	{
+		if ((uint32_t)tokens.star + 2 >= ctx->size)
+		{
+			return FNMEA_Error_Format;
+		}
+		high = fnmea_hex((uint8_t)ctx->buffer[tokens.star + 1]);
+		low = fnmea_hex((uint8_t)ctx->buffer[tokens.star + 2]);
+		if ((high == 0xFF) || (low == 0xFF))
+		{
+			return FNMEA_Error_Format;
+		}
+		if (fnmea_xor(ctx->buffer + 1, tokens.star - 1U) != (uint8_t)((high << 4) | low))
+		{
+			return FNMEA_Error_Checksum;
+		}
+	}
+	ctx->work = ctx->nmea;
+	address = 0;
+	for (index = 1; index <= tokens.length[0]; index++)
+	{
+		address = (address << 8) | (uint8_t)ctx->buffer[index];
+	}
+	ctx->address = address;
+	CHECK_RETURN(fnmea_dispatch(ctx, tokens.length[0], &handler));
+	if (handler != 0)
+	{
+		return handler(ctx, ctx->buffer, &tokens);
+	}
 
-	// 格式为：(d)ddmm.mmmm
-	CHECK_RETURN(fnmea_parse_uint16(pbuffer, &integer)); // (d)ddmm
-	CHECK_RETURN(fnmea_parse_fix_char(pbuffer, '.'));// .
-	CHECK_RETURN(fnmea_parse_uint16(pbuffer, &decimal));// mmmm
+	// 只解码用到的字段（空字段清除对应的记录字段），其余字段不读取
+	mask = fnmea_command[ctx->cmd].mask;
+	if (tokens.count < 32)
+	{
+		mask &= (1U << tokens.count) - 1;
+	}
+	while (mask != 0)
+	{
+		index = (uint32_t)__builtin_ctz(mask);
+		mask &= mask - 1;
+		fnmea_field_load(&ctx->field, ctx->buffer + tokens.start[index], tokens.length[index]);
+		CHECK_RETURN(fnmea_command[ctx->cmd].decode(&ctx->field, &ctx->work, (uint8_t)index));
+	}
+	return FNMEA_Error_None;
+}
 
-	// 解析：(d)dd
-	div_mod_100((uint32_t)integer, &div, &rem);
-	// 解析：mm.mmmm
-	degree->deg = (uint8_t)div;
-	degree->min = (uint8_t)rem;
-	degree->min_dec = decimal;
+/// @brief 解析缓冲区中的语句并提交
+/// @param ctx 解析上下文
+/// @param sentence 语句
+/// @param len 语句长度
+/// @param verify 是否检查校验和
+/// @return 错误类型
+static FNMEA_Error_Type fnmea_parse_buffer(fnmea_ctx_t *ctx, const char *sentence, uint32_t len, bool verify)
+{
+	FNMEA_Error_Type ret;
 
-	return ret;
+	ctx->buffer = sentence;
+	ctx->size = len;
+	ret = fnmea_parse_sentence(ctx, verify);
+	ctx->buffer = 0;
+	ctx->size = 0;
+	if (ret != FNMEA_Error_None)
+	{
+		ctx->errors++;
+		return ret;
+	}
+	fnmea_commit(ctx);
+	return FNMEA_Error_None;
 }
 
-static FNMEA_Error_Type fnmea_parse_location(char* pbuffer, fnmea_location_t* locate)
+/// @brief 解析一条完整语句（从 '$' 开始，末尾的 "\r\n" 可省略）
+/// @param ctx 解析上下文
+/// @param sentence 语句
+/// @param len 语句长度
+/// @return 错误类型，通过校验时提交记录并调用回调函数
+/// @note 与 fnmea_feed 共用上下文中的记录，同一上下文不应同时用于两种输入方式
+extern FNMEA_Error_Type fnmea_parse(fnmea_ctx_t *ctx, const char *sentence, uint32_t len)
 {
-	FNMEA_Error_Type ret = FNMEA_Error_None;
-	// 纬度数值
-	CHECK_RETURN(fnmea_parse_degree(pbuffer, &locate->lati));
-	// ,
-	CHECK_RETURN(fnmea_parse_fix_char(pbuffer, ','));
-	// 纬度符号
-	if (INDEX_BUFFER(pbuffer) == 'N')
-		locate->lati.sign = 1;
-	else if (INDEX_BUFFER(pbuffer) == 'S')
-		locate->lati.sign = 0;
-	else
-		return FNMEA_Error_Parse_Fix_Char;
+	return fnmea_parse_buffer(ctx, sentence, len, true);
+}
 
-	MOVE_TO_NEXT();
-	// ,
-	CHECK_RETURN(fnmea_parse_fix_char(pbuffer, ','));
-	// 经度数值
-	CHECK_RETURN(fnmea_parse_degree(pbuffer, &locate->longi));
-	// ,
-	CHECK_RETURN(fnmea_parse_fix_char(pbuffer, ','));
-	// 经度符号
-	if (INDEX_BUFFER(pbuffer) == 'E')
-		locate->longi.sign = 0;
-	else if (INDEX_BUFFER(pbuffer) == 'W')
-		locate->longi.sign = 1;
-	else
-		return FNMEA_Error_Parse_Fix_Char;
+/// @brief 查找语句中第一个 '*'、'$' 或 '\n'
+/// @param buf 数据
+/// @param pos 起始位置
+/// @param end 结束位置
+/// @return 找到的位置，没有找到时为 end
+static uint32_t fnmea_frame_scan(const char *buf, uint32_t pos, uint32_t end)
+{
+#ifdef __SSE2__
+	const __m128i star = _mm_set1_epi8('*');
+	const __m128i dollar = _mm_set1_epi8('$');
+	const __m128i lf = _mm_set1_epi8('\n');
+	__m128i v;
+	int mask;
+
+	while (pos + 16 <= end)
+	{
+		v = _mm_loadu_si128((const __m128i *)(buf + pos));
+		mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, star), _mm_cmpeq_epi8(v, dollar)),
+											  _mm_cmpeq_epi8(v, lf)));
+		if (mask != 0)
+		{
+			return pos + (uint32_t)__builtin_ctz((unsigned int)mask);
+		}
+		pos += 16;
+	}
+#else
+	uint64_t v;
 
-	MOVE_TO_NEXT();
-	// ,
-	CHECK_RETURN(fnmea_parse_fix_char(pbuffer, ','));
+	// 先按 8 字节跳过不含分隔符的部分，再逐字节定位
+	while (pos + 8 <= end)
+	{
+		memcpy(&v, buf + pos, 8);
+		if ((FNMEA_SWAR_HAS_ZERO(v ^ (FNMEA_SWAR_ONES * '*')) | FNMEA_SWAR_HAS_ZERO(v ^ (FNMEA_SWAR_ONES * '$')) |
+			 FNMEA_SWAR_HAS_ZERO(v ^ (FNMEA_SWAR_ONES * '\n'))) != 0)
+		{
+			break;
+		}
+		pos += 8;
+	}
+#endif
+	while ((pos < end) && (buf[pos] != '*') && (buf[pos] != '$') && (buf[pos] != '\n'))
+	{
+		pos++;
+	}
+	return pos;
 }
 
+/// @brief 在数据块中批量定位并校验语句
+/// @param buf 数据
+/// @param len 数据长度
+/// @param spans 通过校验的语句位置
+/// @param max_spans 语句位置数组大小
+/// @param used 已处理的字节数，末尾不完整的语句从此处开始，应与下一块数据拼接后再处理
+/// @return 通过校验的语句数
+/// @note 校验失败、缺少校验和或超过 FNMEA_BUFFER_MAX_SIZE 的语句被跳过
+extern uint32_t fnmea_frame(const char *buf, uint32_t len, fnmea_span_t *spans, uint32_t max_spans, uint32_t *used)
+{
+	uint32_t count = 0;
+	uint32_t pos = 0;
+	uint32_t start;
+	uint32_t star;
+	uint32_t end;
+	uint8_t high;
+	uint8_t low;
+	const char *p;
 
+	while (count < max_spans)
+	{
+		p = (const char *)memchr(buf + pos, '$', len - pos);
+		if (p == 0)
+		{
+			pos = len;
+			break;
+		}
+		start = (uint32_t)(p - buf);
+		end = ((len - start) > FNMEA_BUFFER_MAX_SIZE) ? (start + FNMEA_BUFFER_MAX_SIZE) : len;
+		star = fnmea_frame_scan(buf, start + 1, end);
+		if ((star == len) || ((buf[star] == '*') && (star + 3 > len)))
+		{
+			// 数据块末尾的不完整语句
+			pos = start;
+			break;
+		}
+		if ((star == end) || (buf[star] != '*') || (star + 3 > end))
+		{
+			// 语句过长或中途断开，从断开处继续查找
+			pos = (star == end) ? (start + 1) : star;
+			continue;
+		}
+		pos = star + 3;
+		high = fnmea_hex((uint8_t)buf[star + 1]);
+		low = fnmea_hex((uint8_t)buf[star + 2]);
+		if ((high == 0xFF) || (low == 0xFF) ||
+			(fnmea_xor(buf + start + 1, star - start - 1) != (uint8_t)((high << 4) | low)))
+		{
+			continue;
+		}
+		spans[count].offset = start;
+		spans[count].length = star + 3 - start;
+		count++;
+	}
+	*used = pos;
+	return count;
+}
 
+/// @brief 解析 fnmea_frame 定位的语句，直接读取原数据且不再重复校验
+/// @param ctx 解析上下文
+/// @param buf 传给 fnmea_frame 的数据
+/// @param span 语句位置
+/// @return 错误类型，成功时提交记录并调用回调函数
+extern FNMEA_Error_Type fnmea_parse_span(fnmea_ctx_t *ctx, const char *buf, const fnmea_span_t *span)
+{
+	return fnmea_parse_buffer(ctx, buf + span->offset, span->length, false);
+}
 
-static FNMEA_Error_Type fnmea_parse_cmd_GCA(char* pbuffer, fnmea_t* nmea)
+/// @brief 开启历元合并
+/// @param ctx 解析上下文
+/// @param callback 历元完成回调，为 NULL 时关闭历元合并
+/// @param expect 凑齐后立即输出的语句，由 FNMEA_EPOCH(cmd) 组成，为 0 时只按时间变化与超时输出
+/// @param timeout 超时时间，为 0 时不检查超时
+/// @note 历元从带 UTC 时间的语句（GGA、RMC、GLL）开始；不带时间的语句（GSA、GSV、VTG）归入当前历元，
+///       历元已输出时归入下一个历元，需要与定位结果同一历元输出的语句应包含在 expect 中；
+///       与已输出历元 UTC 时间相同的带时间语句只合并到记录，不再输出
+extern void fnmea_epoch_init(fnmea_ctx_t *ctx, fnmea_epoch_callback_t callback, uint32_t expect, uint32_t timeout)
 {
-	FNMEA_Error_Type ret = FNMEA_Error_None;
-	CHECK_RETURN(fnmea_parse_fix_char(pbuffer, '$'));
-	CHECK_RETURN(fnmea_parse_utc_time(pbuffer, &nmea->utc_time));
-	CHECK_RETURN(fnmea_parse_location(pbuffer, &nmea->locate));
-	MOVE_TO_NEXT_PARAM(pbuffer);
+	ctx->epoch = (fnmea_epoch_t){0};
+	ctx->epoch.callback = callback;
+	ctx->epoch.expect = expect;
+	ctx->epoch.timeout = timeout;
+}
+
+/// @brief 检查历元超时，缺少语句时由此输出
+/// @param ctx 解析上下文
+/// @param now 当前时间（单调递增，单位与 timeout 相同，允许回绕）
+/// @return 是否输出了历元
+/// @note 历元开始时间取最近一次调用时传入的时间，超时精度为调用周期；
+///       流式解析在中断中进行时，应在关中断或同一执行上下文中调用
+extern bool fnmea_epoch_poll(fnmea_ctx_t *ctx, uint32_t now)
+{
+	ctx->epoch.now = now;
+	if ((ctx->epoch.timeout == 0) || ((uint32_t)(now - ctx->epoch.start) < ctx->epoch.timeout))
+	{
+		return false;
+	}
+	return fnmea_epoch_flush(ctx);
+}
+
+/// @brief 立即输出尚未输出的历元（如数据结束时）
+/// @param ctx 解析上下文
+/// @return 是否输出了历元
+extern bool fnmea_epoch_flush(fnmea_ctx_t *ctx)
+{
+	if ((ctx->epoch.callback == 0) || !ctx->epoch.open)
+	{
+		return false;
+	}
+	fnmea_epoch_emit(ctx);
+	return true;
+}
+
+/// @brief 读取语句中的字段，供自定义语句处理函数使用
+/// @param sentence 语句
+/// @param tokens 字段位置
+/// @param index 字段序号（地址字段为 0）
+/// @param field 字段
+/// @return 字段存在且非空时为 true
+extern bool fnmea_token_field(const char *sentence, const fnmea_tokens_t *tokens, uint8_t index, fnmea_field_t *field)
+{
+	if ((index >= tokens->count) || (tokens->length[index] == 0))
+	{
+		*field = (fnmea_field_t){0};
+		return false;
+	}
+	fnmea_field_load(field, sentence + tokens->start[index], tokens->length[index]);
+	return true;
+}
+
+/// @brief 清空注册表
+/// @param registry 注册表
+extern void fnmea_registry_init(fnmea_registry_t *registry)
+{
+	memset(registry, 0, sizeof(*registry));
+}
 
+/// @brief 注册自定义语句
+/// @param registry 注册表
+/// @param address 语句标识（3 个字符，匹配所有讲话者）或专有语句地址字段（'P' 开头，4 ~ FNMEA_ADDRESS_MAX 个字符）
+/// @param handler 处理函数
+/// @return 错误类型，与内置语句重复时为 FNMEA_Error_Parse_CMD_type，注册表已满时为 FNMEA_Error_Overflow
+/// @note 重复注册同一语句时替换处理函数；注册表在解析过程中只读，应在开始解析前完成注册
+extern FNMEA_Error_Type fnmea_register(fnmea_registry_t *registry, const char *address, fnmea_handler_t handler)
+{
+	uint32_t length = (uint32_t)strlen(address);
+	uint64_t key = 0;
+	uint32_t slot;
 
+	if ((handler == 0) || ((length != 3) && ((address[0] != 'P') || (length < 4) || (length > FNMEA_ADDRESS_MAX))))
+	{
+		return FNMEA_Error_Format;
+	}
+	for (uint32_t i = 0; i < length; i++)
+	{
+		if (((uint8_t)(address[i] - 'A') >= 26) && ((uint8_t)(address[i] - '0') >= 10))
+		{
+			return FNMEA_Error_Format;
+		}
+		key = (key << 8) | (uint8_t)address[i];
+	}
+	if ((length == 3) && (fnmea_command_slot[FNMEA_SLOT(key)].key == key))
+	{
+		return FNMEA_Error_Parse_CMD_type;
+	}
+	slot = FNMEA_HASH(key, FNMEA_HANDLER_BITS);
+	while ((registry->key[slot] != 0) && (registry->key[slot] != key))
+	{
+		slot = (slot + 1) & ((1U << FNMEA_HANDLER_BITS) - 1);
+	}
+	if (registry->key[slot] == 0)
+	{
+		if (registry->count >= FNMEA_HANDLER_MAX)
+		{
+			return FNMEA_Error_Overflow;
+		}
+		registry->key[slot] = key;
+		registry->count++;
+	}
+	registry->handler[slot] = handler;
+	return FNMEA_Error_None;
 }
 
-char utc_time_test_buffer[FNMEA_BUFFER_MAX_SIZE] = "235316.000";
-char degree_test_buffer[FNMEA_BUFFER_MAX_SIZE] = "12000.0090";
-char location_test_buffer[FNMEA_BUFFER_MAX_SIZE] = "2959.9925,N,12000.0090,W,";
+/// @brief 关联自定义语句注册表
+/// @param ctx 解析上下文
+/// @param registry 注册表，为 NULL 时只解析内置语句
+extern void fnmea_set_registry(fnmea_ctx_t *ctx, const fnmea_registry_t *registry)
+{
+	ctx->registry = registry;
+}
 
+#ifdef FNMEA_TEST
+char gga_test_buffer[FNMEA_BUFFER_MAX_SIZE] = "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n";
+char rmc_test_buffer[FNMEA_BUFFER_MAX_SIZE] = "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n";
 
 int main(void)
 {
 	FNMEA_Error_Type ret = FNMEA_Error_None;
-	fnmea_utc_time_t time;
-	fnmea_degree_t degree;
-	fnmea_location_t locate;
+	fnmea_ctx_t ctx;
 
-	ret = fnmea_parse_utc_time(utc_time_test_buffer, &time);
-	MOVE_TO_HEAD();
-	ret = fnmea_parse_degree(degree_test_buffer, &degree);
-	MOVE_TO_HEAD();
-	ret = fnmea_parse_location(location_test_buffer, &locate);
-	MOVE_TO_HEAD();
+	fnmea_init(&ctx, 0, 0);
+	ret = fnmea_parse(&ctx, gga_test_buffer, FNMEA_BUFFER_MAX_SIZE);
+	if (ret == FNMEA_Error_None)
+	{
+		ret = fnmea_parse(&ctx, rmc_test_buffer, FNMEA_BUFFER_MAX_SIZE);
+	}
 
-	return 0;
-}
\ No newline at end of file
+	return (int)ret;
+}
+#endif
@@ -51,6 +51,35 @@
  * 6. 地面航向（正北方向角、磁北方向角）
  * 7. 定位精度（精度因子、可见卫星数）
  *
+ * 流式解析：
+ *
+ * fnmea_feed / fnmea_feed_n 逐字节驱动状态机，不缓存整条语句：
+ * 校验和随字节累计，字段在遇到 ',' 或 '*' 时立即解码到解析中的记录，
+ * 收到 "\r\n" 且校验通过后提交记录并调用回调函数，校验失败时丢弃整条语句
+ *
+ * 批量解析：
+ *
+ * fnmea_frame 在整块数据中定位 '$'、'*' 与换行并计算异或校验和（SSE2 每次 16 字节，其他平台每次 8 字节），
+ * 输出通过校验的语句位置；fnmea_parse_span 直接读取原数据解码，不复制也不再重复校验
+ *
+ * 语句分派：
+ *
+ * 地址字段按字符打包为整数后查散列表，讲话者与内置语句的查找都是 O(1)；
+ * 讲话者支持 BD/GB/GP/GL/GN/GA/GQ/GI，以 'P' 开头的地址字段为专有语句
+ *
+ * 历元合并：
+ *
+ * 接收机每个历元输出多条语句，各自更新记录的一部分（GGA 海拔与卫星数、RMC 日期与速度、GSA 精度因子）；
+ * fnmea_epoch_init 开启后，通过校验的语句按 UTC 时间归入历元并直接合并到上下文中的记录，
+ * 凑齐指定语句、收到新的 UTC 时间或 fnmea_epoch_poll 超时时，以合并后的记录调用一次历元回调
+ *
+ * 自定义语句：
+ *
+ * fnmea_register 将语句标识（如 "ZDA"、"HDT"，匹配包括非卫星导航设备在内的所有讲话者）或专有语句地址（如 "PUBX"）注册到注册表，
+ * fnmea_set_registry 将注册表关联到上下文；处理函数收到通过校验的整条语句与字段位置，
+ * 可用 fnmea_token_field 读取字段。自定义语句只在整条语句解析（fnmea_parse / fnmea_parse_span）时处理，
+ * 流式解析不缓存语句，遇到时按 FNMEA_Error_Parse_CMD_type 丢弃
+ *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 #ifndef __UTL_FNMEA_H__
 #define __UTL_FNMEA_H__
@@ -60,6 +89,44 @@
 #include <stdbool.h>
 
 #define FNMEA_BUFFER_MAX_SIZE 256
+// 整条语句解析时记录的最大字段数（含地址字段）
+#define FNMEA_FIELDS_MAX 24
+// 地址字段最大字符数（打包为 64 位整数）
+#define FNMEA_ADDRESS_MAX 8
+// 语句类型对应的位，用于组成历元需要的语句
+#define FNMEA_EPOCH(cmd) (1U << (cmd))
+// 可注册的自定义语句数
+#define FNMEA_HANDLER_MAX 16
+// 自定义语句散列表大小为 2^n，应大于 FNMEA_HANDLER_MAX
+#define FNMEA_HANDLER_BITS 5
+
+/// @brief 语句类型定义
+typedef enum tagFNMEA_CMD_Type
+{
+	FNMEA_CMD_GGA,
+	FNMEA_CMD_GSA,
+	FNMEA_CMD_GSV,
+	FNMEA_CMD_RMC,
+	FNMEA_CMD_VTG,
+	FNMEA_CMD_GLL,
+	FNMEA_CMD_Custom // 已注册的自定义语句
+} FNMEA_CMD_Type;
+
+/// @brief 错误类型定义
+typedef enum tagFNMEA_Error_Type
+{
+	FNMEA_Error_None,
+	FNMEA_Error_Overflow,
+	FNMEA_Error_Parse_uint8,
+	FNMEA_Error_Parse_uint16,
+	FNMEA_Error_Parse_int32,
+	FNMEA_Error_Parse_type,
+	FNMEA_Error_Parse_CMD_type,
+	FNMEA_Error_Parse_Fix_Char,
+	FNMEA_Error_Checksum, // 校验和错误
+	FNMEA_Error_Format,	  // 语句格式错误
+
+} FNMEA_Error_Type;
 
 /// @brief 定位状态定义
 typedef enum tagFNMEA_Status
@@ -77,6 +144,11 @@ typedef enum tagFNMEA_Type
 	FNMEA_TYPE_GP,	 // 全球定位系统（GPS、SBAS、QZSS） 
 	FNMEA_TYPE_GL,		 // 格洛纳斯定位系统（GLONASS） 
 	FNMEA_TYPE_GN, // 全球导航卫星系统（GNSS） 
+	FNMEA_TYPE_GA, // 伽利略定位系统（Galileo）
+	FNMEA_TYPE_GQ, // 准天顶卫星系统（QZSS）
+	FNMEA_TYPE_GI, // 印度区域导航卫星系统（NavIC）
+	FNMEA_TYPE_Proprietary, // 专有语句（地址字段以 'P' 开头）
+	FNMEA_TYPE_Unknown, // 其他讲话者（如电罗经 HE、综合仪表 II），只用于自定义语句
 } fnmea_type_e;
 
 /// @brief UTC 时间定义
@@ -103,7 +175,7 @@ typedef struct tagFNMEA_Degree
 				 // 南北纬，南纬为 0，北纬为非 0（通常为 1）
 	uint8_t deg; // 度
 	uint8_t min; // 分(整数部分)
-	uint16_t min_dec; // 分(小数部分)
+	uint16_t min_dec; // 分(小数部分，单位 0.0001 分)
 } fnmea_degree_t;
 
 /// @brief 位置信息（经纬度）定义
@@ -131,9 +203,9 @@ typedef struct tagFNMEA_Angle
 typedef struct tagFNMEA_Precision
 {
 	uint8_t satellite_num; // 可用卫星数量
-	uint8_t pdop;		   // 位置精度因子
-	uint8_t hdop;		   // 水平精度因子
-	uint8_t vdpop;		   // 垂直精度因子
+	uint8_t pdop;		   // 位置精度因子（单位 0.1）
+	uint8_t hdop;		   // 水平精度因子（单位 0.1）
+	uint8_t vdpop;		   // 垂直精度因子（单位 0.1）
 } fnmea_precision;
 
 typedef struct tagFNEMA
@@ -148,4 +220,119 @@ typedef struct tagFNEMA
 	fnmea_precision precision;
 } fnmea_t;
 
+/// @brief 流式解析中的字段
+typedef struct tagFNMEA_Field
+{
+	uint32_t integer;	 // 整数部分
+	uint32_t frac;		 // 小数部分
+	uint8_t frac_digits; // 小数位数（超过 9 位的部分被忽略）
+	uint8_t flags;		 // 负号、小数点、溢出标志
+	uint8_t length;		 // 字段长度
+	char head;			 // 首字符
+} fnmea_field_t;
+
+// 字段标志
+#define FNMEA_FIELD_NEGATIVE 0x01 // 负号
+#define FNMEA_FIELD_DOT 0x02	  // 已出现小数点
+#define FNMEA_FIELD_INVALID 0x04  // 非数字或数值溢出
+
+/// @brief 数据块中通过校验的语句位置
+typedef struct tagFNMEA_Span
+{
+	uint32_t offset; // '$' 的位置
+	uint32_t length; // 语句长度（到校验和为止，不含 "\r\n"）
+} fnmea_span_t;
+
+/// @brief 语句中各字段的位置（相对 '$'），第 0 个字段为地址字段
+typedef struct tagFNMEA_Tokens
+{
+	uint8_t count;						 // 字段数（超过 FNMEA_FIELDS_MAX 的字段被忽略）
+	uint16_t star;						 // '*' 的位置
+	uint16_t start[FNMEA_FIELDS_MAX];	 // 字段起始位置
+	uint16_t length[FNMEA_FIELDS_MAX]; // 字段长度
+} fnmea_tokens_t;
+
+typedef struct tagFNMEA_Ctx fnmea_ctx_t;
+
+/// @brief 语句解析完成回调
+/// @param ctx 解析上下文
+/// @param cmd 语句类型
+/// @param nmea 提交后的记录
+typedef void (*fnmea_callback_t)(fnmea_ctx_t *ctx, FNMEA_CMD_Type cmd, const fnmea_t *nmea);
+
+/// @brief 历元完成回调
+/// @param ctx 解析上下文
+/// @param fix 合并后的记录（即 ctx->nmea，不另行复制）
+/// @param seen 本历元收到的语句，由 FNMEA_EPOCH(cmd) 组成
+/// @note 没有收到的语句对应的字段保留之前历元的值
+typedef void (*fnmea_epoch_callback_t)(fnmea_ctx_t *ctx, const fnmea_t *fix, uint32_t seen);
+
+/// @brief 历元合并状态
+typedef struct tagFNMEA_Epoch
+{
+	fnmea_epoch_callback_t callback; // 历元完成回调，为 NULL 时不合并
+	uint32_t expect;				 // 凑齐后立即输出的语句
+	uint32_t seen;					 // 本历元已收到的语句
+	uint32_t time;					 // 本历元 UTC 时间（当日毫秒数）
+	uint32_t last;					 // 最近一次输出的历元的 UTC 时间
+	uint32_t timeout;				 // 超时时间，单位与 fnmea_epoch_poll 的时间相同
+	uint32_t start;					 // 本历元开始时间
+	uint32_t now;					 // 最近一次 fnmea_epoch_poll 传入的时间
+	uint32_t epochs;				 // 已输出的历元数
+	uint8_t open;					 // 是否有尚未输出的历元
+} fnmea_epoch_t;
+
+/// @brief 自定义语句处理函数
+/// @param ctx 解析上下文，ctx->work 为解析中的记录，ctx->address 为打包后的地址字段
+/// @param sentence 通过校验的语句（从 '$' 开始）
+/// @param tokens 字段位置
+/// @return 错误类型，返回 FNMEA_Error_None 时提交记录并以 FNMEA_CMD_Custom 调用回调函数
+typedef FNMEA_Error_Type (*fnmea_handler_t)(fnmea_ctx_t *ctx, const char *sentence, const fnmea_tokens_t *tokens);
+
+/// @brief 自定义语句注册表，注册完成后只读，可由多个上下文共享
+typedef struct tagFNMEA_Registry
+{
+	uint32_t count;									  // 已注册的语句数
+	uint64_t key[1 << FNMEA_HANDLER_BITS];			  // 打包后的语句标识，0 为空位
+	fnmea_handler_t handler[1 << FNMEA_HANDLER_BITS]; // 处理函数
+} fnmea_registry_t;
+
+/// @brief 解析上下文，每个数据流使用独立的上下文，库内没有其他可变的全局状态
+struct tagFNMEA_Ctx
+{
+	uint8_t state;			   // 状态机状态
+	uint8_t index;			   // 当前字段序号（地址字段为 0）
+	uint8_t checksum;		   // 累计校验和
+	uint8_t expect;			   // 接收的校验和
+	uint16_t length;		   // 当前语句长度
+	uint64_t address;		   // 地址字段（按字符打包，第一个字符在最高位）
+	FNMEA_CMD_Type cmd;		   // 语句类型
+	fnmea_field_t field;	   // 当前字段
+	fnmea_t work;			   // 解析中的记录
+	fnmea_t nmea;			   // 最近一次通过校验的记录
+	fnmea_callback_t callback; // 语句解析完成回调
+	void *user;				   // 用户数据
+	uint32_t sentences;		   // 通过校验的语句数
+	uint32_t errors;		   // 丢弃的语句数
+	const char *buffer;		   // 整条语句解析时的语句
+	uint32_t size;			   // 整条语句解析时的语句长度
+	uint32_t cursor;		   // 整条语句解析时的当前位置
+	const fnmea_registry_t *registry; // 自定义语句注册表，可为 NULL
+	fnmea_epoch_t epoch;			  // 历元合并状态
+};
+
+extern void fnmea_init(fnmea_ctx_t *ctx, fnmea_callback_t callback, void *user);
+extern FNMEA_Error_Type fnmea_feed(fnmea_ctx_t *ctx, uint8_t byte);
+extern uint32_t fnmea_feed_n(fnmea_ctx_t *ctx, const uint8_t *buf, uint32_t len);
+extern FNMEA_Error_Type fnmea_parse(fnmea_ctx_t *ctx, const char *sentence, uint32_t len);
+extern uint32_t fnmea_frame(const char *buf, uint32_t len, fnmea_span_t *spans, uint32_t max_spans, uint32_t *used);
+extern FNMEA_Error_Type fnmea_parse_span(fnmea_ctx_t *ctx, const char *buf, const fnmea_span_t *span);
+extern void fnmea_registry_init(fnmea_registry_t *registry);
+extern FNMEA_Error_Type fnmea_register(fnmea_registry_t *registry, const char *address, fnmea_handler_t handler);
+extern void fnmea_set_registry(fnmea_ctx_t *ctx, const fnmea_registry_t *registry);
+extern void fnmea_epoch_init(fnmea_ctx_t *ctx, fnmea_epoch_callback_t callback, uint32_t expect, uint32_t timeout);
+extern bool fnmea_epoch_poll(fnmea_ctx_t *ctx, uint32_t now);
+extern bool fnmea_epoch_flush(fnmea_ctx_t *ctx);
+extern bool fnmea_token_field(const char *sentence, const fnmea_tokens_t *tokens, uint8_t index, fnmea_field_t *field);
+
 #endif
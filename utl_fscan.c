@@ -0,0 +1,325 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: utl_fscan.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: 定点数快速解析库
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ * 
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* 解析规则及注意事项请参考 utl_fscan.h */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "utl_fscan.h"
+
+// 判断字符是否为十进制数字
+#define IS_DIGIT(c) ((uint8_t)((c) - '0') <= 9)
+
+/// @brief 10 的幂次表
+static const uint64_t scan_pow10[19] =
+	{
+		1ULL,
+		10ULL,
+		100ULL,
+		1000ULL,
+		10000ULL,
+		100000ULL,
+		1000000ULL,
+		10000000ULL,
+		100000000ULL,
+		1000000000ULL,
+		10000000000ULL,
+		100000000000ULL,
+		1000000000000ULL,
+		10000000000000ULL,
+		100000000000000ULL,
+		1000000000000000ULL,
+		10000000000000000ULL,
+		100000000000000000ULL,
+		1000000000000000000ULL,
+};
+
+/// @brief 按小端序读取 8 个字符
+/// @param str 字符串
+/// @return 64 位字
+static inline uint64_t fscan_load8(const char *str)
+{
+	const uint8_t *p = (const uint8_t *)str;
+	return (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+		   ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) | ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+/// @brief 判断 8 个字符是否全部为数字
+/// @param word fscan_load8 读取的 64 位字
+/// @return 全部为数字返回 true
+static inline bool fscan_is_8digits(uint64_t word)
+{
+	// 高半字节必须为 3，且低半字节加 6 后不能进位
+	return ((word & 0xF0F0F0F0F0F0F0F0ULL) |
+			(((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL;
+}
+
+/// @brief 并行转换 8 位十进制数字
+/// @param word fscan_load8 读取的 64 位字
+/// @return 8 位数字的值
+static inline uint32_t fscan_parse_8digits(uint64_t word)
+{
+	word -= 0x3030303030303030ULL;
+	// 两两合并为 2 位数，再合并为 4 位数，最后合并为 8 位数
+	word = (word * 10) + (word >> 8);
+	word = (((word & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+			(((word >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >>
+		   32;
+	return (uint32_t)word;
+}
+
+/// @brief 解析连续十进制数字
+/// @param str 字符串
+/// @param len 最大长度
+/// @param num 解析结果，超过 max_digits 位后的数字只计数不累加
+/// @param max_digits 最多累加的位数（不超过 19）
+/// @param digits 累加的位数
+/// @return 消耗的字符数
+static uint32_t fscan_digits(const char *str, uint32_t len, uint64_t *num, uint32_t max_digits, uint32_t *digits)
+{
+	uint64_t acc = 0;
+	uint32_t cnt = 0;
+	uint32_t i = 0;
+	uint64_t word;
+
+	// 长数字串每次处理 8 位
+	while (len - i >= 8 && cnt + 8 <= max_digits)
+	{
+		word = fscan_load8(str + i);
+		if (!fscan_is_8digits(word))
+		{
+			break;
+		}
+		acc = acc * 100000000ULL + fscan_parse_8digits(word);
+		cnt += 8;
+		i += 8;
+	}
+	while (i < len && IS_DIGIT(str[i]))
+	{
+		if (cnt < max_digits)
+		{
+			acc = acc * 10 + (uint64_t)(str[i] - '0');
+			cnt++;
+		}
+		i++;
+	}
+	*num = acc;
+	*digits = cnt;
+	return i;
+}
+
+/// @brief 解析无符号十进制整数
+/// @param str 字符串
+/// @param len 最大长度
+/// @param num 解析结果
+/// @return 消耗的字符数或 fscan_error_e 错误值
+extern int32_t fscan_u32(const char *str, uint32_t len, uint32_t *num)
+{
+	uint64_t acc;
+	uint32_t digits;
+	uint32_t i;
+
+	// 跳过前导 0，剩余最多 10 位有效数字
+	for (i = 0; i < len && str[i] == '0'; i++)
+	{
+	}
+	i += fscan_digits(str + i, len - i, &acc, 11, &digits);
+	if (i == 0)
+	{
+		return FSCAN_Error_Empty;
+	}
+	if (acc > UINT32_MAX)
+	{
+		return FSCAN_Error_Overflow;
+	}
+	*num = (uint32_t)acc;
+	return (int32_t)i;
+}
+
+/// @brief 解析有符号十进制整数
+/// @param str 字符串
+/// @param len 最大长度
+/// @param num 解析结果
+/// @return 消耗的字符数或 fscan_error_e 错误值
+extern int32_t fscan_i32(const char *str, uint32_t len, int32_t *num)
+{
+	uint32_t mag;
+	uint32_t sign = 0;
+	uint32_t skip = 0;
+	int32_t ret;
+
+	if (len != 0 && (str[0] == '-' || str[0] == '+'))
+	{
+		sign = (str[0] == '-');
+		skip = 1;
+	}
+	ret = fscan_u32(str + skip, len - skip, &mag);
+	if (ret < 0)
+	{
+		return ret;
+	}
+	if (mag > (uint32_t)INT32_MAX + sign)
+	{
+		return FSCAN_Error_Overflow;
+	}
+	*num = sign ? (int32_t)(0u - mag) : (int32_t)mag;
+	return ret + (int32_t)skip;
+}
+
+/// @brief 解析十六进制整数
+/// @param str 字符串
+/// @param len 最大长度
+/// @param num 解析结果
+/// @return 消耗的字符数或 fscan_error_e 错误值
+extern int32_t fscan_hex(const char *str, uint32_t len, uint32_t *num)
+{
+	uint32_t acc = 0;
+	uint32_t i;
+	uint8_t c;
+	uint8_t v;
+
+	for (i = 0; i < len; i++)
+	{
+		c = (uint8_t)str[i];
+		if (IS_DIGIT(c))
+		{
+			v = c - '0';
+		}
+		else if ((uint8_t)((c | 0x20) - 'a') <= 5)
+		{
+			v = (c | 0x20) - 'a' + 10;
+		}
+		else
+		{
+			break;
+		}
+		if (acc > 0x0FFFFFFF)
+		{
+			return FSCAN_Error_Overflow;
+		}
+		acc = (acc << 4) | v;
+	}
+	if (i == 0)
+	{
+		return FSCAN_Error_Empty;
+	}
+	*num = acc;
+	return (int32_t)i;
+}
+
+/// @brief 解析定点小数
+/// @param str 字符串
+/// @param len 最大长度
+/// @param q 小数位数（0 ~ 30）
+/// @param num 解析结果
+/// @return 消耗的字符数或 fscan_error_e 错误值
+extern int32_t fscan_fq(const char *str, uint32_t len, uint8_t q, int32_t *num)
+{
+	uint64_t integer;
+	uint64_t frac = 0;
+	uint64_t den;
+	uint64_t result;
+	uint32_t int_digits;
+	uint32_t frac_digits = 0;
+	uint32_t sign = 0;
+	uint32_t i = 0;
+	uint32_t n;
+	uint32_t bit;
+	bool has_digits;
+
+	if (q > 30)
+	{
+		return FSCAN_Error_ArgsErr;
+	}
+	if (len != 0 && (str[0] == '-' || str[0] == '+'))
+	{
+		sign = (str[0] == '-');
+		i = 1;
+	}
+	n = i;
+	while (i < len && str[i] == '0')
+	{
+		i++;
+	}
+	i += fscan_digits(str + i, len - i, &integer, 11, &int_digits);
+	has_digits = (i > n);
+	if (i < len && str[i] == '.')
+	{
+		n = fscan_digits(str + i + 1, len - i - 1, &frac, 18, &frac_digits);
+		if (n != 0 || has_digits)
+		{
+			i += n + 1;
+			has_digits = true;
+		}
+	}
+	if (!has_digits)
+	{
+		return FSCAN_Error_Empty;
+	}
+	if (integer > ((uint64_t)1 << (31 - q)))
+	{
+		return FSCAN_Error_Overflow;
+	}
+
+	// 逐位长除法计算 frac * 2^q / 10^n，余数用于四舍五入
+	den = scan_pow10[frac_digits];
+	result = integer;
+	for (bit = 0; bit < q; bit++)
+	{
+		frac <<= 1;
+		result <<= 1;
+		if (frac >= den)
+		{
+			frac -= den;
+			result |= 1;
+		}
+	}
+	if (frac * 2 >= den)
+	{
+		result++;
+	}
+	if (result > (uint64_t)INT32_MAX + sign)
+	{
+		return FSCAN_Error_Overflow;
+	}
+	*num = sign ? (int32_t)(0u - (uint32_t)result) : (int32_t)result;
+	return (int32_t)i;
+}
+
+/// @brief 解析 FQ12 定点小数
+/// @param str 字符串
+/// @param len 最大长度
+/// @param num 解析结果
+/// @return 消耗的字符数或 fscan_error_e 错误值
+extern int32_t fscan_fq12(const char *str, uint32_t len, int32_t *num)
+{
+	return fscan_fq(str, len, 12, num);
+}
@@ -0,0 +1,74 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: utl_fscan.h
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: 定点数快速解析库
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ * 
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+ /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+  * FSCAN 解析规则：
+  *
+  * fscan 是 ffmt 的逆操作，从字符串中解析整数与定点小数
+  *
+  * 所有函数均传入字符串指针与最大可读长度，遇到第一个不属于该类型的字符即停止，
+  * 字符串不需要以 '\0' 结尾
+  *
+  * 返回值：
+  * [>0]	已解析的字符数
+  * [<0]	fscan_error_e 错误值，此时不写入结果
+  *
+  * fscan_u32		无符号十进制整数		[0-9]+
+  * fscan_i32		有符号十进制整数		[+-][0-9]+
+  * fscan_hex		十六进制整数			[0-9a-fA-F]+（不含 0x 前缀）
+  * fscan_fq		任意 Q 格式定点小数		[+-][0-9]*[.[0-9]*]
+  * fscan_fq12		FQ12 定点小数			同上
+  *
+  * 定点小数按绝对值四舍五入，最多取 18 位小数，其余小数位忽略
+  * 长数字串每次按 8 位（64 位字）并行转换
+  *
+  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef __UTL_FSCAN_H__
+#define __UTL_FSCAN_H__
+
+#include <stdint.h>
+
+/// @brief fscan 错误类型 枚举
+typedef enum tagFSCAN_Error
+{
+	FSCAN_Error_Empty = -1,	   /* 没有可解析的数字 */
+	FSCAN_Error_Overflow = -2, /* 数值溢出 */
+	FSCAN_Error_ArgsErr = -3,  /* 参数错误 */
+} fscan_error_e;
+
+extern int32_t fscan_u32(const char *str, uint32_t len, uint32_t *num);
+extern int32_t fscan_i32(const char *str, uint32_t len, int32_t *num);
+extern int32_t fscan_hex(const char *str, uint32_t len, uint32_t *num);
+extern int32_t fscan_fq(const char *str, uint32_t len, uint8_t q, int32_t *num);
+extern int32_t fscan_fq12(const char *str, uint32_t len, int32_t *num);
+
+#endif
@@ -0,0 +1,393 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: utl_fsink.c
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: flogs 内存映射文件输出端
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ * 
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+// ftruncate、pwrite、msync 等 POSIX 接口
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "utl_fsink.h"
+#include "utl_ffmt.h"
+
+// 分段结尾的长度记录：8 字节标记 + 有效长度 + 有效长度取反
+#define FSINK_FOOTER_SIZE (16) // Bytes
+static const char fsink_magic[8] = {'F', 'S', 'I', 'N', 'K', 'E', 'N', 'D'};
+
+/// @brief 当前分段文件描述符
+static int fsink_fd = -1;
+
+/// @brief 当前分段映射区
+static char *fsink_map = 0;
+
+/// @brief 当前分段写入位置
+static uint32_t fsink_offset = 0;
+
+/// @brief 上次回写的位置
+static uint32_t fsink_synced = 0;
+
+/// @brief 分段大小
+static uint32_t fsink_size = 0;
+
+/// @brief 分段中可写入记录的长度（分段大小减去长度记录）
+static uint32_t fsink_capacity = 0;
+
+/// @brief 保留的分段数量
+static uint32_t fsink_segments = 0;
+
+/// @brief 回写策略
+static fsink_sync_e fsink_policy = FSINK_Sync_None;
+
+/// @brief 因没有可用分段而丢弃的字节数
+static uint32_t fsink_drops = 0;
+
+/// @brief 分段文件路径前缀
+static char fsink_prefix[FSINK_PATH_MAX_SIZE] = {0};
+
+/// @brief 生成分段文件路径 <prefix>.<index>.log
+/// @param path 路径缓冲区，长度为 FSINK_PATH_MAX_SIZE
+/// @param index 分段序号
+/// @return 是否成功
+static bool fsink_path(char *path, uint32_t index)
+{
+    return ffmt(path, FSINK_PATH_MAX_SIZE, false, "%s.%u.log", fsink_prefix, index) > 0;
+}
+
+/// @brief 生成长度记录
+/// @param footer 长度记录缓冲区
+/// @param length 有效长度
+static void fsink_footer(char *footer, uint32_t length)
+{
+    uint32_t check = ~length;
+
+    memcpy(footer, fsink_magic, sizeof(fsink_magic));
+    memcpy(footer + 8, &length, sizeof(length));
+    memcpy(footer + 12, &check, sizeof(check));
+}
+
+/// @brief 读取长度记录
+/// @param footer 长度记录
+/// @param limit 有效长度上限
+/// @param length 有效长度
+/// @return 是否为有效的长度记录
+static bool fsink_footer_length(const char *footer, uint32_t limit, uint32_t *length)
+{
+    uint32_t check;
+
+    memcpy(length, footer + 8, sizeof(*length));
+    memcpy(&check, footer + 12, sizeof(check));
+    return (memcmp(footer, fsink_magic, sizeof(fsink_magic)) == 0) && (check == ~*length) && (*length <= limit);
+}
+
+/// @brief 回写当前分段 [fsink_synced, fsink_offset) 范围，再回写长度记录
+/// @param flags MS_SYNC 或 MS_ASYNC
+static void fsink_msync(int flags)
+{
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uint32_t start;
+
+    if ((fsink_map == 0) || (fsink_offset == fsink_synced))
+    {
+        return;
+    }
+    // msync 起始地址需按页对齐
+    start = fsink_synced & ~(uint32_t)(page - 1);
+    msync(fsink_map + start, fsink_offset - start, flags);
+    start = fsink_capacity & ~(uint32_t)(page - 1);
+    msync(fsink_map + start, fsink_size - start, flags);
+    fsink_synced = fsink_offset;
+}
+
+/// @brief 解除当前分段映射，并将文件截断到实际长度
+/// @param
+static void fsink_unmap(void)
+{
+    if (fsink_map != 0)
+    {
+        if (fsink_policy != FSINK_Sync_None)
+        {
+            fsink_msync(MS_SYNC);
+        }
+        munmap(fsink_map, fsink_size);
+        fsink_map = 0;
+    }
+    if (fsink_fd >= 0)
+    {
+        if (ftruncate(fsink_fd, fsink_offset) != 0)
+        {
+            // 截断失败时结尾的长度记录仍然有效，不影响恢复
+        }
+        close(fsink_fd);
+        fsink_fd = -1;
+    }
+}
+
+/// @brief 打开并映射 <prefix>.0.log，已有内容时从有效结尾继续追加
+/// @param
+/// @return fsink_error_e 错误值，已有分段已写满时不修改文件并返回 FSINK_Error_Open
+static int32_t fsink_map_segment(void)
+{
+    char path[FSINK_PATH_MAX_SIZE];
+    char footer[FSINK_FOOTER_SIZE];
+    uint32_t offset;
+    struct stat st;
+    void *map;
+
+    if (!fsink_path(path, 0))
+    {
+        return FSINK_Error_ArgsErr;
+    }
+    fsink_fd = open(path, O_RDWR | O_CREAT, 0644);
+    if ((fsink_fd < 0) || (fstat(fsink_fd, &st) != 0) || ((uint64_t)st.st_size > fsink_size))
+    {
+        goto fsink_map_error;
+    }
+    // 读取已有分段结尾的长度记录，没有时为正常关闭的分段
+    offset = (uint32_t)st.st_size;
+    if (st.st_size >= FSINK_FOOTER_SIZE)
+    {
+        if (pread(fsink_fd, footer, FSINK_FOOTER_SIZE, st.st_size - FSINK_FOOTER_SIZE) != FSINK_FOOTER_SIZE)
+        {
+            goto fsink_map_error;
+        }
+        if (!fsink_footer_length(footer, (uint32_t)st.st_size - FSINK_FOOTER_SIZE, &offset))
+        {
+            offset = (uint32_t)st.st_size;
+        }
+    }
+    if (offset >= fsink_capacity)
+    {
+        goto fsink_map_error;
+    }
+    // 扩展到完整大小的同时写入长度记录，崩溃遗留的分段总带有长度记录
+    if ((uint64_t)st.st_size != fsink_size)
+    {
+        fsink_footer(footer, offset);
+        if (pwrite(fsink_fd, footer, FSINK_FOOTER_SIZE, fsink_capacity) != FSINK_FOOTER_SIZE)
+        {
+            goto fsink_map_error;
+        }
+    }
+    map = mmap(0, fsink_size, PROT_READ | PROT_WRITE, MAP_SHARED, fsink_fd, 0);
+    if (map == MAP_FAILED)
+    {
+        close(fsink_fd);
+        fsink_fd = -1;
+        return FSINK_Error_Map;
+    }
+    fsink_map = (char *)map;
+    fsink_offset = offset;
+    fsink_synced = fsink_offset;
+    return FSINK_Error_None;
+
+fsink_map_error:
+    if (fsink_fd >= 0)
+    {
+        close(fsink_fd);
+        fsink_fd = -1;
+    }
+    return FSINK_Error_Open;
+}
+
+/// @brief 切换到新分段
+/// @param
+/// @return fsink_error_e 错误值
+static int32_t fsink_rotate(void)
+{
+    char from[FSINK_PATH_MAX_SIZE];
+    char to[FSINK_PATH_MAX_SIZE];
+
+    fsink_unmap();
+
+    // 删除最旧的分段，其余分段序号加一
+    if (!fsink_path(to, fsink_segments - 1))
+    {
+        return FSINK_Error_ArgsErr;
+    }
+    unlink(to);
+    for (uint32_t i = fsink_segments - 1; i > 0; i--)
+    {
+        fsink_path(from, i - 1);
+        fsink_path(to, i);
+        if ((rename(from, to) != 0) && (access(from, F_OK) == 0))
+        {
+            return FSINK_Error_Open;
+        }
+    }
+    // 单个分段时直接删除旧文件
+    if (fsink_segments == 1)
+    {
+        fsink_path(from, 0);
+        unlink(from);
+    }
+    return fsink_map_segment();
+}
+
+/// @brief 打开文件输出端
+/// @param prefix 分段文件路径前缀，分段文件为 <prefix>.N.log
+/// @param segment_size 分段大小（字节，含结尾 16 字节的长度记录）
+/// @param segments 保留的分段数量（至少为 1）
+/// @param sync 回写策略
+/// @return fsink_error_e 错误值
+extern int32_t fsink_open(const char *prefix, uint32_t segment_size, uint32_t segments, fsink_sync_e sync)
+{
+    if ((prefix == 0) || (segment_size <= FSINK_FOOTER_SIZE) || (segments == 0) ||
+        (strlen(prefix) + sizeof(".4294967295.log") > FSINK_PATH_MAX_SIZE))
+    {
+        return FSINK_Error_ArgsErr;
+    }
+    fsink_close();
+    strcpy(fsink_prefix, prefix);
+    fsink_size = segment_size;
+    fsink_capacity = segment_size - FSINK_FOOTER_SIZE;
+    fsink_segments = segments;
+    fsink_policy = sync;
+    fsink_drops = 0;
+
+    // 打开失败或上次运行时当前分段已写满
+    if (fsink_map_segment() != FSINK_Error_None)
+    {
+        return fsink_rotate();
+    }
+    return FSINK_Error_None;
+}
+
+/// @brief 写入一段记录
+/// @param data 记录内容
+/// @param size 记录长度
+static void fsink_write(const char *data, uint32_t size)
+{
+    // 超过分段容量的记录只保留开头
+    if (size > fsink_capacity)
+    {
+        size = fsink_capacity;
+    }
+    // 之前打开失败时重试
+    if ((fsink_map == 0) && (fsink_size != 0))
+    {
+        fsink_map_segment();
+    }
+    if ((fsink_map != 0) && (size > fsink_capacity - fsink_offset))
+    {
+        fsink_rotate();
+    }
+    if (fsink_map == 0)
+    {
+        fsink_drops += size;
+        return;
+    }
+    memcpy(fsink_map + fsink_offset, data, size);
+    fsink_offset += size;
+    fsink_footer(fsink_map + fsink_capacity, fsink_offset);
+
+    if (fsink_policy == FSINK_Sync_Record)
+    {
+        fsink_msync(MS_SYNC);
+    }
+    else if ((fsink_policy == FSINK_Sync_Async) && (fsink_offset - fsink_synced >= FSINK_SYNC_BYTES))
+    {
+        fsink_msync(MS_ASYNC);
+    }
+}
+
+/// @brief flogs 输出函数，配合 flogs_init 使用
+/// @param buffer 记录内容
+/// @param size 记录长度（flogs 传入的文本记录长度已不含末尾的 '\0'，二进制记录原样写入）
+extern void fsink_output(char *buffer, uint32_t size)
+{
+    fsink_write(buffer, size);
+}
+
+#if FLOG_BATCH
+/// @brief flogs 批量输出函数，配合 flogs_batch_init 使用
+/// @param iov 片段列表
+/// @param count 片段数量
+extern void fsink_writev(const flogs_iovec_t *iov, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        fsink_write(iov[i].base, (uint32_t)iov[i].len);
+    }
+    if (fsink_policy == FSINK_Sync_Record)
+    {
+        fsink_msync(MS_SYNC);
+    }
+}
+#endif
+
+/// @brief 同步回写当前分段
+/// @param
+extern void fsink_sync(void)
+{
+    fsink_msync(MS_SYNC);
+}
+
+/// @brief 关闭文件输出端，文件截断到实际长度
+/// @param
+extern void fsink_close(void)
+{
+    fsink_unmap();
+    fsink_offset = 0;
+    fsink_synced = 0;
+    fsink_size = 0;
+    fsink_capacity = 0;
+}
+
+/// @brief 查找分段中有效数据的结尾
+/// @param map 分段文件内容
+/// @param size 分段文件长度
+/// @return 有效数据长度
+/// @note 写入中的分段以长度记录结尾，正常关闭的分段已截断到有效长度（没有长度记录）；
+///       记录内容不受限制（可以包含 0 字节），也可用于离线读取崩溃后的分段文件
+extern uint32_t fsink_recover(const char *map, uint32_t size)
+{
+    uint32_t length;
+
+    if ((size < FSINK_FOOTER_SIZE) ||
+        !fsink_footer_length(map + size - FSINK_FOOTER_SIZE, size - FSINK_FOOTER_SIZE, &length))
+    {
+        return size;
+    }
+    return length;
+}
+
+/// @brief 获取因没有可用分段而丢弃的字节数
+/// @param
+/// @return 丢弃的字节数
+extern uint32_t fsink_dropped(void)
+{
+    return fsink_drops;
+}
@@ -0,0 +1,93 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * 文件名: utl_fsink.h
+ * 作者: akako
+ * 修订版本: 1.0
+ * 最后编辑: akako
+ * 内容摘要: flogs 内存映射文件输出端
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *
+ * Email: akako.ziqi@outlook.com
+ *
+ * Copyright (C) 2023 akako
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ * 
+ * 本程序仅供参考，使用本程序造成的一切后果与作者无关，由您自己负责。
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * FSINK 说明：
+ *
+ * fsink 是 flogs 的内存映射文件输出端（需要 POSIX mmap 支持）
+ *
+ * 日志写入预分配并映射到内存的分段文件 <prefix>.0.log，记录从日志缓冲区直接复制到映射区
+ * 当前分段写满时依次重命名 <prefix>.N.log => <prefix>.N+1.log，最旧的分段被删除，
+ * 再创建新的 <prefix>.0.log
+ *
+ * 分段最后 16 字节为长度记录（标记 + 有效长度），每次写入后随记录一起更新，
+ * 因此崩溃后可以直接读出有效数据的结尾（fsink_recover），fsink_open 会自动在该位置继续追加；
+ * 正常关闭或切换分段时文件会被截断到实际长度（不含长度记录）
+ * 记录内容不受限制，压缩帧、TLV 与延迟输出模式的二进制记录中的 0 字节都不影响恢复
+ *
+ * 用法：
+ * fsink_open("/var/log/app", 1 << 20, 4, FSINK_Sync_Async);
+ * flogs_init(fsink_output);
+ *
+ * 输出函数不加锁，需在单个线程中调用（异步模式下的输出线程满足该条件）
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef __UTL_FSINK_H__
+#define __UTL_FSINK_H__
+
+#include <stdint.h>
+#include "utl_flogs.h"
+
+// 分段文件路径最大长度
+#define FSINK_PATH_MAX_SIZE (256) // Bytes
+// FSINK_Sync_Async 策略下每写入多少字节发起一次异步回写
+#define FSINK_SYNC_BYTES (64 * 1024) // Bytes
+
+/// @brief fsink 回写策略 枚举
+typedef enum tagFSINK_Sync
+{
+    FSINK_Sync_None = 0,  /* 由内核自行回写，切换分段时也不等待 */
+    FSINK_Sync_Rotate,    /* 切换分段与关闭时同步回写 */
+    FSINK_Sync_Async,     /* 每写入 FSINK_SYNC_BYTES 字节发起一次异步回写，切换分段时同步回写 */
+    FSINK_Sync_Record,    /* 每条记录同步回写（最慢，掉电也不丢失） */
+} fsink_sync_e;
+
+/// @brief fsink 错误类型 枚举
+typedef enum tagFSINK_Error
+{
+    FSINK_Error_None = 0,    /* 没有错误 */
+    FSINK_Error_ArgsErr = -1, /* 参数错误 */
+    FSINK_Error_Open = -2,   /* 文件打开、重命名或预分配失败 */
+    FSINK_Error_Map = -3,    /* 内存映射失败 */
+} fsink_error_e;
+
+extern int32_t fsink_open(const char *prefix, uint32_t segment_size, uint32_t segments, fsink_sync_e sync);
+extern void fsink_output(char *buffer, uint32_t size);
+#if FLOG_BATCH
+extern void fsink_writev(const flogs_iovec_t *iov, uint32_t count);
+#endif
+extern void fsink_sync(void);
+extern void fsink_close(void);
+extern uint32_t fsink_recover(const char *map, uint32_t size);
+extern uint32_t fsink_dropped(void);
+
+#endif